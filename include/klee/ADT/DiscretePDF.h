@@ -11,6 +11,7 @@
 #define KLEE_DISCRETEPDF_H
 
 #include <functional>
+#include <vector>
 
 namespace klee {
   template <class T, class Comparator = std::less<T>>
@@ -31,6 +32,11 @@ namespace klee {
     bool inTree(T item);
     weight_type getWeight(T item);
 
+    /* set the weight of every item to weightOf(item), in time linear in
+     * the number of items.
+     */
+    template <class WeightFunction> void updateAll(WeightFunction weightOf);
+
     /* pick a tree element according to its
      * weight. p should be in [0,1).
      */
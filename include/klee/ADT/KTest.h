@@ -54,6 +54,37 @@ extern "C" {
 
   void  kTest_free(KTest *);
 
+  /* A set of ktests read from a memory mapped .ktest file or bundle of
+   * ktests. The KTests it hands out are parsed on first use and refer to
+   * the mapping for their object bytes rather than owning them; they stay
+   * valid until the bundle is closed and must not be passed to kTest_free.
+   */
+  typedef struct KTestBundle KTestBundle;
+
+  /* return true iff file at path matches KTest bundle header */
+  int   kTest_isBundleFile(const char *path);
+
+  /* opens a bundle file, or a .ktest file as a bundle of one; returns NULL
+   * on (unspecified) error */
+  KTestBundle *kTestBundle_open(const char *path);
+
+  /* returns the number of ktests in the bundle */
+  unsigned kTestBundle_size(KTestBundle *);
+
+  /* returns the name of the i-th ktest: the name it was bundled under, or
+   * the path of a single .ktest file */
+  const char *kTestBundle_getName(KTestBundle *, unsigned i);
+
+  /* returns NULL if the i-th ktest is malformed */
+  KTest *kTestBundle_getKTest(KTestBundle *, unsigned i);
+
+  void  kTestBundle_close(KTestBundle *);
+
+  /* writes the n ktests into one bundle file under the given names;
+   * returns 1 on success, 0 on (unspecified) error */
+  int   kTest_toBundle(KTest **, const char **names, unsigned n,
+                       const char *path);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,69 @@
+//===-- SPSCQueue.h ---------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_SPSCQUEUE_H
+#define KLEE_SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+namespace klee {
+  /// Fixed-capacity FIFO queue shared by exactly one producer thread and one
+  /// consumer thread. Neither side ever blocks or takes a lock: the producer
+  /// only advances the tail and the consumer only advances the head.
+  template <class T, std::size_t Capacity>
+  class SPSCQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "SPSCQueue capacity must be a power of two");
+
+    T buffer[Capacity]{};
+    // Padded apart so that the two threads do not keep invalidating each
+    // other's cache line. Padding rather than alignas, as the queue is
+    // usually embedded in heap objects.
+    char padBefore[64];
+    std::atomic<std::size_t> head{0};
+    char padBetween[64 - sizeof(std::atomic<std::size_t>)];
+    std::atomic<std::size_t> tail{0};
+
+  public:
+    SPSCQueue() = default;
+    SPSCQueue(const SPSCQueue &) = delete;
+    SPSCQueue &operator=(const SPSCQueue &) = delete;
+
+    /// Producer side. Returns false (and leaves the queue unchanged) if the
+    /// queue is full.
+    bool push(const T &value) {
+      std::size_t t = tail.load(std::memory_order_relaxed);
+      if (t - head.load(std::memory_order_acquire) == Capacity)
+        return false;
+      buffer[t & (Capacity - 1)] = value;
+      tail.store(t + 1, std::memory_order_release);
+      return true;
+    }
+
+    /// Consumer side. Returns false if the queue is empty.
+    bool pop(T &value) {
+      std::size_t h = head.load(std::memory_order_relaxed);
+      if (h == tail.load(std::memory_order_acquire))
+        return false;
+      value = buffer[h & (Capacity - 1)];
+      head.store(h + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool empty() const {
+      return head.load(std::memory_order_acquire) ==
+             tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr std::size_t capacity() { return Capacity; }
+  };
+}
+
+#endif /* KLEE_SPSCQUEUE_H */
@@ -10,34 +10,80 @@
 #ifndef KLEE_TREESTREAM_H
 #define KLEE_TREESTREAM_H
 
+#include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include <sys/types.h>
+
 namespace klee {
 
   typedef unsigned TreeStreamID;
   class TreeOStream;
 
+  /// Writes a tree of byte streams, where a stream opened from another one
+  /// starts out with everything written to its parent so far.
+  ///
+  /// Records are appended to memory-mapped chunks of a segment file. Every
+  /// record links back to the previous record of its stream, and a forked
+  /// stream starts out linked to the last record of its parent, so the index
+  /// only has to keep the last record of each stream. Reading a stream
+  /// follows that chain and then copies the records in the order they were
+  /// written, i.e. at increasing addresses of the mapped memory.
+  ///
+  /// A process forked from the one that created the writer appends to its
+  /// own segment (the path suffixed with its pid) and can still read the
+  /// records written before the fork.
   class TreeStreamWriter {
-    static const unsigned bufferSize = 4*4096;
-
     friend class TreeOStream;
 
   private:
-    char buffer[bufferSize];
-    unsigned lastID, bufferCount;
+    /// Chunk index in the upper, offset within the chunk in the lower half.
+    typedef std::uint64_t RecordAddress;
+    static const RecordAddress noRecord = ~RecordAddress(0);
+
+    struct Chunk {
+      char *base;
+      std::size_t size;
+    };
+    std::vector<Chunk> chunks;
 
     std::string path;
-    std::ofstream *output;
-    unsigned ids;
+    int fd;
+    pid_t owner;
+    /// Size of the segment file of this process.
+    off_t segmentSize;
+    /// Bytes used in the last chunk, if this process owns it.
+    std::size_t chunkUsed;
+    bool ownsLastChunk;
+
+    /// The last record written, while it can still be appended to, and its
+    /// size as far as this process is concerned.
+    RecordAddress openRecord;
+    std::uint32_t openRecordSize;
+
+    /// Records that were still open when this process was forked from the
+    /// writer of their segment, with their size at that point. That process
+    /// may have appended to them since.
+    std::vector<std::pair<RecordAddress, std::uint32_t>> forkedRecords;
+
+    /// Last record of every stream, indexed by stream ID.
+    std::vector<RecordAddress> tails;
+
+    char *getRecord(RecordAddress address) const;
+    bool ensureSegment();
+    bool addChunk(std::size_t minSize);
 
     void write(TreeOStream &os, const char *s, unsigned size);
-    void flushBuffer();
 
   public:
     TreeStreamWriter(const std::string &_path);
     ~TreeStreamWriter();
 
+    TreeStreamWriter(const TreeStreamWriter &) = delete;
+    TreeStreamWriter &operator=(const TreeStreamWriter &) = delete;
+
     bool good();
 
     TreeOStream open();
@@ -134,6 +134,11 @@ public:
   // for the search. use null to reset.
   virtual void useSeeds(const std::vector<struct KTest *> *seeds) = 0;
 
+  // explore only the \p job-th of \p jobs shares of the paths that no
+  // seed follows, so that processes given different seeds do not explore
+  // the same paths after leaving them.
+  virtual void partitionPaths(unsigned job, unsigned jobs) = 0;
+
   virtual void runFunctionAsMain(llvm::Function *f,
                                  int argc,
                                  char **argv,
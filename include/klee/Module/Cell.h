@@ -12,11 +12,59 @@
 
 #include "klee/Expr/Expr.h"
 
+#include <cstdint>
+
 namespace klee {
   class MemoryObject;
 
+  /// A register or constant. Registers may hold a concrete value of at most
+  /// 64 bits inline, so that concrete arithmetic does not allocate a
+  /// ConstantExpr; it is created when the value is first read as an
+  /// expression.
   struct Cell {
+    /// The value, or null while it is held inline or not initialized.
     ref<Expr> value;
+    /// The inline value, valid while value is null and inlineWidth is not 0.
+    std::uint64_t inlineBits = 0;
+    Expr::Width inlineWidth = 0;
+
+    bool isInline() const { return value.isNull() && inlineWidth != 0; }
+
+    /// Hold \p bits inline. Bits beyond \p width must be 0.
+    void setInline(std::uint64_t bits, Expr::Width width) {
+      value = nullptr;
+      inlineBits = bits;
+      inlineWidth = width;
+    }
+
+    /// Create the ConstantExpr of an inline value, so that value is set.
+    void materialize() {
+      if (isInline())
+        value = ConstantExpr::create(inlineBits, inlineWidth);
+    }
+
+    /// \return The value as an expression, without keeping it.
+    ref<Expr> getValue() const {
+      if (isInline())
+        return ConstantExpr::create(inlineBits, inlineWidth);
+      return value;
+    }
+
+    /// Read a concrete value of at most 64 bits without allocating.
+    /// \return False if the value is symbolic, wider or not initialized.
+    bool getConcrete(std::uint64_t &bits, Expr::Width &width) const {
+      if (value.isNull()) {
+        bits = inlineBits;
+        width = inlineWidth;
+        return width != 0;
+      }
+      const ConstantExpr *ce = dyn_cast<ConstantExpr>(value);
+      if (!ce || ce->getWidth() > Expr::Int64)
+        return false;
+      bits = ce->getZExtValue();
+      width = ce->getWidth();
+      return true;
+    }
   };
 }
 
@@ -72,7 +72,9 @@ namespace klee {
     std::vector<std::unique_ptr<std::string>> internedStrings;
 
   public:
-    explicit InstructionInfoTable(const llvm::Module &m);
+    /// Extract the debug information of the functions of \p m on up to
+    /// \p threads threads.
+    explicit InstructionInfoTable(const llvm::Module &m, unsigned threads = 1);
 
     unsigned getMaxID() const;
     const InstructionInfo &getInfo(const llvm::Instruction &) const;
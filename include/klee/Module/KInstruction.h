@@ -19,14 +19,17 @@
 #include <vector>
 
 namespace llvm {
+  class Function;
   class Instruction;
 }
 
 namespace klee {
+  class ExecutionState;
   class Executor;
   struct InstructionInfo;
   class KModule;
   struct KBlock;
+  struct KFunction;
 
 
   /// KInstruction - Intermediate instruction representation used
@@ -42,7 +45,14 @@ namespace klee {
     int *operands;
     /// Destination register index.
     unsigned dest;
+    /// Width in bits of the result, decoded from the type of inst; 0 if
+    /// inst has no sized result.
+    unsigned width;
     KBlock *parent;
+    /// The Executor member that executes inst, decoded from its opcode when
+    /// the instruction is bound.
+    void (Executor::*handler)(ExecutionState &state,
+                              KInstruction *ki) = nullptr;
 
   public:
     KInstruction() = default;
@@ -67,6 +77,49 @@ namespace klee {
     KGEPInstruction() = default;
     explicit KGEPInstruction(const KGEPInstruction& ki);
   };
+
+  /// CallDispatch - How the Executor executes a call to a function,
+  /// resolved once per call site instead of on every call.
+  struct CallDispatch {
+    enum Kind {
+      /// Not resolved yet.
+      Unbound,
+      /// A function modelled by the SpecialFunctionHandler.
+      Special,
+      /// An LLVM intrinsic implemented by the Executor.
+      Intrinsic,
+      /// A function defined in the module.
+      Internal,
+      /// A declaration called natively through the ExternalDispatcher.
+      External,
+    };
+
+    Kind kind = Unbound;
+    /// The function the dispatch was resolved for.
+    llvm::Function *function = nullptr;
+    /// The KFunction of an internal function, null until it is constructed.
+    KFunction *kf = nullptr;
+    /// The index of the handler of a special function.
+    unsigned handler = 0;
+    /// Whether the function is __cxa_throw or __cxa_rethrow, after which an
+    /// invoke does not continue at its normal destination.
+    bool throwsException = false;
+  };
+
+  struct KCallInstruction : KInstruction {
+    /// The function called directly, resolving aliases and bitcasts, or
+    /// null for indirect calls.
+    llvm::Function *calledFunction = nullptr;
+
+    /// The dispatch of calledFunction for direct calls. For indirect calls,
+    /// the dispatch of the last function called, as a one-entry inline
+    /// cache.
+    CallDispatch dispatch;
+
+  public:
+    KCallInstruction() = default;
+    explicit KCallInstruction(const KCallInstruction& ki);
+  };
 }
 
 #endif /* KLEE_KINSTRUCTION_H */
@@ -12,6 +12,7 @@
 
 #include "klee/Config/Version.h"
 #include "klee/Core/Interpreter.h"
+#include "klee/System/Time.h"
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/IR/CFG.h"
@@ -19,6 +20,9 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 #include <deque>
 
@@ -101,7 +105,7 @@ namespace klee {
 
     std::map<llvm::Instruction *, KInstruction *> instructionMap;
     std::vector<std::unique_ptr<KBlock>> blocks;
-    std::map<llvm::BasicBlock*, KBlock*> blockMap;
+    std::unordered_map<llvm::BasicBlock*, KBlock*> blockMap;
     KBlock *entryKBlock;
     std::vector<KBlock *> finalKBlocks;
     std::vector<KCallBlock*> kCallBlocks;
@@ -110,6 +114,13 @@ namespace klee {
     /// "coverable" for statistics and search heuristics.
     bool trackCoverage;
 
+    /// The constant operands (instruction, operand index, constant) found
+    /// while constructing the function, until KModule::resolveConstants
+    /// numbers them. Keeping the constant table out of the constructor
+    /// lets functions be constructed in parallel.
+    std::vector<std::tuple<KInstruction *, unsigned, llvm::Constant *>>
+        pendingConstants;
+
   private:
     std::map<KBlock*, std::map<KBlock*, unsigned int>> distance;
     std::map<KBlock*, std::map<KBlock*, unsigned int>> backwardDistance;
@@ -171,16 +182,28 @@ namespace klee {
     // Functions which are part of KLEE runtime
     std::set<const llvm::Function*> internalFunctions;
 
+    /// Wall time spent in each stage of preparing the module, in the order
+    /// the stages first ran.
+    std::vector<std::pair<std::string, time::Span>> preparationTimes;
+
   private:
     std::map<KFunction*, std::map<KFunction*, unsigned int>> distance;
     std::map<KFunction*, std::map<KFunction*, unsigned int>> backwardDistance;
 
     // Mark function with functionName as part of the KLEE runtime
     void addInternalFunction(const char* functionName);
+    // Mark the runtime functions added by optimiseAndPrepare
+    void addInternalFunctions(const Interpreter::ModuleOptions &opts);
     // Replace std functions with KLEE intrinsics
     void replaceFunction(const std::unique_ptr<llvm::Module> &m, const char *original,
                            const char *replacement);
 
+    /// Attach the debug information of its instructions to \p kf.
+    void setInstructionInfos(KFunction &kf) const;
+    /// Decode the result widths of the instructions of \p kf. Not thread
+    /// safe, as the DataLayout caches struct layouts.
+    void setInstructionWidths(KFunction &kf) const;
+
     // BFS algorithm
     void calculateDistance(KFunction *kf);
     void calculateBackwardDistance(KFunction *kf);
@@ -193,6 +216,15 @@ namespace klee {
     void optimiseAndPrepare(const Interpreter::ModuleOptions &opts,
                             llvm::ArrayRef<const char *>);
 
+    /// Describe the options that change how link, instrument and
+    /// optimiseAndPrepare transform the module, for keying a ModuleCache.
+    std::string describePreparation(const Interpreter::ModuleOptions &opts) const;
+
+    /// Use \p m, as produced by optimiseAndPrepare with \p opts in an
+    /// earlier run, instead of linking and preparing the module.
+    void setPreparedModule(std::unique_ptr<llvm::Module> m,
+                           const Interpreter::ModuleOptions &opts);
+
     /// Manifest the generated module (e.g. assembly.ll, output.bc) and
     /// prepares KModule
     ///
@@ -221,10 +253,19 @@ namespace klee {
     /// Return an id for the given constant, creating a new one if necessary.
     unsigned getConstantID(llvm::Constant *c, KInstruction* ki);
 
+    /// Number the pending constant operands of \p kf.
+    void resolveConstants(KFunction &kf);
+
     /// Run passes that check if module is valid LLVM IR and if invariants
     /// expected by KLEE's Executor hold.
     void checkModule();
 
+    /// Return the KFunction of \p f, constructing it on first use if it was
+    /// not constructed by manifest (see --lazy-functions). New KFunctions are
+    /// appended to functions and may add constants.
+    /// \return Null if \p f is null or only declared.
+    KFunction *getKFunction(llvm::Function *f);
+
     KBlock *getKBlock(llvm::BasicBlock *bb);
     std::map<KFunction*, unsigned int>& getBackwardDistance(KFunction *kf);
     std::map<KFunction*, unsigned int>& getDistance(KFunction *kf);
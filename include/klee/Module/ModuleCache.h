@@ -0,0 +1,59 @@
+//===-- ModuleCache.h -------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_MODULECACHE_H
+#define KLEE_MODULECACHE_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MD5.h"
+
+#include <memory>
+#include <string>
+
+namespace llvm {
+  class LLVMContext;
+  class Module;
+}
+
+namespace klee {
+  /// A directory of prepared modules, each stored as bitcode under a hash
+  /// of everything that went into preparing it: the linked modules, the
+  /// runtime libraries and the options that change the preparation.
+  ///
+  /// Inputs are added to the key before the first load() or store(). The
+  /// key does not cover KLEE itself, so the directory should be emptied
+  /// when KLEE is updated.
+  class ModuleCache {
+    std::string directory;
+    llvm::MD5 hasher;
+    std::string key;
+
+    const std::string &getKey();
+    std::string getPath();
+
+  public:
+    explicit ModuleCache(const std::string &directory);
+
+    /// Add the bitcode of \p m to the key.
+    void addModule(const llvm::Module &m);
+    /// Add the contents of the file at \p path to the key.
+    /// \return False if the file could not be read.
+    bool addFile(const std::string &path);
+    /// Add \p value, such as an option value, to the key.
+    void addString(llvm::StringRef value);
+
+    /// \return The module stored under the key, or null if there is none.
+    std::unique_ptr<llvm::Module> load(llvm::LLVMContext &context);
+
+    /// Store \p m under the key. Failures only produce a warning.
+    void store(const llvm::Module &m);
+  };
+}
+
+#endif /* KLEE_MODULECACHE_H */
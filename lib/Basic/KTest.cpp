@@ -9,9 +9,14 @@
 
 #include "klee/ADT/KTest.h"
 
+#include <fcntl.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #define KTEST_VERSION 3
 #define KTEST_MAGIC_SIZE 5
@@ -20,6 +25,12 @@
 // for compatibility reasons
 #define BOUT_MAGIC "BOUT\n"
 
+/* A bundle is a header, an index of (name, offset, size) entries and the
+ * ktest files at those offsets, stored back to back. */
+#define KTEST_BUNDLE_VERSION 1
+#define KTEST_BUNDLE_MAGIC_SIZE 8
+#define KTEST_BUNDLE_MAGIC "KTBUNDLE"
+
 /***/
 
 static int read_uint32(FILE *f, unsigned *value_out) {
@@ -61,6 +72,79 @@ static int write_string(FILE *f, const char *value) {
   return 1;
 }
 
+static int write_uint64(FILE *f, uint64_t value) {
+  return write_uint32(f, value>>32) && write_uint32(f, value);
+}
+
+/* Reads from memory, failing rather than reading past the end. */
+typedef struct {
+  const unsigned char *pos;
+  const unsigned char *end;
+} Cursor;
+
+static int cursor_bytes(Cursor *c, size_t len,
+                        const unsigned char **bytes_out) {
+  if ((size_t) (c->end - c->pos) < len)
+    return 0;
+  *bytes_out = c->pos;
+  c->pos += len;
+  return 1;
+}
+
+static int cursor_uint32(Cursor *c, unsigned *value_out) {
+  const unsigned char *data;
+  if (!cursor_bytes(c, 4, &data))
+    return 0;
+  *value_out = (((((data[0]<<8) + data[1])<<8) + data[2])<<8) + data[3];
+  return 1;
+}
+
+static int cursor_uint64(Cursor *c, uint64_t *value_out) {
+  unsigned high, low;
+  if (!cursor_uint32(c, &high) || !cursor_uint32(c, &low))
+    return 0;
+  *value_out = ((uint64_t) high<<32) | low;
+  return 1;
+}
+
+static int cursor_string(Cursor *c, const unsigned char **start_out,
+                         unsigned *len_out) {
+  return cursor_uint32(c, len_out) && cursor_bytes(c, *len_out, start_out);
+}
+
+/* Copies a string to *strings and advances *strings past its NUL. */
+static char *copy_string(char **strings, const unsigned char *start,
+                         unsigned len) {
+  char *res = *strings;
+  memcpy(res, start, len);
+  res[len] = 0;
+  *strings += len + 1;
+  return res;
+}
+
+static int map_file(const char *path, unsigned char **data_out,
+                    size_t *size_out) {
+  struct stat st;
+  void *data;
+  int fd = open(path, O_RDONLY);
+
+  if (fd < 0)
+    return 0;
+  if (fstat(fd, &st) || st.st_size == 0) {
+    close(fd);
+    return 0;
+  }
+  /* Private and writable, so that users may modify the object bytes
+   * without affecting the file. */
+  data = mmap(0, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return 0;
+  *data_out = (unsigned char*) data;
+  *size_out = st.st_size;
+  return 1;
+}
+
 /***/
 
 
@@ -175,12 +259,9 @@ KTest *kTest_fromFile(const char *path) {
   return 0;
 }
 
-int kTest_toFile(KTest *bo, const char *path) {
-  FILE *f = fopen(path, "wb");
+static int write_ktest(FILE *f, KTest *bo) {
   unsigned i;
 
-  if (!f) 
-    goto error;
   if (fwrite(KTEST_MAGIC, strlen(KTEST_MAGIC), 1, f)!=1)
     goto error;
   if (!write_uint32(f, KTEST_VERSION))
@@ -210,15 +291,34 @@ int kTest_toFile(KTest *bo, const char *path) {
       goto error;
   }
 
-  fclose(f);
-
   return 1;
  error:
-  if (f) fclose(f);
-  
   return 0;
 }
 
+/* The number of bytes write_ktest writes for bo. */
+static uint64_t ktest_size(KTest *bo) {
+  uint64_t res = KTEST_MAGIC_SIZE + 4 * 5;
+  unsigned i;
+  for (i=0; i<bo->numArgs; i++)
+    res += 4 + strlen(bo->args[i]);
+  for (i=0; i<bo->numObjects; i++)
+    res += 4 + strlen(bo->objects[i].name) + 4 + bo->objects[i].numBytes;
+  return res;
+}
+
+int kTest_toFile(KTest *bo, const char *path) {
+  FILE *f = fopen(path, "wb");
+
+  if (!f)
+    return 0;
+  if (!write_ktest(f, bo)) {
+    fclose(f);
+    return 0;
+  }
+  return fclose(f) == 0;
+}
+
 unsigned kTest_numBytes(KTest *bo) {
   unsigned i, res = 0;
   for (i=0; i<bo->numObjects; i++)
@@ -238,3 +338,265 @@ void kTest_free(KTest *bo) {
   free(bo->objects);
   free(bo);
 }
+
+/***/
+
+/* Walks the ktest file image at c. The first walk only checks the image
+ * and fills in the counts of res and the number of string bytes; the
+ * second, with res->args and res->objects allocated, fills in the rest,
+ * copying the strings to strings. */
+static int walk_ktest(Cursor c, KTest *res, int fill, char *strings,
+                      size_t *string_bytes_out) {
+  const unsigned char *start;
+  unsigned i, len, version, numArgs, numObjects;
+  size_t string_bytes = 0;
+
+  if (!cursor_bytes(&c, KTEST_MAGIC_SIZE, &start))
+    return 0;
+  if (memcmp(start, KTEST_MAGIC, KTEST_MAGIC_SIZE) &&
+      memcmp(start, BOUT_MAGIC, KTEST_MAGIC_SIZE))
+    return 0;
+
+  if (!cursor_uint32(&c, &version))
+    return 0;
+  if (version > kTest_getCurrentVersion())
+    return 0;
+  res->version = version;
+
+  if (!cursor_uint32(&c, &numArgs))
+    return 0;
+  res->numArgs = numArgs;
+  for (i=0; i<numArgs; i++) {
+    if (!cursor_string(&c, &start, &len))
+      return 0;
+    if (fill)
+      res->args[i] = copy_string(&strings, start, len);
+    string_bytes += len + 1;
+  }
+
+  if (version >= 2) {
+    if (!cursor_uint32(&c, &res->symArgvs))
+      return 0;
+    if (!cursor_uint32(&c, &res->symArgvLen))
+      return 0;
+  }
+
+  if (!cursor_uint32(&c, &numObjects))
+    return 0;
+  res->numObjects = numObjects;
+  for (i=0; i<numObjects; i++) {
+    KTestObject *o = fill ? &res->objects[i] : 0;
+    unsigned numBytes;
+    if (!cursor_string(&c, &start, &len))
+      return 0;
+    if (fill)
+      o->name = copy_string(&strings, start, len);
+    string_bytes += len + 1;
+    if (!cursor_uint32(&c, &numBytes))
+      return 0;
+    if (!cursor_bytes(&c, numBytes, &start))
+      return 0;
+    if (fill) {
+      o->numBytes = numBytes;
+      o->bytes = (unsigned char*) start;
+    }
+  }
+
+  *string_bytes_out = string_bytes;
+  return 1;
+}
+
+/* Parses a ktest file image into a single allocation holding the KTest,
+ * its arrays and its strings; the object bytes stay in the image. */
+static KTest *parse_ktest(const unsigned char *data, size_t size) {
+  Cursor c = { data, data + size };
+  KTest counts, *res;
+  size_t string_bytes;
+  char *block;
+
+  memset(&counts, 0, sizeof(counts));
+  if (!walk_ktest(c, &counts, 0, 0, &string_bytes))
+    return 0;
+
+  block = (char*) malloc(sizeof(KTest) + counts.numArgs * sizeof(char*) +
+                         counts.numObjects * sizeof(KTestObject) +
+                         string_bytes);
+  if (!block)
+    return 0;
+  res = (KTest*) block;
+  *res = counts;
+  res->args = (char**) (block + sizeof(KTest));
+  res->objects = (KTestObject*) (res->args + counts.numArgs);
+  walk_ktest(c, res, 1, (char*) (res->objects + counts.numObjects),
+             &string_bytes);
+  return res;
+}
+
+typedef struct KTestBundleEntry KTestBundleEntry;
+struct KTestBundleEntry {
+  char *name;
+  uint64_t offset;
+  uint64_t size;
+  KTest *ktest; /* null until parsed */
+  int parsed;
+};
+
+struct KTestBundle {
+  unsigned char *data;
+  size_t size;
+  unsigned numEntries;
+  KTestBundleEntry *entries;
+};
+
+int kTest_isBundleFile(const char *path) {
+  FILE *f = fopen(path, "rb");
+  char header[KTEST_BUNDLE_MAGIC_SIZE];
+  int res;
+
+  if (!f)
+    return 0;
+  res = fread(header, KTEST_BUNDLE_MAGIC_SIZE, 1, f)==1 &&
+        !memcmp(header, KTEST_BUNDLE_MAGIC, KTEST_BUNDLE_MAGIC_SIZE);
+  fclose(f);
+
+  return res;
+}
+
+static int read_bundle_index(KTestBundle *b) {
+  Cursor c = { b->data, b->data + b->size };
+  const unsigned char *start;
+  unsigned i, len, version;
+
+  if (!cursor_bytes(&c, KTEST_BUNDLE_MAGIC_SIZE, &start))
+    return 0;
+  if (!cursor_uint32(&c, &version) || version > KTEST_BUNDLE_VERSION)
+    return 0;
+  if (!cursor_uint32(&c, &b->numEntries))
+    return 0;
+  /* every entry takes at least 20 bytes of the index */
+  if (b->numEntries > b->size / 20)
+    return 0;
+
+  b->entries = (KTestBundleEntry*) calloc(b->numEntries ? b->numEntries : 1,
+                                          sizeof(*b->entries));
+  if (!b->entries)
+    return 0;
+  for (i=0; i<b->numEntries; i++) {
+    KTestBundleEntry *e = &b->entries[i];
+    if (!cursor_string(&c, &start, &len))
+      return 0;
+    e->name = (char*) malloc(len + 1);
+    if (!e->name)
+      return 0;
+    memcpy(e->name, start, len);
+    e->name[len] = 0;
+    if (!cursor_uint64(&c, &e->offset) || !cursor_uint64(&c, &e->size))
+      return 0;
+    if (e->offset > b->size || e->size > b->size - e->offset)
+      return 0;
+  }
+  return 1;
+}
+
+KTestBundle *kTestBundle_open(const char *path) {
+  KTestBundle *b = (KTestBundle*) calloc(1, sizeof(*b));
+
+  if (!b)
+    return 0;
+  if (!map_file(path, &b->data, &b->size)) {
+    free(b);
+    return 0;
+  }
+
+  if (b->size >= KTEST_BUNDLE_MAGIC_SIZE &&
+      !memcmp(b->data, KTEST_BUNDLE_MAGIC, KTEST_BUNDLE_MAGIC_SIZE)) {
+    if (!read_bundle_index(b))
+      goto error;
+  } else {
+    b->numEntries = 1;
+    b->entries = (KTestBundleEntry*) calloc(1, sizeof(*b->entries));
+    if (!b->entries)
+      goto error;
+    b->entries[0].name = strdup(path);
+    if (!b->entries[0].name)
+      goto error;
+    b->entries[0].size = b->size;
+  }
+  return b;
+
+ error:
+  kTestBundle_close(b);
+  return 0;
+}
+
+unsigned kTestBundle_size(KTestBundle *b) {
+  return b->numEntries;
+}
+
+const char *kTestBundle_getName(KTestBundle *b, unsigned i) {
+  return i < b->numEntries ? b->entries[i].name : 0;
+}
+
+KTest *kTestBundle_getKTest(KTestBundle *b, unsigned i) {
+  KTestBundleEntry *e;
+
+  if (i >= b->numEntries)
+    return 0;
+  e = &b->entries[i];
+  if (!e->parsed) {
+    e->ktest = parse_ktest(b->data + e->offset, e->size);
+    e->parsed = 1;
+  }
+  return e->ktest;
+}
+
+void kTestBundle_close(KTestBundle *b) {
+  unsigned i;
+  if (b->entries) {
+    for (i=0; i<b->numEntries; i++) {
+      free(b->entries[i].name);
+      free(b->entries[i].ktest);
+    }
+    free(b->entries);
+  }
+  munmap(b->data, b->size);
+  free(b);
+}
+
+int kTest_toBundle(KTest **bos, const char **names, unsigned n,
+                   const char *path) {
+  FILE *f = fopen(path, "wb");
+  uint64_t offset;
+  unsigned i;
+
+  if (!f)
+    goto error;
+  if (fwrite(KTEST_BUNDLE_MAGIC, KTEST_BUNDLE_MAGIC_SIZE, 1, f)!=1)
+    goto error;
+  if (!write_uint32(f, KTEST_BUNDLE_VERSION))
+    goto error;
+  if (!write_uint32(f, n))
+    goto error;
+
+  offset = KTEST_BUNDLE_MAGIC_SIZE + 4 + 4;
+  for (i=0; i<n; i++)
+    offset += 4 + strlen(names[i]) + 8 + 8;
+  for (i=0; i<n; i++) {
+    uint64_t size = ktest_size(bos[i]);
+    if (!write_string(f, names[i]))
+      goto error;
+    if (!write_uint64(f, offset) || !write_uint64(f, size))
+      goto error;
+    offset += size;
+  }
+
+  for (i=0; i<n; i++)
+    if (!write_ktest(f, bos[i]))
+      goto error;
+
+  return fclose(f) == 0;
+ error:
+  if (f) fclose(f);
+
+  return 0;
+}
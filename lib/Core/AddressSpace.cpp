@@ -15,21 +15,40 @@
 
 #include "klee/Expr/Expr.h"
 #include "klee/Statistics/TimerStatIncrementer.h"
+#include "klee/Support/OptionCategories.h"
 
 #include "CoreStats.h"
+#include "Profiler.h"
 
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+
+using namespace llvm;
 using namespace klee;
 
+namespace {
+cl::opt<unsigned> ResolveSegmentThreshold(
+    "resolve-segment-threshold",
+    cl::desc("Resolve symbolic pointers by bisecting the address space into "
+             "segments, with one query per segment, when it holds more than "
+             "this many objects. Set to 0 to always query each object in "
+             "turn (default=64)"),
+    cl::init(64), cl::cat(SolvingCat));
+}
+
 ///
 
 void AddressSpace::bindObject(const MemoryObject *mo, ObjectState *os) {
   assert(os->copyOnWriteOwner==0 && "object already has owner");
   os->copyOnWriteOwner = cowKey;
   objects = objects.replace(std::make_pair(mo, os));
+  index.reset();
 }
 
 void AddressSpace::unbindObject(const MemoryObject *mo) {
   objects = objects.remove(mo);
+  index.reset();
 }
 
 const ObjectState *AddressSpace::findObject(const MemoryObject *mo) const {
@@ -84,6 +103,7 @@ bool AddressSpace::resolveOne(ExecutionState &state,
     return true;
   } else {
     TimerStatIncrementer timer(stats::resolveTime);
+    profiler::PhaseScope phase(profiler::Phase::Resolve);
 
     MemoryObject *symHack = nullptr;
     for (auto &moa : state.symbolics) {
@@ -123,7 +143,38 @@ bool AddressSpace::resolveOne(ExecutionState &state,
     }
 
     // didn't work, now we have to search
-       
+
+    if (ResolveSegmentThreshold &&
+        getIndex().objects.size() > ResolveSegmentThreshold) {
+      auto check = [&](const ObjectPair &op) {
+        bool mayBeTrue;
+        if (!solver->mayBeTrue(state.constraints,
+                               op.first->getBoundsCheckPointer(address),
+                               mayBeTrue, state.queryMetaData))
+          return 1;
+        if (!mayBeTrue)
+          return 2;
+        result = op;
+        return 0;
+      };
+
+      const AddressIndex &segments = getIndex();
+      int found = 2;
+      for (const MemoryObject *mo : segments.symbolicBases) {
+        found = check(std::make_pair(mo, findObject(mo)));
+        if (found != 2)
+          break;
+      }
+      if (found == 2)
+        found = searchSegments(state, solver, address, segments, 0,
+                               segments.objects.size(), check, time::Span(),
+                               timer);
+      if (found == 1)
+        return false;
+      success = found == 0;
+      return true;
+    }
+
     MemoryMap::iterator oi = objects.upper_bound(&hack);
     MemoryMap::iterator begin = objects.begin();
     MemoryMap::iterator end = objects.end();
@@ -222,6 +273,104 @@ int AddressSpace::checkPointerInObject(ExecutionState &state,
   return 2;
 }
 
+const AddressIndex &AddressSpace::getIndex() const {
+  if (index)
+    return *index;
+
+  auto newIndex = std::make_shared<AddressIndex>();
+  uint64_t spanEnd = 0;
+  for (const auto &binding : objects) {
+    const MemoryObject *mo = binding.first;
+    if (mo->isLazyInstantiated()) {
+      newIndex->symbolicBases.push_back(mo);
+      continue;
+    }
+    // zero-sized objects still occupy their address
+    spanEnd = std::max(spanEnd, mo->address + std::max<uint64_t>(mo->size, 1));
+    newIndex->objects.push_back(mo);
+    newIndex->spanEnds.push_back(spanEnd);
+  }
+  index = newIndex;
+  return *index;
+}
+
+int AddressSpace::searchSegments(ExecutionState &state, TimingSolver *solver,
+                                 ref<Expr> p, const AddressIndex &index,
+                                 size_t begin, size_t end,
+                                 const ObjectCheck &check, time::Span timeout,
+                                 const TimerStatIncrementer &timer) const {
+  if (begin >= end)
+    return 2;
+  if (timeout && timeout < timer.delta())
+    return 1;
+
+  const MemoryObject *first = index.objects[begin];
+  if (end - begin == 1)
+    return check(std::make_pair(first, findObject(first)));
+
+  ref<Expr> inSegment = AndExpr::create(
+      UgeExpr::create(p, first->getBaseConstantExpr()),
+      UltExpr::create(p, ConstantExpr::create(index.spanEnds[end - 1],
+                                              p->getWidth())));
+  bool mayBeTrue;
+  if (!solver->mayBeTrue(state.constraints, inSegment, mayBeTrue,
+                         state.queryMetaData))
+    return 1;
+  if (!mayBeTrue)
+    return 2;
+
+  size_t mid = begin + (end - begin) / 2;
+  int result =
+      searchSegments(state, solver, p, index, begin, mid, check, timeout, timer);
+  if (result != 2)
+    return result;
+  return searchSegments(state, solver, p, index, mid, end, check, timeout,
+                        timer);
+}
+
+bool AddressSpace::resolveInSegments(ExecutionState &state,
+                                     TimingSolver *solver, ref<Expr> p,
+                                     uint64_t example, ResolutionList &rl,
+                                     unsigned maxResolutions,
+                                     time::Span timeout,
+                                     const TimerStatIncrementer &timer) const {
+  auto check = [&](const ObjectPair &op) {
+    return checkPointerInObject(state, solver, p, op, rl, maxResolutions);
+  };
+  const AddressIndex &segments = getIndex();
+  const auto &indexed = segments.objects;
+
+  // As when walking the map, the object the example points into is checked
+  // first, so that an in-bounds pointer takes the fast path.
+  size_t exampleEnd =
+      std::upper_bound(indexed.begin(), indexed.end(), example,
+                       [](uint64_t address, const MemoryObject *mo) {
+                         return address < mo->address;
+                       }) -
+      indexed.begin();
+  int result = 2;
+  if (exampleEnd) {
+    const MemoryObject *mo = indexed[exampleEnd - 1];
+    result = check(std::make_pair(mo, findObject(mo)));
+  }
+
+  for (const MemoryObject *mo : segments.symbolicBases) {
+    if (result != 2)
+      break;
+    if (timeout && timeout < timer.delta())
+      return true;
+    result = check(std::make_pair(mo, findObject(mo)));
+  }
+
+  if (result == 2 && exampleEnd > 1)
+    result = searchSegments(state, solver, p, segments, 0, exampleEnd - 1,
+                            check, timeout, timer);
+  if (result == 2)
+    result = searchSegments(state, solver, p, segments, exampleEnd,
+                            indexed.size(), check, timeout, timer);
+  return result == 1;
+}
+
 bool AddressSpace::resolve(ExecutionState &state, TimingSolver *solver,
                            ref<Expr> p, ResolutionList &rl,
                            unsigned maxResolutions, time::Span timeout) const {
@@ -232,6 +381,7 @@ bool AddressSpace::resolve(ExecutionState &state, TimingSolver *solver,
     return false;
   } else {
     TimerStatIncrementer timer(stats::resolveTime);
+    profiler::PhaseScope phase(profiler::Phase::Resolve);
 
     MemoryObject *symHack = nullptr;
     for (auto &moa : state.symbolics) {
@@ -268,6 +418,12 @@ bool AddressSpace::resolve(ExecutionState &state, TimingSolver *solver,
     if (!solver->getValue(state.constraints, p, cex, state.queryMetaData))
       return true;
     uint64_t example = cex->getZExtValue();
+
+    if (ResolveSegmentThreshold &&
+        getIndex().objects.size() > ResolveSegmentThreshold)
+      return resolveInSegments(state, solver, p, example, rl, maxResolutions,
+                               timeout, timer);
+
     MemoryObject hack(example);
 
     MemoryMap::iterator oi = objects.upper_bound(&hack);
@@ -335,6 +491,7 @@ bool AddressSpace::fastResolve(ExecutionState &state, TimingSolver *solver,
     return false;
   } else {
     TimerStatIncrementer timer(stats::resolveTime);
+    profiler::PhaseScope phase(profiler::Phase::Resolve);
 
     MemoryObject *symHack = nullptr;
     for (auto &moa : state.symbolics) {
@@ -454,6 +611,13 @@ void AddressSpace::copyOutConcretes() {
   }
 }
 
+void AddressSpace::getOwnedObjects(std::vector<ObjectState *> &result) const {
+  for (const auto &obj : objects) {
+    if (obj.second->copyOnWriteOwner == cowKey)
+      result.push_back(obj.second.get());
+  }
+}
+
 bool AddressSpace::copyInConcretes() {
   for (auto &obj : objects) {
     const MemoryObject *mo = obj.first;
@@ -485,6 +649,7 @@ bool AddressSpace::copyInConcrete(const MemoryObject *mo, const ObjectState *os,
 
 void AddressSpace::clear() {
   objects.clear();
+  index.reset();
 }
 
 /***/
@@ -16,10 +16,15 @@
 #include "klee/ADT/ImmutableMap.h"
 #include "klee/System/Time.h"
 
+#include <functional>
+#include <memory>
+#include <vector>
+
 namespace klee {
   class ExecutionState;
   class MemoryObject;
   class ObjectState;
+  class TimerStatIncrementer;
   class TimingSolver;
 
   template<class T> class ref;
@@ -35,6 +40,19 @@ namespace klee {
   typedef ImmutableMap<const MemoryObject *, ref<ObjectState>, MemoryObjectLT>
       MemoryMap;
 
+  /// An interval index over the objects of an address space, used to
+  /// resolve symbolic pointers by bisecting the address space into
+  /// segments instead of querying each object.
+  struct AddressIndex {
+    /// The objects with a concrete base address, ordered by address.
+    std::vector<const MemoryObject *> objects;
+    /// spanEnds[i] is the largest end address of objects[0, i], so that
+    /// [objects[i]->address, spanEnds[j]) covers objects[i, j].
+    std::vector<uint64_t> spanEnds;
+    /// The lazily instantiated objects, whose base is symbolic.
+    std::vector<const MemoryObject *> symbolicBases;
+  };
+
   class AddressSpace {
   private:
     /// Epoch counter used to control ownership of objects.
@@ -54,6 +72,35 @@ namespace klee {
                              ref<Expr> p, const ObjectPair &op,
                              ResolutionList &rl, unsigned maxResolutions) const;
 
+    /// The interval index of `objects`, built on demand and shared
+    /// between copies until an object is bound or unbound.
+    mutable std::shared_ptr<const AddressIndex> index;
+
+    const AddressIndex &getIndex() const;
+
+    /// Called for each object `p` may point into, with the result
+    /// convention of checkPointerInObject.
+    typedef std::function<int(const ObjectPair &)> ObjectCheck;
+
+    /// Find the objects in index.objects[begin, end) that `p` may point
+    /// into: a segment is only split, and its objects only checked, if
+    /// `p` may point into the interval it spans.
+    ///
+    /// \return 0 or 1 as soon as `check` does or a query fails or times
+    /// out (1), and 2 otherwise.
+    int searchSegments(ExecutionState &state, TimingSolver *solver,
+                       ref<Expr> p, const AddressIndex &index, size_t begin,
+                       size_t end, const ObjectCheck &check,
+                       time::Span timeout,
+                       const TimerStatIncrementer &timer) const;
+
+    /// resolve() through the interval index, starting with the object
+    /// the example address `example` of `p` points into.
+    bool resolveInSegments(ExecutionState &state, TimingSolver *solver,
+                           ref<Expr> p, uint64_t example, ResolutionList &rl,
+                           unsigned maxResolutions, time::Span timeout,
+                           const TimerStatIncrementer &timer) const;
+
   public:
     /// The MemoryObject -> ObjectState map that constitutes the
     /// address space.
@@ -65,7 +112,8 @@ namespace klee {
     MemoryMap objects;
 
     AddressSpace() : cowKey(1) {}
-    AddressSpace(const AddressSpace &b) : cowKey(++b.cowKey), objects(b.objects) { }
+    AddressSpace(const AddressSpace &b)
+        : cowKey(++b.cowKey), index(b.index), objects(b.objects) {}
     ~AddressSpace() {}
 
     /// Resolve address to an ObjectPair in result.
@@ -155,6 +203,10 @@ namespace klee {
     bool copyInConcrete(const MemoryObject *mo, const ObjectState *os,
                         uint64_t src_address);
 
+    /// Collect the object states that no other address space refers to,
+    /// i.e. those written since this address space was last copied.
+    void getOwnedObjects(std::vector<ObjectState *> &result) const;
+
     void clear();
   };
 } // End klee namespace
@@ -0,0 +1,165 @@
+//===-- AutoMerge.cpp -----------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "AutoMerge.h"
+
+#include "klee/Module/KInstruction.h"
+#include "klee/Module/KModule.h"
+
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <set>
+#include <vector>
+
+using namespace klee;
+using namespace llvm;
+
+namespace {
+/// Branches are assumed to be executed this many times per level of loop
+/// nesting around them.
+const double loopFactor = 8;
+const unsigned maxLoopDepth = 3;
+
+/// The condition a symbolic branch would query, if \p bb ends in one.
+Value *getBranchCondition(BasicBlock &bb) {
+  Instruction *term = bb.getTerminator();
+  if (auto *bi = dyn_cast<BranchInst>(term))
+    return bi->isConditional() ? bi->getCondition() : nullptr;
+  if (auto *si = dyn_cast<SwitchInst>(term))
+    return si->getNumCases() ? si->getCondition() : nullptr;
+  return nullptr;
+}
+
+/// The branches reachable from a join block, with their expected number of
+/// executions.
+struct ReachableQueries {
+  std::vector<std::pair<Value *, double>> conditions;
+  double total = 0;
+};
+
+ReachableQueries findReachableQueries(BasicBlock *join, const LoopInfo &li) {
+  ReachableQueries result;
+  std::set<BasicBlock *> visited;
+  std::vector<BasicBlock *> worklist{join};
+  while (!worklist.empty()) {
+    BasicBlock *bb = worklist.back();
+    worklist.pop_back();
+    if (!visited.insert(bb).second)
+      continue;
+
+    if (Value *condition = getBranchCondition(*bb)) {
+      double weight = std::pow(
+          loopFactor, std::min(li.getLoopDepth(bb), maxLoopDepth));
+      result.conditions.emplace_back(condition, weight);
+      result.total += weight;
+    }
+    for (BasicBlock *succ : successors(bb))
+      worklist.push_back(succ);
+  }
+  return result;
+}
+
+/// All instructions computed from \p v, directly or not.
+std::set<const Value *> getDependents(Value *v) {
+  std::set<const Value *> dependents{v};
+  std::vector<Value *> worklist{v};
+  while (!worklist.empty()) {
+    Value *cur = worklist.back();
+    worklist.pop_back();
+    for (User *user : cur->users())
+      if (isa<Instruction>(user) && dependents.insert(user).second)
+        worklist.push_back(user);
+  }
+  return dependents;
+}
+
+bool hasDifferingValues(const PHINode &phi) {
+  for (unsigned i = 1, e = phi.getNumIncomingValues(); i < e; ++i)
+    if (phi.getIncomingValue(i) != phi.getIncomingValue(0))
+      return true;
+  return false;
+}
+} // namespace
+
+KInstruction *AutoMergePoints::getJoin(const KFunction &kf,
+                                       const KInstruction *branch) {
+  auto it = functions.find(&kf);
+  if (it == functions.end()) {
+    it = functions.emplace(&kf, JoinMap()).first;
+    analyze(kf, it->second);
+  }
+
+  auto join = it->second.find(branch);
+  return join == it->second.end() ? nullptr : join->second;
+}
+
+void AutoMergePoints::analyze(const KFunction &kf, JoinMap &joins) const {
+  Function &f = *kf.function;
+  if (f.isDeclaration())
+    return;
+
+  PostDominatorTree pdt;
+  pdt.recalculate(f);
+  DominatorTree dt(f);
+  LoopInfo li(dt);
+
+  // Branches sharing a join block share its estimate.
+  std::map<BasicBlock *, bool> worthMerging;
+
+  for (BasicBlock &bb : f) {
+    if (!getBranchCondition(bb))
+      continue;
+    DomTreeNode *node = pdt.getNode(&bb);
+    if (!node || !node->getIDom())
+      continue;
+    BasicBlock *join = node->getIDom()->getBlock();
+    // null for the virtual exit of functions with several returns
+    if (!join || join == &bb)
+      continue;
+
+    auto estimate = worthMerging.find(join);
+    if (estimate == worthMerging.end()) {
+      ReachableQueries queries = findReachableQueries(join, li);
+      bool worth = true;
+      for (PHINode &phi : join->phis()) {
+        if (!hasDifferingValues(phi))
+          continue;
+        std::set<const Value *> dependents = getDependents(&phi);
+        double hotQueries = 0;
+        for (const auto &query : queries.conditions)
+          if (dependents.count(query.first))
+            hotQueries += query.second;
+        if (hotQueries > threshold * queries.total) {
+          worth = false;
+          break;
+        }
+      }
+      estimate = worthMerging.emplace(join, worth).first;
+    }
+    if (!estimate->second)
+      continue;
+
+    Instruction *first = join->getFirstNonPHI();
+    if (first->isEHPad())
+      continue;
+    auto branch = kf.instructionMap.find(bb.getTerminator());
+    auto target = kf.instructionMap.find(first);
+    if (branch != kf.instructionMap.end() &&
+        target != kf.instructionMap.end())
+      joins.emplace(branch->second, target->second);
+  }
+}
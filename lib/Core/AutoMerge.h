@@ -0,0 +1,52 @@
+//===-- AutoMerge.h ---------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_AUTOMERGE_H
+#define KLEE_AUTOMERGE_H
+
+#include <unordered_map>
+
+namespace klee {
+  struct KFunction;
+  struct KInstruction;
+
+  /// Chooses the join points at which the states forked by a branch are
+  /// merged automatically (see --auto-merge).
+  ///
+  /// States forked by a branch meet again at the immediate post-dominator of
+  /// the branch. Merging them there trades the paths for states in which
+  /// the values that differ between the paths become symbolic, so every
+  /// later query depending on those values gets harder. Following the query
+  /// count estimation of Kuznetsov et al. ("Efficient State Merging in
+  /// Symbolic Execution", PLDI 2012), a join point is used only if none of
+  /// the values that differ there (the PHI nodes of the join block) is
+  /// "hot": a condition of more than a fraction of the branches reachable
+  /// from the join, with branches in loops weighted by their loop depth.
+  /// Values only passed through memory are not tracked.
+  class AutoMergePoints {
+    /// Fraction of the expected queries above which a value is hot.
+    double threshold;
+
+    /// Branch to the first non-PHI instruction of its join block, for all
+    /// branches of the analysed functions worth merging.
+    typedef std::unordered_map<const KInstruction *, KInstruction *> JoinMap;
+    std::unordered_map<const KFunction *, JoinMap> functions;
+
+    void analyze(const KFunction &kf, JoinMap &joins) const;
+
+  public:
+    explicit AutoMergePoints(double threshold) : threshold(threshold) {}
+
+    /// \return The instruction at which the states forked by \p branch in
+    /// \p kf should be merged, or null if they should not.
+    KInstruction *getJoin(const KFunction &kf, const KInstruction *branch);
+  };
+}
+
+#endif /* KLEE_AUTOMERGE_H */
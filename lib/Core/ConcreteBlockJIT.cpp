@@ -0,0 +1,192 @@
+//===-- ConcreteBlockJIT.cpp ----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ConcreteBlockJIT.h"
+
+#include "ExternalDispatcher.h"
+
+#include "klee/Module/KInstruction.h"
+#include "klee/Module/KModule.h"
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+
+#include <unordered_map>
+
+using namespace klee;
+using namespace llvm;
+
+namespace {
+/// Shorter runs are not worth leaving the interpreter for.
+const unsigned minSegmentLength = 3;
+
+bool isWordType(const Type *type) {
+  return type->isIntegerTy() && type->getIntegerBitWidth() <= 64;
+}
+
+/// Whether \p inst only computes a register from other registers, with the
+/// same result natively as by the interpreter.
+bool isNative(const Instruction &inst) {
+  switch (inst.getOpcode()) {
+  case Instruction::Add:
+  case Instruction::Sub:
+  case Instruction::Mul:
+  case Instruction::And:
+  case Instruction::Or:
+  case Instruction::Xor:
+  case Instruction::Shl:
+  case Instruction::LShr:
+  case Instruction::AShr:
+  case Instruction::ICmp:
+  case Instruction::Trunc:
+  case Instruction::ZExt:
+  case Instruction::SExt:
+  case Instruction::Select:
+    break;
+  default:
+    return false;
+  }
+
+  if (!isWordType(inst.getType()))
+    return false;
+  for (const Use &op : inst.operands())
+    if (!isWordType(op->getType()))
+      return false;
+  return true;
+}
+} // namespace
+
+ConcreteBlockJIT::Segment *ConcreteBlockJIT::getSegment(KInstruction *ki) {
+  auto it = segments.find(ki);
+  if (it != segments.end())
+    return &it->second;
+  if (!analyzedBlocks.insert(ki->parent).second)
+    return nullptr;
+
+  analyze(*ki->parent);
+  it = segments.find(ki);
+  return it == segments.end() ? nullptr : &it->second;
+}
+
+ConcreteBlockJIT::NativeCode ConcreteBlockJIT::getCode(Segment &segment) {
+  if (!segment.code && ++segment.executions >= threshold)
+    segment.code = compile(segment);
+  return segment.code;
+}
+
+void ConcreteBlockJIT::analyze(const KBlock &kb) {
+  unsigned i = 0;
+  while (i < kb.numInstructions) {
+    if (!isNative(*kb.instructions[i]->inst)) {
+      ++i;
+      continue;
+    }
+    unsigned start = i;
+    while (i < kb.numInstructions && isNative(*kb.instructions[i]->inst))
+      ++i;
+    if (i - start < minSegmentLength)
+      continue;
+
+    Segment segment;
+    segment.instructions = kb.instructions + start;
+    segment.length = i - start;
+
+    std::unordered_set<const Value *> defined, read;
+    for (unsigned j = 0; j < segment.length; ++j) {
+      KInstruction *ki = segment.instructions[j];
+      for (unsigned op = 0, e = ki->inst->getNumOperands(); op < e; ++op) {
+        const Value *v = ki->inst->getOperand(op);
+        // Other constants are evaluated by the interpreter, as they may
+        // refer to globals.
+        if (isa<ConstantInt>(v) || defined.count(v))
+          continue;
+        if (read.insert(v).second)
+          segment.inputs.emplace_back(ki, op);
+      }
+      defined.insert(ki->inst);
+    }
+
+    for (unsigned j = 0; j < segment.length; ++j) {
+      KInstruction *ki = segment.instructions[j];
+      for (const User *user : ki->inst->users()) {
+        if (!defined.count(user)) {
+          segment.outputs.push_back(ki);
+          break;
+        }
+      }
+    }
+
+    segments.emplace(segment.instructions[0], std::move(segment));
+  }
+}
+
+ConcreteBlockJIT::NativeCode
+ConcreteBlockJIT::compile(const Segment &segment) {
+  LLVMContext &ctx = segment.instructions[0]->inst->getContext();
+  std::string name = "klee_concrete_segment_" + utostr(compiledSegments++);
+  auto module = std::make_unique<Module>(name, ctx);
+  Type *wordTy = Type::getInt64Ty(ctx);
+  Function *f = Function::Create(
+      FunctionType::get(Type::getVoidTy(ctx), {PointerType::getUnqual(wordTy)},
+                        false),
+      GlobalValue::ExternalLinkage, name, module.get());
+  IRBuilder<> builder(BasicBlock::Create(ctx, "entry", f));
+  Value *io = &*f->arg_begin();
+
+  std::unordered_map<const Value *, Value *> values;
+  unsigned slot = 0;
+  for (const auto &input : segment.inputs) {
+    const Value *v = input.first->inst->getOperand(input.second);
+    Value *word = builder.CreateLoad(
+        wordTy, builder.CreateConstGEP1_32(wordTy, io, slot++));
+    values[v] = builder.CreateZExtOrTrunc(word, v->getType());
+  }
+
+  for (unsigned j = 0; j < segment.length; ++j) {
+    Instruction *inst = segment.instructions[j]->inst;
+    Instruction *clone = inst->clone();
+    clone->dropPoisonGeneratingFlags();
+    for (unsigned op = 0, e = clone->getNumOperands(); op < e; ++op) {
+      auto it = values.find(clone->getOperand(op));
+      if (it != values.end())
+        clone->setOperand(op, it->second);
+    }
+    builder.Insert(clone);
+
+    Value *result = clone;
+    if (clone->isShift()) {
+      // Shifting by the width or more is poison in LLVM, but well defined
+      // for KLEE expressions.
+      Type *type = clone->getType();
+      unsigned width = type->getIntegerBitWidth();
+      Value *overflow =
+          inst->getOpcode() == Instruction::AShr
+              ? builder.CreateAShr(clone->getOperand(0), width - 1)
+              : Constant::getNullValue(type);
+      Value *tooFar = builder.CreateICmpUGE(clone->getOperand(1),
+                                            ConstantInt::get(type, width));
+      result = builder.CreateSelect(tooFar, overflow, clone);
+    }
+    values[inst] = result;
+  }
+
+  for (KInstruction *output : segment.outputs)
+    builder.CreateStore(
+        builder.CreateZExtOrTrunc(values[output->inst], wordTy),
+        builder.CreateConstGEP1_32(wordTy, io, slot++));
+  builder.CreateRetVoid();
+
+  return reinterpret_cast<NativeCode>(
+      dispatcher.compileFunction(std::move(module), name));
+}
@@ -0,0 +1,80 @@
+//===-- ConcreteBlockJIT.h --------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_CONCRETEBLOCKJIT_H
+#define KLEE_CONCRETEBLOCKJIT_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace klee {
+  class ExternalDispatcher;
+  struct KBlock;
+  struct KInstruction;
+
+  /// Runs straight-line integer code natively when all of its inputs are
+  /// concrete (see --jit-concrete-blocks).
+  ///
+  /// A segment is a maximal run of instructions within a block that only
+  /// compute integer registers from other registers: arithmetic, bitwise
+  /// operations, shifts, comparisons, integer casts and selects. Segments
+  /// that are executed often are compiled with the MCJIT of the
+  /// ExternalDispatcher into a function that reads the segment inputs from
+  /// and writes its outputs to an array of 64-bit words. Instructions that
+  /// access memory or may fail, such as divisions, are left to the
+  /// interpreter.
+  class ConcreteBlockJIT {
+  public:
+    typedef void (*NativeCode)(std::uint64_t *);
+
+    struct Segment {
+      /// The instructions of the segment, within the instructions of their
+      /// KBlock.
+      KInstruction **instructions;
+      unsigned length;
+      /// The values the segment reads from outside, as an instruction and
+      /// operand index to evaluate them at; stored in io[0, inputs.size()).
+      std::vector<std::pair<KInstruction *, unsigned>> inputs;
+      /// The instructions whose results are used after the segment; stored
+      /// in io[inputs.size(), inputs.size() + outputs.size()).
+      std::vector<KInstruction *> outputs;
+      /// Executions so far, until the segment is compiled.
+      unsigned executions = 0;
+      NativeCode code = nullptr;
+    };
+
+  private:
+    ExternalDispatcher &dispatcher;
+    /// Executions after which a segment is compiled.
+    unsigned threshold;
+    unsigned compiledSegments = 0;
+
+    std::unordered_map<const KInstruction *, Segment> segments;
+    std::unordered_set<const KBlock *> analyzedBlocks;
+
+    void analyze(const KBlock &kb);
+    NativeCode compile(const Segment &segment);
+
+  public:
+    ConcreteBlockJIT(ExternalDispatcher &dispatcher, unsigned threshold)
+        : dispatcher(dispatcher), threshold(threshold) {}
+
+    /// \return The segment starting at \p ki, or null if there is none.
+    Segment *getSegment(KInstruction *ki);
+
+    /// Count an execution of \p segment.
+    /// \return The native code of the segment, or null while it is not hot
+    /// enough to be compiled.
+    NativeCode getCode(Segment &segment);
+  };
+}
+
+#endif /* KLEE_CONCRETEBLOCKJIT_H */
@@ -79,7 +79,7 @@ ExecutionState::ExecutionState(KFunction *kf) :
     prevPC(nullptr),
     incomingBBIndex(-1),
     depth(0),
-    ptreeNode(nullptr),
+    ptreeNode(PTreeNode::none),
     steppedInstructions(0),
     steppedMemoryInstructions(0),
     instsSinceCovNew(0),
@@ -96,7 +96,7 @@ ExecutionState::ExecutionState(KFunction *kf, KBlock *kb) :
     prevPC(pc),
     incomingBBIndex(-1),
     depth(0),
-    ptreeNode(nullptr),
+    ptreeNode(PTreeNode::none),
     steppedInstructions(0),
     steppedMemoryInstructions(0),
     instsSinceCovNew(0),
@@ -127,6 +127,8 @@ ExecutionState::ExecutionState(const ExecutionState& state):
     level(state.level),
     addressSpace(state.addressSpace),
     constraints(state.constraints),
+    gepExprBases(state.gepExprBases),
+    model(state.model),
     pathOS(state.pathOS),
     symPathOS(state.symPathOS),
     coveredLines(state.coveredLines),
@@ -345,6 +347,8 @@ bool ExecutionState::merge(const ExecutionState &b) {
     StackFrame &af = *itA;
     const StackFrame &bf = *itB;
     for (unsigned i=0; i<af.kf->numRegisters; i++) {
+      af.locals[i].materialize();
+      bf.locals[i].materialize();
       ref<Expr> &av = af.locals[i].value;
       const ref<Expr> &bv = bf.locals[i].value;
       if (!av || !bv) {
@@ -374,6 +378,7 @@ bool ExecutionState::merge(const ExecutionState &b) {
   }
 
   constraints = ConstraintSet();
+  model = nullptr;
 
   ConstraintManager m(constraints);
   for (const auto &constraint : commonConstraints)
@@ -405,7 +410,7 @@ void ExecutionState::dumpStack(llvm::raw_ostream &out) const {
 
       out << ai->getName().str();
       // XXX should go through function
-      ref<Expr> value = sf.locals[sf.kf->getArgRegister(index++)].value;
+      ref<Expr> value = sf.locals[sf.kf->getArgRegister(index++)].getValue();
       if (isa_and_nonnull<ConstantExpr>(value))
         out << "=" << value;
     }
@@ -420,6 +425,13 @@ void ExecutionState::dumpStack(llvm::raw_ostream &out) const {
 void ExecutionState::addConstraint(ref<Expr> e) {
   ConstraintManager c(constraints);
   c.addConstraint(e);
+
+  // Keep the model only while it is known to satisfy the constraints.
+  if (model) {
+    ref<Expr> value = AssignmentEvaluator(*model).visit(e);
+    if (!isa<ConstantExpr>(value) || !cast<ConstantExpr>(value)->isTrue())
+      model = nullptr;
+  }
 }
 
 BasicBlock *ExecutionState::getInitPCBlock() {
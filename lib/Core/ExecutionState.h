@@ -11,9 +11,12 @@
 #define KLEE_EXECUTIONSTATE_H
 
 #include "AddressSpace.h"
+#include "GEPExprBases.h"
 #include "MergeHandler.h"
+#include "PTree.h"
 
 #include "klee/ADT/TreeStream.h"
+#include "klee/Expr/Assignment.h"
 #include "klee/Expr/Constraints.h"
 #include "klee/Expr/Expr.h"
 #include "klee/Module/KInstIterator.h"
@@ -36,7 +39,6 @@ struct KFunction;
 struct KBlock;
 struct KInstruction;
 class MemoryObject;
-class PTreeNode;
 struct InstructionInfo;
 
 llvm::raw_ostream &operator<<(llvm::raw_ostream &os, const MemoryMap &mm);
@@ -195,6 +197,13 @@ public:
   /// @brief Constraints collected so far
   ConstraintSet constraints;
 
+  /// @brief Bases of the pointers computed by symbolic GEPs (see --use-gep-expr)
+  GEPExprBases gepExprBases;
+
+  /// @brief A model of the constraints found when forking (see
+  /// --fork-models), or null. Shared by the states it is still a model of.
+  std::shared_ptr<const Assignment> model;
+
   /// Statistics and information
 
   /// @brief Metadata utilized and collected by solvers for this state
@@ -211,9 +220,9 @@ public:
   /// @brief Set containing which lines in which files are covered by this state
   std::map<const std::string *, std::set<std::uint32_t>> coveredLines;
 
-  /// @brief Pointer to the process tree of the current state
+  /// @brief Node of the current state in the process tree
   /// Copies of ExecutionState should not copy ptreeNode
-  PTreeNode *ptreeNode = nullptr;
+  PTreeNodeID ptreeNode = PTreeNode::none;
 
   /// @brief Ordered list of symbolics: used to generate test cases.
   //
@@ -9,6 +9,8 @@
 
 #include "Executor.h"
 #include <iostream>
+#include "AutoMerge.h"
+#include "ConcreteBlockJIT.h"
 #include "Context.h"
 #include "CoreStats.h"
 #include "ExecutionState.h"
@@ -18,9 +20,11 @@
 #include "Memory.h"
 #include "MemoryManager.h"
 #include "PTree.h"
+#include "Profiler.h"
 #include "Searcher.h"
 #include "SeedInfo.h"
 #include "SpecialFunctionHandler.h"
+#include "StateSwapper.h"
 #include "StatsTracker.h"
 #include "TimingSolver.h"
 #include "UserSearcher.h"
@@ -40,6 +44,7 @@
 #include "klee/Module/InstructionInfoTable.h"
 #include "klee/Module/KInstruction.h"
 #include "klee/Module/KModule.h"
+#include "klee/Module/ModuleCache.h"
 #include "klee/Solver/Common.h"
 #include "klee/Solver/SolverCmdLine.h"
 #include "klee/Solver/SolverStats.h"
@@ -48,6 +53,7 @@
 #include "klee/Support/ErrorHandling.h"
 #include "klee/Support/FileHandling.h"
 #include "klee/Support/FloatEvaluation.h"
+#include "klee/Support/IntEvaluation.h"
 #include "klee/Support/ModuleUtil.h"
 #include "klee/Support/OptionCategories.h"
 #include "klee/System/MemoryUsage.h"
@@ -66,6 +72,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
@@ -196,6 +203,18 @@ cl::opt<bool>
                                   "querying the solver (default=true)"),
                          cl::cat(SolvingCat));
 
+cl::opt<bool> ForkModels(
+    "fork-models", cl::init(true),
+    cl::desc("Compute a model of each side of a symbolic branch and keep it "
+             "in the state, so that the next branch only queries the side "
+             "the model does not satisfy (default=true)"),
+    cl::cat(SolvingCat));
+cl::opt<std::string> ModuleCacheDir(
+    "module-cache-dir",
+    cl::desc("Directory in which linked and optimized modules are kept "
+             "between runs, keyed by a hash of the input modules, runtime "
+             "libraries and module options (default=off)"),
+    cl::init(""), cl::cat(ModuleCat));
 
 /*** External call policy options ***/
 
@@ -224,6 +243,14 @@ cl::opt<ExternalCallPolicy> ExternalCalls(
     cl::init(ExternalCallPolicy::Concrete),
     cl::cat(ExtCallsCat));
 
+cl::opt<bool> PrecompileExternalStubs(
+    "precompile-external-stubs",
+    cl::init(true),
+    cl::desc("Compile the dispatch stubs of all external call sites when the "
+             "module is loaded rather than on their first call "
+             "(default=true)"),
+    cl::cat(ExtCallsCat));
+
 cl::opt<bool> SuppressExternalWarnings(
     "suppress-external-warnings",
     cl::init(false),
@@ -238,6 +265,23 @@ cl::opt<bool> AllExternalWarnings(
     cl::cat(ExtCallsCat));
 
 
+/*** Native execution options ***/
+
+cl::opt<bool> JITConcreteBlocks(
+    "jit-concrete-blocks",
+    cl::init(false),
+    cl::desc("Compile straight-line integer code to native code and run it "
+             "natively whenever its inputs are concrete (default=false)"),
+    cl::cat(ExecCat));
+
+cl::opt<unsigned> JITConcreteThreshold(
+    "jit-concrete-threshold",
+    cl::init(64),
+    cl::desc("Number of executions after which straight-line code is "
+             "compiled with --jit-concrete-blocks (default=64)"),
+    cl::cat(ExecCat));
+
+
 /*** Seeding options ***/
 
 cl::opt<bool> AlwaysOutputSeeds(
@@ -363,6 +407,14 @@ cl::opt<bool> MaxMemoryInhibit(
     cl::init(true),
     cl::cat(TerminationCat));
 
+cl::opt<bool> SwapStatesAtMemoryCap(
+    "swap-states-at-memory-cap",
+    cl::desc("Above the memory cap (see -max-memory), write the memory of "
+             "states that are not being executed to the output directory "
+             "before terminating states (default=true)"),
+    cl::init(true),
+    cl::cat(TerminationCat));
+
 cl::opt<unsigned> RuntimeMaxStackFrames(
     "max-stack-frames",
     cl::desc("Terminate a state after this many stack frames.  Set to 0 to "
@@ -456,6 +508,13 @@ cl::opt<bool> DebugCheckForImpliedValues(
     cl::desc("Debug the implied value optimization"),
     cl::cat(DebugCat));
 
+cl::opt<unsigned> ProfileSamplingRate(
+    "profile-sampling-rate", cl::init(0),
+    cl::desc("Sample what the interpreter is doing this many times per second "
+             "of CPU time and write the samples to profile.folded, 0 to "
+             "disable (default=0)"),
+    cl::cat(DebugCat));
+
 } // namespace
 
 // XXX hack
@@ -512,7 +571,8 @@ Executor::Executor(LLVMContext &ctx, const InterpreterOptions &opts,
     : Interpreter(opts), interpreterHandler(ih), searcher(0),
       externalDispatcher(new ExternalDispatcher(ctx)), statsTracker(0),
       pathWriter(0), symPathWriter(0), specialFunctionHandler(0), timers{time::Span(TimerInterval)},
-      replayKTest(0), replayPath(0), usingSeeds(0),
+      seedsRemaining(0), recordSensitiveDepths(false), replayKTest(0),
+      replayPath(0), usingSeeds(0),
       atMemoryLimit(false), inhibitForking(false), haltExecution(false),
       ivcEnabled(false), debugLogBuffer(debugBufferString) {
 
@@ -541,6 +601,17 @@ Executor::Executor(LLVMContext &ctx, const InterpreterOptions &opts,
   this->solver = new TimingSolver(solver, EqualitySubstitution);
   memory = new MemoryManager(&arrayCache);
 
+  if (MaxMemory && SwapStatesAtMemoryCap)
+    stateSwapper = std::make_unique<StateSwapper>(
+        interpreterHandler->getOutputFilename("state"));
+
+  if (AutoMerge)
+    autoMergePoints = std::make_unique<AutoMergePoints>(AutoMergeThreshold);
+
+  if (JITConcreteBlocks)
+    concreteBlockJIT = std::make_unique<ConcreteBlockJIT>(
+        *externalDispatcher, JITConcreteThreshold);
+
   initializeSearchOptions();
 
   if (OnlyOutputStatesCoveringNew && !StatsTracker::useIStats())
@@ -579,45 +650,78 @@ Executor::setModule(std::vector<std::unique_ptr<llvm::Module>> &modules,
 
   // Preparing the final module happens in multiple stages
 
-  // Link with KLEE intrinsics library before running any optimizations
   SmallString<128> LibPath(opts.LibraryDir);
   llvm::sys::path::append(LibPath,
                           "libkleeRuntimeIntrinsic" + opts.OptSuffix + ".bca");
-  std::string error;
-  if (!klee::loadFile(LibPath.c_str(), modules[0]->getContext(), modules,
-                      error)) {
-    klee_error("Could not load KLEE intrinsic file %s", LibPath.c_str());
-  }
 
-  // 1.) Link the modules together
-  while (kmodule->link(modules, opts.EntryPoint)) {
-    // 2.) Apply different instrumentation
-    kmodule->instrument(opts);
+  // A cached module replaces steps 1.) to 3.)
+  std::unique_ptr<ModuleCache> cache;
+  std::unique_ptr<llvm::Module> cached;
+  if (!ModuleCacheDir.empty()) {
+    cache = std::make_unique<ModuleCache>(ModuleCacheDir);
+    cache->addString(kmodule->describePreparation(opts));
+    if (!cache->addFile(LibPath.c_str()))
+      klee_error("Could not load KLEE intrinsic file %s", LibPath.c_str());
+    for (const auto &module : modules)
+      cache->addModule(*module);
+    cached = cache->load(modules[0]->getContext());
   }
 
-  // 3.) Optimise and prepare for KLEE
-
   // Create a list of functions that should be preserved if used
   std::vector<const char *> preservedFunctions;
   specialFunctionHandler = new SpecialFunctionHandler(*this);
-  specialFunctionHandler->prepare(preservedFunctions);
 
-  preservedFunctions.push_back(opts.EntryPoint.c_str());
+  if (cached) {
+    klee_message("Using cached module from %s", ModuleCacheDir.c_str());
+    modules.clear();
+    kmodule->setPreparedModule(std::move(cached), opts);
+    specialFunctionHandler->prepare(preservedFunctions);
+  } else {
+    // Link with KLEE intrinsics library before running any optimizations
+    std::string error;
+    if (!klee::loadFile(LibPath.c_str(), modules[0]->getContext(), modules,
+                        error)) {
+      klee_error("Could not load KLEE intrinsic file %s", LibPath.c_str());
+    }
+
+    // 1.) Link the modules together
+    while (kmodule->link(modules, opts.EntryPoint)) {
+      // 2.) Apply different instrumentation
+      kmodule->instrument(opts);
+    }
+
+    // 3.) Optimise and prepare for KLEE
+    specialFunctionHandler->prepare(preservedFunctions);
+
+    preservedFunctions.push_back(opts.EntryPoint.c_str());
 
-  // Preserve the free-standing library calls
-  preservedFunctions.push_back("memset");
-  preservedFunctions.push_back("memcpy");
-  preservedFunctions.push_back("memcmp");
-  preservedFunctions.push_back("memmove");
+    // Preserve the free-standing library calls
+    preservedFunctions.push_back("memset");
+    preservedFunctions.push_back("memcpy");
+    preservedFunctions.push_back("memcmp");
+    preservedFunctions.push_back("memmove");
 
-  kmodule->optimiseAndPrepare(opts, preservedFunctions);
-  kmodule->checkModule();
+    kmodule->optimiseAndPrepare(opts, preservedFunctions);
+    kmodule->checkModule();
+
+    if (cache)
+      cache->store(*kmodule->module);
+  }
 
   // 4.) Manifest the module
   kmodule->manifest(interpreterHandler, StatsTracker::useStatistics());
 
+  llvm::raw_ostream &info = interpreterHandler->getInfoStream();
+  for (const auto &stage : kmodule->preparationTimes)
+    info << "KLEE: module preparation: " << stage.first << " = "
+         << stage.second << "\n";
+  info.flush();
+
   specialFunctionHandler->bind();
 
+  if (PrecompileExternalStubs)
+    precompileExternalCalls();
+
   if (StatsTracker::useStatistics() || userSearcherRequiresMD2U()) {
     statsTracker = 
       new StatsTracker(*this,
@@ -941,10 +1045,93 @@ bool Executor::branchingPermitted(const ExecutionState &state) const {
   return true;
 }
 
+bool Executor::getFeasibleSwitchTargets(
+    ExecutionState &state, ref<Expr> cond,
+    std::map<ref<Expr>, BasicBlock *> &cases, BasicBlock *defaultDest,
+    std::set<BasicBlock *> &feasible) {
+  // Finding the range takes up to about twice the width of the condition in
+  // queries, so it only pays off for switches with more cases than that.
+  // getRange cannot report a failed query, so it runs without the core
+  // solver timeout and stops early with its own instead.
+  if (cases.size() > 2 * cond->getWidth() && cond->getWidth() <= 64) {
+    auto range = solver->getRange(state.constraints, cond,
+                                  state.queryMetaData, coreSolverTimeout);
+    uint64_t min = cast<ConstantExpr>(range.first)->getZExtValue();
+    uint64_t max = cast<ConstantExpr>(range.second)->getZExtValue();
+    // [0, 0] is also what getRange returns when it runs out of time.
+    if (min == 0 && max == 0)
+      max = std::numeric_limits<uint64_t>::max();
+    for (auto it = cases.begin(); it != cases.end();) {
+      uint64_t value = cast<ConstantExpr>(it->first)->getZExtValue();
+      if (value < min || value > max)
+        it = cases.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  if (cases.empty()) {
+    feasible.insert(defaultDest);
+    return true;
+  }
+
+  // Each model takes a successor that is not known to be feasible yet, until
+  // there is none left. As getInitialValues cannot tell an unsatisfiable
+  // query from a failed one, the constraints are only extended while they
+  // remain satisfiable, so that any failure to get a model is an error.
+  std::vector<const Array *> objects;
+  findSymbolicObjects(cond, objects);
+  ConstraintSet constraints(state.constraints);
+  ConstraintManager cm(constraints);
+  solver->setTimeout(coreSolverTimeout);
+
+  while (true) {
+    std::vector<std::vector<unsigned char>> values;
+    if (!solver->getInitialValues(constraints, objects, values,
+                                  state.queryMetaData))
+      return false;
+    ref<Expr> value = Assignment(objects, values, true).evaluate(cond);
+    auto it = cases.find(value);
+    BasicBlock *target = it == cases.end() ? defaultDest : it->second;
+    if (!feasible.insert(target).second)
+      break;
+
+    // The remaining successors, as a condition on the next model.
+    ref<Expr> remaining;
+    if (target == defaultDest) {
+      remaining = ConstantExpr::alloc(0, Expr::Bool);
+      for (const auto &c : cases)
+        if (!feasible.count(c.second))
+          remaining = OrExpr::create(EqExpr::create(cond, c.first), remaining);
+    } else {
+      remaining = ConstantExpr::alloc(1, Expr::Bool);
+      for (const auto &c : cases)
+        if (c.second == target)
+          remaining = AndExpr::create(
+              Expr::createIsZero(EqExpr::create(cond, c.first)), remaining);
+    }
+    remaining = ConstraintManager::simplifyExpr(constraints, remaining);
+
+    bool satisfiable;
+    if (auto *CE = dyn_cast<ConstantExpr>(remaining)) {
+      satisfiable = CE->isTrue();
+    } else if (!solver->mayBeTrue(constraints, remaining, satisfiable,
+                                  state.queryMetaData)) {
+      return false;
+    }
+    if (!satisfiable)
+      break;
+    if (!isa<ConstantExpr>(remaining))
+      cm.addConstraint(remaining);
+  }
+  return true;
+}
+
 void Executor::branch(ExecutionState &state, 
                       const std::vector< ref<Expr> > &conditions,
                       std::vector<ExecutionState*> &result) {
   TimerStatIncrementer timer(stats::forkTime);
+  profiler::PhaseScope phase(profiler::Phase::Fork);
   unsigned N = conditions.size();
   assert(N);
 
@@ -961,6 +1148,7 @@ void Executor::branch(ExecutionState &state,
     stats::forks += N-1;
 
     // XXX do proper balance or keep random?
+    std::uint64_t pathHash = processTree->getNode(state.ptreeNode).pathHash;
     result.push_back(&state);
     for (unsigned i=1; i<N; ++i) {
       ExecutionState *es = result[theRNG.getInt32() % i];
@@ -969,6 +1157,11 @@ void Executor::branch(ExecutionState &state,
       result.push_back(ns);
       processTree->attach(es->ptreeNode, ns, es);
     }
+    // Identify the paths by condition rather than by the random shape of
+    // the subtree, so that they are the same in every process.
+    for (unsigned i=0; i<N; ++i)
+      processTree->getNode(result[i]->ptreeNode).pathHash =
+          PTree::getChildPathHash(pathHash, i);
   }
 
   // If necessary redistribute seeds to match conditions, killing
@@ -1006,6 +1199,8 @@ void Executor::branch(ExecutionState &state,
       // Extra check in case we're replaying seeds with a max-fork
       if (result[i])
         seedMap[result[i]].push_back(*siit);
+      else
+        --seedsRemaining;
     }
 
     if (OnlyReplaySeeds) {
@@ -1016,6 +1211,11 @@ void Executor::branch(ExecutionState &state,
         }
       } 
     }
+
+    for (unsigned i=0; i<N; ++i)
+      if (result[i] && result[i] != &state && !seedMap.count(result[i]) &&
+          !keepUnseededPath(*result[i]))
+        result[i] = nullptr;
   }
 
   for (unsigned i=0; i<N; ++i)
@@ -1062,8 +1262,20 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
   if (isSeeding)
     timeout *= static_cast<unsigned>(it->second.size());
   solver->setTimeout(timeout);
-  bool success = solver->evaluate(current.constraints, condition, res,
-                                  current.queryMetaData);
+  TimingSolver::BranchResult branchResult;
+  bool success;
+  if (ForkModels) {
+    std::vector<const Array *> objects;
+    for (const auto &symbolic : current.symbolics)
+      objects.push_back(symbolic.second);
+    success = solver->evaluateBranch(current.constraints, condition, objects,
+                                     current.model, branchResult,
+                                     current.queryMetaData);
+    res = branchResult.validity;
+  } else {
+    success = solver->evaluate(current.constraints, condition, res,
+                               current.queryMetaData);
+  }
   solver->setTimeout(time::Span());
   if (!success) {
     current.pc = current.prevPC;
@@ -1096,6 +1308,7 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
       
       if (!branchingPermitted(current)) {
         TimerStatIncrementer timer(stats::forkTime);
+        profiler::PhaseScope phase(profiler::Phase::Fork);
         if (theRNG.getBool()) {
           addConstraint(current, condition);
           res = Solver::True;        
@@ -1152,6 +1365,8 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
         current.pathOS << "1";
       }
     }
+    if (branchResult.trueModel)
+      current.model = branchResult.trueModel;
 
     return StatePair(&current, 0);
   } else if (res==Solver::False) {
@@ -1160,10 +1375,13 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
         current.pathOS << "0";
       }
     }
+    if (branchResult.falseModel)
+      current.model = branchResult.falseModel;
 
     return StatePair(0, &current);
   } else {
     TimerStatIncrementer timer(stats::forkTime);
+    profiler::PhaseScope phase(profiler::Phase::Fork);
     ExecutionState *falseState, *trueState = &current;
 
     ++stats::forks;
@@ -1225,6 +1443,11 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
       }
     }
 
+    if (branchResult.trueModel)
+      trueState->model = branchResult.trueModel;
+    if (branchResult.falseModel)
+      falseState->model = branchResult.falseModel;
+
     addConstraint(*trueState, condition);
     addConstraint(*falseState, Expr::createIsZero(condition));
 
@@ -1235,10 +1458,23 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
       return StatePair(0, 0);
     }
 
+    // The current state is kept even if it has no seeds left.
+    if (isSeeding && !seedMap.count(falseState) &&
+        !keepUnseededPath(*falseState))
+      falseState = nullptr;
+
     return StatePair(trueState, falseState);
   }
 }
 
+bool Executor::keepUnseededPath(ExecutionState &state) {
+  std::uint64_t pathHash = processTree->getNode(state.ptreeNode).pathHash;
+  if (pathHash % pathPartitions == pathPartition)
+    return true;
+  terminateState(state);
+  return false;
+}
+
 void Executor::addConstraint(ExecutionState &state, ref<Expr> condition) {
   if (ConstantExpr *CE = dyn_cast<ConstantExpr>(condition)) {
     if (!CE->isTrue())
@@ -1289,6 +1525,7 @@ const Cell& Executor::eval(KInstruction *ki, unsigned index,
   } else {
     unsigned index = vnumber;
     StackFrame &sf = state.stack.back();
+    sf.locals[index].materialize();
     return sf.locals[index];
   }
 }
@@ -1308,6 +1545,7 @@ const Cell& Executor::eval(KInstruction *ki, unsigned index,
   } else {
     unsigned index = vnumber;
     StackFrame &sf = state.stack.back();
+    sf.locals[index].materialize();
     ref<Expr> reg = sf.locals[index].value;
     if (reg.isNull()) {
       prepareSymbolicRegister(state, sf, index);
@@ -1316,6 +1554,15 @@ const Cell& Executor::eval(KInstruction *ki, unsigned index,
   }
 }
 
+bool Executor::evalConcrete(KInstruction *ki, unsigned index,
+                            ExecutionState &state, uint64_t &bits,
+                            Expr::Width &width) const {
+  int vnumber = ki->operands[index];
+  const Cell &cell = vnumber < 0 ? kmodule->constantTable[-vnumber - 2]
+                                 : state.stack.back().locals[vnumber];
+  return cell.getConcrete(bits, width);
+}
+
 void Executor::bindLocal(KInstruction *target, ExecutionState &state, 
                          ref<Expr> value) {
   getDestCell(state, target).value = value;
@@ -1471,6 +1718,7 @@ void Executor::printDebugInstructions(ExecutionState &state) {
 }
 
 void Executor::stepInstruction(ExecutionState &state) {
+  makeResident(state);
   printDebugInstructions(state);
   if (statsTracker)
     statsTracker->stepInstruction(state);
@@ -1679,7 +1927,7 @@ void Executor::unwindToNextLandingpad(ExecutionState &state) {
 
         llvm::Function *personality_fn =
             kmodule->module->getFunction("_klee_eh_cxx_personality");
-        KFunction *kf = kmodule->functionMap[personality_fn];
+        KFunction *kf = getKFunction(personality_fn);
 
         state.addLevel(state.getPrevPCBlock());
         state.pushFrame(state.prevPC, kf);
@@ -1740,15 +1988,49 @@ ref<klee::ConstantExpr> Executor::getEhTypeidFor(ref<Expr> type_info) {
   return res;
 }
 
+CallDispatch Executor::resolveCall(Function *f) const {
+  CallDispatch dispatch;
+  dispatch.function = f;
+  if (!f->isDeclaration()) {
+    dispatch.kind = CallDispatch::Internal;
+  } else if (f->getIntrinsicID() != Intrinsic::not_intrinsic) {
+    dispatch.kind = CallDispatch::Intrinsic;
+  } else {
+    int handler = specialFunctionHandler->getHandlerID(f);
+    if (handler >= 0) {
+      dispatch.kind = CallDispatch::Special;
+      dispatch.handler = handler;
+    } else {
+      dispatch.kind = CallDispatch::External;
+    }
+  }
+  dispatch.throwsException =
+      f->getName() == "__cxa_throw" || f->getName() == "__cxa_rethrow";
+  return dispatch;
+}
+
+const CallDispatch &Executor::getCallDispatch(KInstruction *ki, Function *f) {
+  CallDispatch &dispatch = static_cast<KCallInstruction *>(ki)->dispatch;
+  // A miss only happens for indirect calls to another function than the
+  // last one.
+  if (dispatch.kind == CallDispatch::Unbound || dispatch.function != f)
+    dispatch = resolveCall(f);
+  if (dispatch.kind == CallDispatch::Internal && !dispatch.kf)
+    dispatch.kf = getKFunction(f);
+  return dispatch;
+}
+
 void Executor::executeCall(ExecutionState &state, KInstruction *ki, Function *f,
                            std::vector<ref<Expr>> &arguments) {
   Instruction *i = ki->inst;
   if (isa_and_nonnull<DbgInfoIntrinsic>(i))
     return;
-  if (f && f->isDeclaration()) {
+  const CallDispatch &dispatch = getCallDispatch(ki, f);
+  if (dispatch.kind != CallDispatch::Internal) {
 #ifndef ENABLE_FP
     Intrinsic::ID id = f->getIntrinsicID();
-    if (supportedFPIntrinsics.find(id) != supportedFPIntrinsics.end()) {
+    if (dispatch.kind == CallDispatch::Intrinsic &&
+        supportedFPIntrinsics.find(id) != supportedFPIntrinsics.end()) {
       klee_warning("unimplemented intrinsic: %s", f->getName().data());
       klee_message("You may enable this intrinsic by passing the following options"
         " to cmake:\n"
@@ -1756,7 +2038,8 @@ void Executor::executeCall(ExecutionState &state, KInstruction *ki, Function *f,
       terminateStateOnError(state, "unimplemented intrinsic", Unhandled);
       return;
     }
-    if (modelledFPIntrinsics.find(id) != modelledFPIntrinsics.end()) {
+    if (dispatch.kind == CallDispatch::Intrinsic &&
+        modelledFPIntrinsics.find(id) != modelledFPIntrinsics.end()) {
       klee_warning("unimplemented intrinsic: %s", f->getName().data());
       klee_message("You may enable this intrinsic by passing the following options"
         " to cmake:\n"
@@ -1769,7 +2052,11 @@ void Executor::executeCall(ExecutionState &state, KInstruction *ki, Function *f,
     switch (f->getIntrinsicID()) {
     case Intrinsic::not_intrinsic:
       // state may be destroyed by this call, cannot touch
-      callExternalFunction(state, ki, f, arguments);
+      if (dispatch.kind == CallDispatch::Special)
+        specialFunctionHandler->callHandler(dispatch.handler, state, f, ki,
+                                            arguments);
+      else
+        callExternalFunction(state, ki, f, arguments);
       break;
     case Intrinsic::fabs: {
 #ifndef ENABLE_FP
@@ -1935,8 +2222,7 @@ void Executor::executeCall(ExecutionState &state, KInstruction *ki, Function *f,
     // SpecialFunctionHandlers and have already been redirected to their unwind
     // destinations, so we must not transfer them to their regular targets.
     if (InvokeInst *ii = dyn_cast<InvokeInst>(i)) {
-      if (f->getName() != std::string("__cxa_throw") &&
-          f->getName() != std::string("__cxa_rethrow")) {
+      if (!dispatch.throwsException) {
         transferToBasicBlock(ii->getNormalDest(), i->getParent(), state);
       }
     }
@@ -1953,7 +2239,7 @@ void Executor::executeCall(ExecutionState &state, KInstruction *ki, Function *f,
     // guess. This just done to avoid having to pass KInstIterator everywhere
     // instead of the actual instruction, since we can't make a KInstIterator
     // from just an instruction (unlike LLVM).
-    KFunction *kf = kmodule->functionMap[f];
+    KFunction *kf = dispatch.kf;
 
     state.pushFrame(state.prevPC, kf);
     transferToBasicBlock(&*kf->function->begin(), state.getPrevPCBlock(), state);
@@ -2132,7 +2418,285 @@ void Executor::transferToBasicBlock(BasicBlock *dst, BasicBlock *src,
   }
 }
 
+void Executor::openAutoMerge(KInstruction *ki,
+                             const std::vector<ExecutionState *> &branches) {
+  std::vector<ExecutionState *> forked;
+  for (ExecutionState *es : branches)
+    if (es)
+      forked.push_back(es);
+  // Merging needs the merging searcher, which does not exist while seeding
+  if (forked.size() < 2 || !mergingSearcher)
+    return;
+
+  KInstruction *join =
+      autoMergePoints->getJoin(*forked[0]->stack.back().kf, ki);
+  if (!join)
+    return;
+  // Nested branches with the same join point are merged by the outer merge
+  auto &mergeStack = forked[0]->openMergeStack;
+  if (!mergeStack.empty() && mergeStack.back()->isJoinPoint(forked[0], join))
+    return;
+
+  ref<MergeHandler> handler(new MergeHandler(this, forked, join));
+  for (ExecutionState *es : forked) {
+    es->openMergeStack.push_back(handler);
+    if (DebugLogMerge)
+      llvm::errs() << "open merge: " << es << "\n";
+  }
+}
+
+bool Executor::updateAutoMerges(ExecutionState &state, KInstruction *ki) {
+  while (!state.openMergeStack.empty() &&
+         state.openMergeStack.back()->isAutomatic()) {
+    ref<MergeHandler> handler = state.openMergeStack.back();
+    if (handler->isJoinPoint(&state, ki)) {
+      if (DebugLogMerge)
+        llvm::errs() << "close merge: " << &state << " at [" << *ki->inst
+                     << "]\n";
+      mergingSearcher->inCloseMerge.insert(&state);
+      // ki is executed once the state is continued. Reset the pc before
+      // merging, as states only merge when at the same instruction.
+      state.pc = state.prevPC;
+      handler->addClosedState(&state, ki->inst);
+      state.openMergeStack.pop_back();
+      return true;
+    }
+    if (!handler->hasExpired(&state))
+      return false;
+    handler->removeOpenState(&state);
+    state.openMergeStack.pop_back();
+  }
+  return false;
+}
+
+namespace {
+ref<Expr> createTrunc(const ref<Expr> &e, Expr::Width width) {
+  return ExtractExpr::create(e, 0, width);
+}
+} // namespace
+
+Executor::InstructionHandler
+Executor::getInstructionHandler(const Instruction *i) {
+  // Vectors are never held inline, and their lanes must not be computed as
+  // one integer.
+  bool isScalar = !i->getType()->isVectorTy() &&
+                  (i->getNumOperands() == 0 ||
+                   !i->getOperand(0)->getType()->isVectorTy());
+#define INTEGER_HANDLER(Create, Evaluate)                                      \
+  (isScalar ? &Executor::executeIntegerInstruction<Create, Evaluate>           \
+            : &Executor::executeBinaryInstruction<Create>)
+#define CAST_HANDLER(Create, Evaluate)                                         \
+  (isScalar ? &Executor::executeIntegerCastInstruction<Create, Evaluate>       \
+            : &Executor::executeCastInstruction<Create>)
+
+  switch (i->getOpcode()) {
+  case Instruction::PHI:
+    return &Executor::executePHI;
+  case Instruction::Select:
+    return &Executor::executeSelect;
+
+    // Arithmetic / logical
+  case Instruction::Add:
+    return INTEGER_HANDLER(AddExpr::create, ints::add);
+  case Instruction::Sub:
+    return INTEGER_HANDLER(SubExpr::create, ints::sub);
+  case Instruction::Mul:
+    return INTEGER_HANDLER(MulExpr::create, ints::mul);
+  case Instruction::UDiv:
+    return &Executor::executeDivisionInstruction<UDivExpr::create>;
+  case Instruction::SDiv:
+    return &Executor::executeDivisionInstruction<SDivExpr::create>;
+  case Instruction::URem:
+    return &Executor::executeDivisionInstruction<URemExpr::create>;
+  case Instruction::SRem:
+    return &Executor::executeDivisionInstruction<SRemExpr::create>;
+  case Instruction::And:
+    return INTEGER_HANDLER(AndExpr::create, ints::land);
+  case Instruction::Or:
+    return INTEGER_HANDLER(OrExpr::create, ints::lor);
+  case Instruction::Xor:
+    return INTEGER_HANDLER(XorExpr::create, ints::lxor);
+  // Shifting by the width or more is well defined for expressions only.
+  case Instruction::Shl:
+    return &Executor::executeBinaryInstruction<ShlExpr::create>;
+  case Instruction::LShr:
+    return &Executor::executeBinaryInstruction<LShrExpr::create>;
+  case Instruction::AShr:
+    return &Executor::executeBinaryInstruction<AShrExpr::create>;
+
+    // Compare
+  case Instruction::ICmp:
+    switch (cast<ICmpInst>(i)->getPredicate()) {
+    case ICmpInst::ICMP_EQ:
+      return INTEGER_HANDLER(EqExpr::create, ints::eq);
+    case ICmpInst::ICMP_NE:
+      return INTEGER_HANDLER(NeExpr::create, ints::ne);
+    case ICmpInst::ICMP_UGT:
+      return INTEGER_HANDLER(UgtExpr::create, ints::ugt);
+    case ICmpInst::ICMP_UGE:
+      return INTEGER_HANDLER(UgeExpr::create, ints::uge);
+    case ICmpInst::ICMP_ULT:
+      return INTEGER_HANDLER(UltExpr::create, ints::ult);
+    case ICmpInst::ICMP_ULE:
+      return INTEGER_HANDLER(UleExpr::create, ints::ule);
+    case ICmpInst::ICMP_SGT:
+      return INTEGER_HANDLER(SgtExpr::create, ints::sgt);
+    case ICmpInst::ICMP_SGE:
+      return INTEGER_HANDLER(SgeExpr::create, ints::sge);
+    case ICmpInst::ICMP_SLT:
+      return INTEGER_HANDLER(SltExpr::create, ints::slt);
+    case ICmpInst::ICMP_SLE:
+      return INTEGER_HANDLER(SleExpr::create, ints::sle);
+    default:
+      return &Executor::executeGenericInstruction;
+    }
+
+    // Memory instructions...
+  case Instruction::Load:
+    return &Executor::executeLoad;
+  case Instruction::Store:
+    return &Executor::executeStore;
+  case Instruction::GetElementPtr:
+    return &Executor::executeGetElementPtr;
+
+    // Conversion
+  case Instruction::Trunc:
+    return CAST_HANDLER(createTrunc, ints::trunc);
+  case Instruction::ZExt:
+  case Instruction::IntToPtr:
+  case Instruction::PtrToInt:
+    // also truncates, for pointers wider than the integer
+    return CAST_HANDLER(ZExtExpr::create, ints::trunc);
+  case Instruction::SExt:
+    return CAST_HANDLER(SExtExpr::create, ints::sext);
+
+  default:
+    return &Executor::executeGenericInstruction;
+  }
+#undef INTEGER_HANDLER
+#undef CAST_HANDLER
+}
+
+template <Executor::BinaryExprCreator Create>
+void Executor::executeBinaryInstruction(ExecutionState &state,
+                                        KInstruction *ki) {
+  ref<Expr> left = eval(ki, 0, state).value;
+  ref<Expr> right = eval(ki, 1, state).value;
+  bindLocal(ki, state, Create(left, right));
+}
+
+template <Executor::BinaryExprCreator Create,
+          Executor::BinaryIntEvaluator Evaluate>
+void Executor::executeIntegerInstruction(ExecutionState &state,
+                                         KInstruction *ki) {
+  uint64_t left, right;
+  Expr::Width width, rightWidth;
+  if (ki->width <= Expr::Int64 && evalConcrete(ki, 0, state, left, width) &&
+      evalConcrete(ki, 1, state, right, rightWidth)) {
+    bindLocalConcrete(ki, state, Evaluate(left, right, width));
+    return;
+  }
+  executeBinaryInstruction<Create>(state, ki);
+}
+
+template <Executor::BinaryExprCreator Create>
+void Executor::executeDivisionInstruction(ExecutionState &state,
+                                          KInstruction *ki) {
+  ref<Expr> left = eval(ki, 0, state).value;
+  ref<Expr> right = eval(ki, 1, state).value;
+  if (!isa<ConstantExpr>(right))
+    recordSensitiveInstruction(state);
+  bindLocal(ki, state, Create(left, right));
+}
+
+template <Executor::CastExprCreator Create>
+void Executor::executeCastInstruction(ExecutionState &state,
+                                      KInstruction *ki) {
+  bindLocal(ki, state, Create(eval(ki, 0, state).value, ki->width));
+}
+
+template <Executor::CastExprCreator Create, Executor::CastIntEvaluator Evaluate>
+void Executor::executeIntegerCastInstruction(ExecutionState &state,
+                                             KInstruction *ki) {
+  uint64_t bits;
+  Expr::Width width;
+  if (ki->width <= Expr::Int64 && evalConcrete(ki, 0, state, bits, width)) {
+    bindLocalConcrete(ki, state, Evaluate(bits, ki->width, width));
+    return;
+  }
+  executeCastInstruction<Create>(state, ki);
+}
+
+void Executor::executePHI(ExecutionState &state, KInstruction *ki) {
+  if (state.incomingBBIndex == -1)
+    prepareSymbolicValue(state, ki);
+  else {
+    ref<Expr> result;
+    result = eval(ki, state.incomingBBIndex, state).value;
+    bindLocal(ki, state, result);
+  }
+}
+
+void Executor::executeSelect(ExecutionState &state, KInstruction *ki) {
+  // NOTE: It is not required that operands 1 and 2 be of scalar type.
+  ref<Expr> cond = eval(ki, 0, state).value;
+  ref<Expr> tExpr = eval(ki, 1, state).value;
+  ref<Expr> fExpr = eval(ki, 2, state).value;
+  ref<Expr> result = SelectExpr::create(cond, tExpr, fExpr);
+  bindLocal(ki, state, result);
+}
+
+void Executor::executeLoad(ExecutionState &state, KInstruction *ki) {
+  ref<Expr> base = eval(ki, 0, state).value;
+  executeMemoryOperation(state, Read, base, nullptr, ki);
+}
+
+void Executor::executeStore(ExecutionState &state, KInstruction *ki) {
+  ref<Expr> base = eval(ki, 1, state).value;
+  ref<Expr> value = eval(ki, 0, state).value;
+  executeMemoryOperation(state, Write, base, value, ki);
+}
+
+void Executor::executeGetElementPtr(ExecutionState &state, KInstruction *ki) {
+  KGEPInstruction *kgepi = static_cast<KGEPInstruction*>(ki);
+  GetElementPtrInst *gepInst = static_cast<GetElementPtrInst*>(kgepi->inst);
+  unsigned sourceSize =
+      kmodule->targetData->getTypeStoreSize(gepInst->getSourceElementType());
+  ref<Expr> base = eval(ki, 0, state).value;
+  ref<Expr> offset = ConstantExpr::create(0, base->getWidth());
+  for (std::vector< std::pair<unsigned, uint64_t> >::iterator
+         it = kgepi->indices.begin(), ie = kgepi->indices.end();
+       it != ie; ++it) {
+    uint64_t elementSize = it->second;
+    ref<Expr> index = eval(ki, it->first, state).value;
+    offset = AddExpr::create(offset,
+                             MulExpr::create(Expr::createSExtToPointerWidth(index),
+                                             Expr::createPointer(elementSize)));
+  }
+  if (kgepi->offset)
+    offset = AddExpr::create(offset,
+                             Expr::createPointer(kgepi->offset));
+  ref<Expr> address = AddExpr::create(base, offset);
+  if (UseGEPExpr && !isa<ConstantExpr>(address) && !isa<ConstantExpr>(base)) {
+    if (const GEPExprBases::Entry *gep = getGEPExprBase(state, base))
+      state.gepExprBases.set(address, GEPExprBases::Entry(*gep));
+    else
+      state.gepExprBases.set(address, {base, sourceSize});
+  }
+  bindLocal(ki, state, address);
+}
+
 void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
+  if (autoMergePoints && !state.openMergeStack.empty() &&
+      updateAutoMerges(state, ki))
+    return;
+
+  profiler::setInstruction(state.stack.back().kf, ki->inst->getOpcode());
+  (this->*ki->handler)(state, ki);
+}
+
+void Executor::executeGenericInstruction(ExecutionState &state,
+                                         KInstruction *ki) {
   Instruction *i = ki->inst;
   switch (i->getOpcode()) {
     // Control flow
@@ -2264,6 +2828,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
         transferToBasicBlock(bi->getSuccessor(0), bi->getParent(), *branches.first);
       if (branches.second)
         transferToBasicBlock(bi->getSuccessor(1), bi->getParent(), *branches.second);
+
+      if (autoMergePoints)
+        openAutoMerge(ki, {branches.first, branches.second});
     }
     break;
   }
@@ -2371,68 +2938,66 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
       std::map<ref<Expr>, BasicBlock *> expressionOrder;
 
+      // Track default branch values
+      ref<Expr> defaultValue = ConstantExpr::alloc(1, Expr::Bool);
+
       // Iterate through all non-default cases and order them by expressions
       for (auto i : si->cases()) {
-        ref<Expr> value = evalConstant(i.getCaseValue(), state.roundingMode);
-
         BasicBlock *caseSuccessor = i.getCaseSuccessor();
+        // skip if case has same successor basic block as default case
+        // (should work even with phi nodes as a switch is a single terminating instruction)
+        if (caseSuccessor == si->getDefaultDest())
+          continue;
+
+        ref<Expr> value = evalConstant(i.getCaseValue(), state.roundingMode);
         expressionOrder.insert(std::make_pair(value, caseSuccessor));
+
+        // Make sure that the default value does not contain this target's value
+        defaultValue = AndExpr::create(defaultValue,
+                                       Expr::createIsZero(EqExpr::create(cond, value)));
       }
 
-      // Track default branch values
-      ref<Expr> defaultValue = ConstantExpr::alloc(1, Expr::Bool);
+      std::set<BasicBlock *> feasibleTargets;
+      bool success = getFeasibleSwitchTargets(
+          state, cond, expressionOrder, si->getDefaultDest(), feasibleTargets);
+      solver->setTimeout(time::Span());
+      if (!success) {
+        state.pc = state.prevPC;
+        terminateStateEarly(state, "Query timed out (switch).");
+        break;
+      }
 
       // iterate through all non-default cases but in order of the expressions
       for (std::map<ref<Expr>, BasicBlock *>::iterator
                it = expressionOrder.begin(),
                itE = expressionOrder.end();
            it != itE; ++it) {
+        BasicBlock *caseSuccessor = it->second;
+        if (!feasibleTargets.count(caseSuccessor))
+          continue;
         ref<Expr> match = EqExpr::create(cond, it->first);
 
-        // skip if case has same successor basic block as default case
-        // (should work even with phi nodes as a switch is a single terminating instruction)
-        if (it->second == si->getDefaultDest()) continue;
-
-        // Make sure that the default value does not contain this target's value
-        defaultValue = AndExpr::create(defaultValue, Expr::createIsZero(match));
-
-        // Check if control flow could take this case
-        bool result;
-        match = optimizer.optimizeExpr(match, false);
-        bool success = solver->mayBeTrue(state.constraints, match, result,
-                                         state.queryMetaData);
-        assert(success && "FIXME: Unhandled solver failure");
-        (void) success;
-        if (result) {
-          BasicBlock *caseSuccessor = it->second;
-
-          // Handle the case that a basic block might be the target of multiple
-          // switch cases.
-          // Currently we generate an expression containing all switch-case
-          // values for the same target basic block. We spare us forking too
-          // many times but we generate more complex condition expressions
-          // TODO Add option to allow to choose between those behaviors
-          std::pair<std::map<BasicBlock *, ref<Expr> >::iterator, bool> res =
-              branchTargets.insert(std::make_pair(
-                  caseSuccessor, ConstantExpr::alloc(0, Expr::Bool)));
-
-          res.first->second = OrExpr::create(match, res.first->second);
-
-          // Only add basic blocks which have not been target of a branch yet
-          if (res.second) {
-            bbOrder.push_back(caseSuccessor);
-          }
+        // Handle the case that a basic block might be the target of multiple
+        // switch cases.
+        // Currently we generate an expression containing all switch-case
+        // values for the same target basic block. We spare us forking too
+        // many times but we generate more complex condition expressions
+        // TODO Add option to allow to choose between those behaviors
+        std::pair<std::map<BasicBlock *, ref<Expr> >::iterator, bool> res =
+            branchTargets.insert(std::make_pair(
+                caseSuccessor, ConstantExpr::alloc(0, Expr::Bool)));
+
+        res.first->second = OrExpr::create(match, res.first->second);
+
+        // Only add basic blocks which have not been target of a branch yet
+        if (res.second) {
+          bbOrder.push_back(caseSuccessor);
         }
       }
 
       // Check if control could take the default case
-      defaultValue = optimizer.optimizeExpr(defaultValue, false);
-      bool res;
-      bool success = solver->mayBeTrue(state.constraints, defaultValue, res,
-                                       state.queryMetaData);
-      assert(success && "FIXME: Unhandled solver failure");
-      (void) success;
-      if (res) {
+      if (feasibleTargets.count(si->getDefaultDest())) {
+        defaultValue = optimizer.optimizeExpr(defaultValue, false);
         std::pair<std::map<BasicBlock *, ref<Expr> >::iterator, bool> ret =
             branchTargets.insert(
                 std::make_pair(si->getDefaultDest(), defaultValue));
@@ -2461,6 +3026,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
           transferToBasicBlock(*it, bb, *es);
         ++bit;
       }
+
+      if (autoMergePoints)
+        openAutoMerge(ki, branches);
     }
     break;
   }
@@ -2487,7 +3055,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 #endif
 
     unsigned numArgs = cs.arg_size();
-    Function *f = getTargetFunction(fp);
+    Function *f = static_cast<KCallInstruction *>(ki)->calledFunction;
 
     if (isa<InlineAsm>(fp)) {
       terminateStateOnExecError(state, "inline assembly is unsupported");
@@ -2586,228 +3154,16 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     break;
   }
 
-  case Instruction::PHI: {
-    if (state.incomingBBIndex == -1)
-      prepareSymbolicValue(state, ki);
-    else {
-      ref<Expr> result;
-      result = eval(ki, state.incomingBBIndex, state).value;
-      bindLocal(ki, state, result);
-    }
-    break;
-  }
-
     // Special instructions
-  case Instruction::Select: {
-    // NOTE: It is not required that operands 1 and 2 be of scalar type.
-    ref<Expr> cond = eval(ki, 0, state).value;
-    ref<Expr> tExpr = eval(ki, 1, state).value;
-    ref<Expr> fExpr = eval(ki, 2, state).value;
-    ref<Expr> result = SelectExpr::create(cond, tExpr, fExpr);
-    bindLocal(ki, state, result);
-    break;
-  }
-
   case Instruction::VAArg:
     terminateStateOnExecError(state, "unexpected VAArg instruction");
     break;
 
-    // Arithmetic / logical
-
-  case Instruction::Add: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
-    bindLocal(ki, state, AddExpr::create(left, right));
-    break;
-  }
-
-  case Instruction::Sub: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
-    bindLocal(ki, state, SubExpr::create(left, right));
+    // Compare; valid predicates have handlers of their own
+  case Instruction::ICmp:
+    terminateStateOnExecError(state, "invalid ICmp predicate");
     break;
-  }
- 
-  case Instruction::Mul: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
-    bindLocal(ki, state, MulExpr::create(left, right));
-    break;
-  }
 
-  case Instruction::UDiv: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = UDivExpr::create(left, right);
-    bindLocal(ki, state, result);
-    break;
-  }
-
-  case Instruction::SDiv: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = SDivExpr::create(left, right);
-    bindLocal(ki, state, result);
-    break;
-  }
-
-  case Instruction::URem: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = URemExpr::create(left, right);
-    bindLocal(ki, state, result);
-    break;
-  }
-
-  case Instruction::SRem: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = SRemExpr::create(left, right);
-    bindLocal(ki, state, result);
-    break;
-  }
-
-  case Instruction::And: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = AndExpr::create(left, right);
-    bindLocal(ki, state, result);
-    break;
-  }
-
-  case Instruction::Or: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = OrExpr::create(left, right);
-    bindLocal(ki, state, result);
-    break;
-  }
-
-  case Instruction::Xor: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = XorExpr::create(left, right);
-    bindLocal(ki, state, result);
-    break;
-  }
-
-  case Instruction::Shl: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = ShlExpr::create(left, right);
-    bindLocal(ki, state, result);
-    break;
-  }
-
-  case Instruction::LShr: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = LShrExpr::create(left, right);
-    bindLocal(ki, state, result);
-    break;
-  }
-
-  case Instruction::AShr: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
-    ref<Expr> result = AShrExpr::create(left, right);
-    bindLocal(ki, state, result);
-    break;
-  }
-
-    // Compare
-
-  case Instruction::ICmp: {
-    CmpInst *ci = cast<CmpInst>(i);
-    ICmpInst *ii = cast<ICmpInst>(ci);
-
-    switch(ii->getPredicate()) {
-    case ICmpInst::ICMP_EQ: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = EqExpr::create(left, right);
-      bindLocal(ki, state, result);
-      break;
-    }
-
-    case ICmpInst::ICMP_NE: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = NeExpr::create(left, right);
-      bindLocal(ki, state, result);
-      break;
-    }
-
-    case ICmpInst::ICMP_UGT: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = UgtExpr::create(left, right);
-      bindLocal(ki, state,result);
-      break;
-    }
-
-    case ICmpInst::ICMP_UGE: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = UgeExpr::create(left, right);
-      bindLocal(ki, state, result);
-      break;
-    }
-
-    case ICmpInst::ICMP_ULT: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = UltExpr::create(left, right);
-      bindLocal(ki, state, result);
-      break;
-    }
-
-    case ICmpInst::ICMP_ULE: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = UleExpr::create(left, right);
-      bindLocal(ki, state, result);
-      break;
-    }
-
-    case ICmpInst::ICMP_SGT: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = SgtExpr::create(left, right);
-      bindLocal(ki, state, result);
-      break;
-    }
-
-    case ICmpInst::ICMP_SGE: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = SgeExpr::create(left, right);
-      bindLocal(ki, state, result);
-      break;
-    }
-
-    case ICmpInst::ICMP_SLT: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = SltExpr::create(left, right);
-      bindLocal(ki, state, result);
-      break;
-    }
-
-    case ICmpInst::ICMP_SLE: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
-      ref<Expr> result = SleExpr::create(left, right);
-      bindLocal(ki, state, result);
-      break;
-    }
-
-    default:
-      terminateStateOnExecError(state, "invalid ICmp predicate");
-    }
-    break;
-  }
- 
     // Memory instructions...
   case Instruction::Alloca: {
     // FIXME: Should we provide a way to switch between
@@ -2829,97 +3185,16 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     break;
   }
 
-  case Instruction::Load: {
-    ref<Expr> base = eval(ki, 0, state).value;
-    executeMemoryOperation(state, Read, base, nullptr, ki);
-    break;
-  }
-
-  case Instruction::Store: {
-    ref<Expr> base = eval(ki, 1, state).value;
-    ref<Expr> value = eval(ki, 0, state).value;
-    executeMemoryOperation(state, Write, base, value, ki);
-    break;
-  }
-
-  case Instruction::GetElementPtr: {
-    KGEPInstruction *kgepi = static_cast<KGEPInstruction*>(ki);
-    GetElementPtrInst *gepInst = static_cast<GetElementPtrInst*>(kgepi->inst);
-    unsigned sourceSize =
-        kmodule->targetData->getTypeStoreSize(gepInst->getSourceElementType());
-    ref<Expr> base = eval(ki, 0, state).value;
-    ref<Expr> offset = ConstantExpr::create(0, base->getWidth());
-    for (std::vector< std::pair<unsigned, uint64_t> >::iterator
-           it = kgepi->indices.begin(), ie = kgepi->indices.end();
-         it != ie; ++it) {
-      uint64_t elementSize = it->second;
-      ref<Expr> index = eval(ki, it->first, state).value;
-      offset = AddExpr::create(offset,
-                             MulExpr::create(Expr::createSExtToPointerWidth(index),
-                                             Expr::createPointer(elementSize)));
-    }
-    if (kgepi->offset)
-      offset = AddExpr::create(offset,
-                             Expr::createPointer(kgepi->offset));
-    ref<Expr> address = AddExpr::create(base, offset);
-    if (UseGEPExpr && !isa<ConstantExpr>(address) && !isa<ConstantExpr>(base)) {
-      if (isGEPExpr(base))
-        gepExprBases[address] = gepExprBases[base];
-      else
-        gepExprBases[address] = {base, sourceSize};
-    }
-    bindLocal(ki, state, address);
-    break;
-  }
-
     // Conversion
-  case Instruction::Trunc: {
-    CastInst *ci = cast<CastInst>(i);
-    ref<Expr> result = ExtractExpr::create(eval(ki, 0, state).value,
-                                           0,
-                                           getWidthForLLVMType(ci->getType()));
-    bindLocal(ki, state, result);
-    break;
-  }
-  case Instruction::ZExt: {
-    CastInst *ci = cast<CastInst>(i);
-    ref<Expr> result = ZExtExpr::create(eval(ki, 0, state).value,
-                                        getWidthForLLVMType(ci->getType()));
-    bindLocal(ki, state, result);
-    break;
-  }
-  case Instruction::SExt: {
-    CastInst *ci = cast<CastInst>(i);
-    ref<Expr> result = SExtExpr::create(eval(ki, 0, state).value,
-                                        getWidthForLLVMType(ci->getType()));
-    bindLocal(ki, state, result);
-    break;
-  }
-
-  case Instruction::IntToPtr: {
-    CastInst *ci = cast<CastInst>(i);
-    Expr::Width pType = getWidthForLLVMType(ci->getType());
-    ref<Expr> arg = eval(ki, 0, state).value;
-    bindLocal(ki, state, ZExtExpr::create(arg, pType));
-    break;
-  }
-  case Instruction::PtrToInt: {
-    CastInst *ci = cast<CastInst>(i);
-    Expr::Width iType = getWidthForLLVMType(ci->getType());
-    ref<Expr> arg = eval(ki, 0, state).value;
-    bindLocal(ki, state, ZExtExpr::create(arg, iType));
-    break;
-  }
-
   case Instruction::BitCast: {
     ref<Expr> result = eval(ki, 0, state).value;
     BitCastInst *bc = cast<BitCastInst>(ki->inst);
 
-    if(UseGEPExpr && isGEPExpr(result)) {
+    if (const GEPExprBases::Entry *gep = getGEPExprBase(state, result)) {
       unsigned size = bc->getType()->isPointerTy() ?
             kmodule->targetData->getTypeStoreSize(ki->inst->getType()->getPointerElementType()) :
             kmodule->targetData->getTypeStoreSize(ki->inst->getType());
-      gepExprBases[result] = {gepExprBases[result].first, size};
+      state.gepExprBases.set(result, {gep->base, size});
     }
 
     bindLocal(ki, state, result);
@@ -3017,8 +3292,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::FPTrunc: {
-    FPTruncInst *fi = cast<FPTruncInst>(i);
-    Expr::Width resultType = getWidthForLLVMType(fi->getType());
+    Expr::Width resultType = ki->width;
     ref<ConstantExpr> arg = toConstant(state, eval(ki, 0, state).value,
                                        "floating point");
     if (!fpWidthToSemantics(arg->getWidth()) || resultType > arg->getWidth())
@@ -3034,8 +3308,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::FPExt: {
-    FPExtInst *fi = cast<FPExtInst>(i);
-    Expr::Width resultType = getWidthForLLVMType(fi->getType());
+    Expr::Width resultType = ki->width;
     ref<ConstantExpr> arg = toConstant(state, eval(ki, 0, state).value,
                                         "floating point");
     if (!fpWidthToSemantics(arg->getWidth()) || arg->getWidth() > resultType)
@@ -3050,8 +3323,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::FPToUI: {
-    FPToUIInst *fi = cast<FPToUIInst>(i);
-    Expr::Width resultType = getWidthForLLVMType(fi->getType());
+    Expr::Width resultType = ki->width;
     ref<ConstantExpr> arg = toConstant(state, eval(ki, 0, state).value,
                                        "floating point");
     if (!fpWidthToSemantics(arg->getWidth()) || resultType > 64)
@@ -3072,8 +3344,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::FPToSI: {
-    FPToSIInst *fi = cast<FPToSIInst>(i);
-    Expr::Width resultType = getWidthForLLVMType(fi->getType());
+    Expr::Width resultType = ki->width;
     ref<ConstantExpr> arg = toConstant(state, eval(ki, 0, state).value,
                                        "floating point");
     if (!fpWidthToSemantics(arg->getWidth()) || resultType > 64)
@@ -3094,8 +3365,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::UIToFP: {
-    UIToFPInst *fi = cast<UIToFPInst>(i);
-    Expr::Width resultType = getWidthForLLVMType(fi->getType());
+    Expr::Width resultType = ki->width;
     ref<ConstantExpr> arg = toConstant(state, eval(ki, 0, state).value,
                                        "floating point");
     const llvm::fltSemantics *semantics = fpWidthToSemantics(resultType);
@@ -3110,8 +3380,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::SIToFP: {
-    SIToFPInst *fi = cast<SIToFPInst>(i);
-    Expr::Width resultType = getWidthForLLVMType(fi->getType());
+    Expr::Width resultType = ki->width;
     ref<ConstantExpr> arg = toConstant(state, eval(ki, 0, state).value,
                                        "floating point");
     const llvm::fltSemantics *semantics = fpWidthToSemantics(resultType);
@@ -3273,8 +3542,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::FPTrunc: {
-      FPTruncInst *fi = cast<FPTruncInst>(i);
-      Expr::Width resultType = getWidthForLLVMType(fi->getType());
+      Expr::Width resultType = ki->width;
       ref<Expr> arg = eval(ki, 0, state).value;
       if (!fpWidthToSemantics(arg->getWidth()) || !fpWidthToSemantics(resultType))
           return terminateStateOnExecError(state, "Unsupported FPTrunc operation");
@@ -3286,8 +3554,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::FPExt: {
-      FPExtInst *fi = cast<FPExtInst>(i);
-      Expr::Width resultType = getWidthForLLVMType(fi->getType());
+      Expr::Width resultType = ki->width;
       ref<Expr> arg = eval(ki, 0, state).value;
       if (!fpWidthToSemantics(arg->getWidth()) || !fpWidthToSemantics(resultType))
           return terminateStateOnExecError(state, "Unsupported FPExt operation");
@@ -3299,8 +3566,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::FPToUI: {
-    FPToUIInst *fi = cast<FPToUIInst>(i);
-    Expr::Width resultType = getWidthForLLVMType(fi->getType());
+    Expr::Width resultType = ki->width;
   ref<Expr> arg = eval(ki, 0, state).value;
       if (!fpWidthToSemantics(arg->getWidth()))
           return terminateStateOnExecError(state, "Unsupported FPToUI operation");
@@ -3312,8 +3578,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::FPToSI: {
-    FPToSIInst *fi = cast<FPToSIInst>(i);
-    Expr::Width resultType = getWidthForLLVMType(fi->getType());
+    Expr::Width resultType = ki->width;
     ref<Expr> arg = eval(ki, 0, state).value;
     if (!fpWidthToSemantics(arg->getWidth()))
       return terminateStateOnExecError(state, "Unsupported FPToSI operation");
@@ -3325,8 +3590,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::UIToFP: {
-    UIToFPInst *fi = cast<UIToFPInst>(i);
-    Expr::Width resultType = getWidthForLLVMType(fi->getType());
+    Expr::Width resultType = ki->width;
     ref<Expr> arg = eval(ki, 0, state).value;
     const llvm::fltSemantics *semantics = fpWidthToSemantics(resultType);
     if (!semantics)
@@ -3337,8 +3601,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::SIToFP: {
-    SIToFPInst *fi = cast<SIToFPInst>(i);
-    Expr::Width resultType = getWidthForLLVMType(fi->getType());
+    Expr::Width resultType = ki->width;
     ref<Expr> arg = eval(ki, 0, state).value;
     const llvm::fltSemantics *semantics = fpWidthToSemantics(resultType);
     if (!semantics)
@@ -3393,7 +3656,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
     ref<Expr> agg = eval(ki, 0, state).value;
 
-    ref<Expr> result = ExtractExpr::create(agg, kgepi->offset*8, getWidthForLLVMType(i->getType()));
+    ref<Expr> result = ExtractExpr::create(agg, kgepi->offset*8, ki->width);
 
     bindLocal(ki, state, result);
     break;
@@ -3588,8 +3851,10 @@ void Executor::updateStates(ExecutionState *current) {
     states.erase(it2);
     std::map<ExecutionState*, std::vector<SeedInfo> >::iterator it3 = 
       seedMap.find(es);
-    if (it3 != seedMap.end())
+    if (it3 != seedMap.end()) {
+      seedsRemaining -= it3->second.size();
       seedMap.erase(it3);
+    }
     processTree->remove(es->ptreeNode);
     delete es;
   }
@@ -3646,6 +3911,7 @@ void Executor::computeOffsets(KGEPInstruction *kgepi, TypeIt ib, TypeIt ie) {
 }
 
 void Executor::bindInstructionConstants(KInstruction *KI) {
+  KI->handler = getInstructionHandler(KI->inst);
   if (GetElementPtrInst *gepi = dyn_cast<GetElementPtrInst>(KI->inst)) {
     KGEPInstruction *kgepi = static_cast<KGEPInstruction *>(KI);
     computeOffsets(kgepi, gep_type_begin(gepi), gep_type_end(gepi));
@@ -3657,25 +3923,92 @@ void Executor::bindInstructionConstants(KInstruction *KI) {
     KGEPInstruction *kgepi = static_cast<KGEPInstruction *>(KI);
     computeOffsets(kgepi, ev_type_begin(evi), ev_type_end(evi));
     assert(kgepi->indices.empty() && "ExtractValue constant offset expected");
+  } else if (isa<CallInst>(KI->inst) || isa<InvokeInst>(KI->inst)) {
+    KCallInstruction *kci = static_cast<KCallInstruction *>(KI);
+    kci->dispatch = kci->calledFunction ? resolveCall(kci->calledFunction)
+                                        : CallDispatch();
   }
 }
 
+// XXX shoot me
+static const char *okExternalsList[] = { "printf", 
+                                         "fprintf", 
+                                         "puts",
+                                         "getpid" };
+static std::set<std::string> okExternals(okExternalsList,
+                                         okExternalsList + 
+                                         (sizeof(okExternalsList)/sizeof(okExternalsList[0])));
+
+void Executor::precompileExternalCalls() {
+  // Walk the IR rather than kmodule->functions, which are not constructed
+  // yet with --lazy-functions.
+  std::vector<std::pair<Function *, Instruction *>> calls;
+  for (Function &fn : *kmodule->module) {
+    for (Instruction &inst : instructions(fn)) {
+      if (!isa<CallInst>(inst) && !isa<InvokeInst>(inst))
+        continue;
+#if LLVM_VERSION_CODE >= LLVM_VERSION(8, 0)
+      Function *f = getTargetFunction(cast<CallBase>(inst).getCalledOperand());
+#else
+      Function *f = getTargetFunction(CallSite(&inst).getCalledValue());
+#endif
+      // Only direct calls to functions that end up in callExternalFunction
+      if (!f || !f->isDeclaration() ||
+          f->getIntrinsicID() != Intrinsic::not_intrinsic ||
+          specialFunctionHandler->handlers.count(f))
+        continue;
+      if (ExternalCalls == ExternalCallPolicy::None &&
+          !okExternals.count(f->getName().str()))
+        continue;
+      calls.push_back(std::make_pair(f, &inst));
+    }
+  }
+  externalDispatcher->compileStubs(calls);
+
+  llvm::raw_ostream &info = interpreterHandler->getInfoStream();
+  info << "KLEE: precompiled external call sites = " << calls.size() << "\n";
+  info.flush();
+}
+
 void Executor::bindModuleConstants(const llvm::APFloat::roundingMode rm) {
-  for (auto &kfp : kmodule->functions) {
-    KFunction *kf = kfp.get();
+  constantRoundingMode = rm;
+  boundFunctions = 0;
+  boundConstants = 0;
+  kmodule->constantTable = nullptr;
+  bindNewConstants();
+}
+
+void Executor::bindNewConstants() {
+  for (; boundFunctions < kmodule->functions.size(); ++boundFunctions) {
+    KFunction *kf = kmodule->functions[boundFunctions].get();
     for (unsigned i=0; i<kf->numInstructions; ++i)
       bindInstructionConstants(kf->instructions[i]);
   }
 
-  kmodule->constantTable =
-      std::unique_ptr<Cell[]>(new Cell[kmodule->constants.size()]);
-  for (unsigned i=0; i<kmodule->constants.size(); ++i) {
-    Cell &c = kmodule->constantTable[i];
-    c.value = evalConstant(kmodule->constants[i], rm);
-  }
+  std::size_t numConstants = kmodule->constants.size();
+  if (kmodule->constantTable && boundConstants == numConstants)
+    return;
+  std::unique_ptr<Cell[]> table(new Cell[numConstants]);
+  if (kmodule->constantTable)
+    std::move(kmodule->constantTable.get(),
+              kmodule->constantTable.get() + boundConstants, table.get());
+  for (; boundConstants < numConstants; ++boundConstants) {
+    Cell &c = table[boundConstants];
+    c.value = evalConstant(kmodule->constants[boundConstants],
+                           constantRoundingMode);
+  }
+  kmodule->constantTable = std::move(table);
 }
 
-bool Executor::checkMemoryUsage() {
+KFunction *Executor::getKFunction(Function *f) {
+  KFunction *kf = kmodule->getKFunction(f);
+  // Before the first run, bindModuleConstants binds all functions at once.
+  if (kmodule->constantTable && boundFunctions < kmodule->functions.size())
+    bindNewConstants();
+  return kf;
+}
+
+bool Executor::checkMemoryUsage(const ExecutionState *current) {
   if (!MaxMemory) return true;
 
   // We need to avoid calling GetTotalMallocUsage() often because it
@@ -3687,7 +4020,7 @@ bool Executor::checkMemoryUsage() {
   // check memory limit
   const auto mallocUsage = util::GetTotalMallocUsage() >> 20U;
   const auto mmapUsage = memory->getUsedDeterministicSize() >> 20U;
-  const auto totalUsage = mallocUsage + mmapUsage;
+  auto totalUsage = mallocUsage + mmapUsage;
   atMemoryLimit = totalUsage > MaxMemory; // inhibit forking
   if (!atMemoryLimit)
     return true;
@@ -3696,6 +4029,15 @@ bool Executor::checkMemoryUsage() {
   if (totalUsage <= MaxMemory + 100)
     return true;
 
+  // try to get back below the cap by swapping out states first
+  if (stateSwapper &&
+      swapOutStates((totalUsage - MaxMemory) << 20U, current)) {
+    totalUsage = (util::GetTotalMallocUsage() >> 20U) + mmapUsage;
+    atMemoryLimit = totalUsage > MaxMemory;
+    if (totalUsage <= MaxMemory + 100)
+      return true;
+  }
+
   // just guess at how many to kill
   const auto numStates = states.size();
   auto toKill = std::max(1UL, numStates - numStates * MaxMemory / totalUsage);
@@ -3717,6 +4059,48 @@ bool Executor::checkMemoryUsage() {
   return false;
 }
 
+std::uint64_t Executor::swapOutStates(std::uint64_t bytes,
+                                      const ExecutionState *current) {
+  std::vector<ExecutionState *> candidates;
+  for (const auto &state : states) {
+    if (state != current && !stateSwapper->isSwappedOut(*state))
+      candidates.push_back(state);
+  }
+
+  // paused states first, then those that went longest without new coverage
+  std::sort(candidates.begin(), candidates.end(),
+            [this](ExecutionState *a, ExecutionState *b) {
+              bool pausedA = pausedStates.count(a), pausedB = pausedStates.count(b);
+              if (pausedA != pausedB)
+                return pausedA;
+              if (a->coveredNew != b->coveredNew)
+                return !a->coveredNew;
+              return a->instsSinceCovNew > b->instsSinceCovNew;
+            });
+
+  std::uint64_t freed = 0;
+  unsigned swapped = 0;
+  for (ExecutionState *state : candidates) {
+    if (freed >= bytes)
+      break;
+    if (std::uint64_t n = stateSwapper->swapOut(*state)) {
+      freed += n;
+      ++swapped;
+    }
+  }
+
+  if (swapped)
+    klee_warning("swapped out %u states (%luMB, %zu states swapped out in total)",
+                 swapped, (unsigned long)(freed >> 20U),
+                 stateSwapper->getNumSwappedStates());
+  return freed;
+}
+
+void Executor::makeResident(ExecutionState &state) {
+  if (stateSwapper && stateSwapper->isSwappedOut(state))
+    stateSwapper->swapIn(state);
+}
+
 void Executor::doDumpStates() {
   if (!DumpStatesOnHalt || states.empty())
     return;
@@ -3735,6 +4119,8 @@ void Executor::seed(ExecutionState &initialState) {
   for (std::vector<KTest*>::const_iterator it = usingSeeds->begin(),
          ie = usingSeeds->end(); it != ie; ++it)
     v.push_back(SeedInfo(*it));
+  seedsRemaining = v.size();
+  recordSensitiveDepths = userSearcherRequiresZESTI();
 
   int lastNumSeeds = usingSeeds->size()+10;
   time::Point lastTime, startTime = lastTime = time::getWallTime();
@@ -3761,13 +4147,7 @@ void Executor::seed(ExecutionState &initialState) {
     updateStates(&state);
 
     if ((stats::instructions % 1000) == 0) {
-      int numSeeds = 0, numStates = 0;
-      for (std::map<ExecutionState*, std::vector<SeedInfo> >::iterator
-             it = seedMap.begin(), ie = seedMap.end();
-           it != ie; ++it) {
-        numSeeds += it->second.size();
-        numStates++;
-      }
+      int numSeeds = seedsRemaining, numStates = seedMap.size();
       const auto time = time::getWallTime();
       const time::Span seedTime(SeedTime);
       if (seedTime && time > startTime + seedTime) {
@@ -3784,6 +4164,7 @@ void Executor::seed(ExecutionState &initialState) {
     }
   }
 
+  recordSensitiveDepths = false;
   klee_message("seeding done (%d states remain)", (int) states.size());
 
   if (OnlySeed) {
@@ -3830,7 +4211,9 @@ void Executor::runWithTarget(ExecutionState &state, KFunction *kf, KBlock *targe
     statsTracker->framePushed(state, 0);
 
   processTree = std::make_unique<PTree>(&state);
+  profiler::start(ProfileSamplingRate);
   targetedRun(state, target);
+  stopProfiling();
   processTree = nullptr;
 
   if (statsTracker)
@@ -3847,7 +4230,9 @@ void Executor::runGuided(ExecutionState &state, KFunction *kf) {
    statsTracker->framePushed(state, 0);
 
   processTree = std::make_unique<PTree>(&state);
+  profiler::start(ProfileSamplingRate);
   guidedRun(state);
+  stopProfiling();
   processTree = nullptr;
 
   // hack to clear memory objects
@@ -3860,12 +4245,48 @@ void Executor::runGuided(ExecutionState &state, KFunction *kf) {
     statsTracker->done();
 }
 
-void Executor::executeStep(ExecutionState &state) {
-  KInstruction *ki = state.pc;
+bool Executor::executeNatively(ExecutionState &state) {
+  // Automatic merges have to see every instruction a state reaches
+  if (!state.openMergeStack.empty())
+    return false;
+  ConcreteBlockJIT::Segment *segment = concreteBlockJIT->getSegment(state.pc);
+  if (!segment)
+    return false;
 
-  stepInstruction(state);
+  makeResident(state);
+  const std::size_t numInputs = segment->inputs.size();
+  SmallVector<uint64_t, 16> io(numInputs + segment->outputs.size());
+  const StackFrame &sf = state.stack.back();
+  for (std::size_t i = 0; i < numInputs; ++i) {
+    KInstruction *ki = segment->inputs[i].first;
+    int vnumber = ki->operands[segment->inputs[i].second];
+    const Cell &cell = vnumber < 0 ? kmodule->constantTable[-vnumber - 2]
+                                   : sf.locals[vnumber];
+    Expr::Width width;
+    if (!cell.getConcrete(io[i], width))
+      return false;
+  }
 
-  executeInstruction(state, ki);
+  ConcreteBlockJIT::NativeCode code = concreteBlockJIT->getCode(*segment);
+  if (!code)
+    return false;
+  code(io.data());
+
+  for (unsigned i = 0; i < segment->length; ++i)
+    stepInstruction(state);
+  for (std::size_t i = 0; i < segment->outputs.size(); ++i) {
+    KInstruction *ki = segment->outputs[i];
+    bindLocalConcrete(ki, state, io[numInputs + i]);
+  }
+  return true;
+}
+
+void Executor::executeStep(ExecutionState &state) {
+  if (!concreteBlockJIT || !executeNatively(state)) {
+    KInstruction *ki = state.pc;
+    stepInstruction(state);
+    executeInstruction(state, ki);
+  }
 
   timers.invoke();
   if (::dumpStates) dumpStates();
@@ -3873,7 +4294,7 @@ void Executor::executeStep(ExecutionState &state) {
 
   updateStates(&state);
 
-  if (!checkMemoryUsage()) {
+  if (!checkMemoryUsage(&state)) {
     // update searchers when states were terminated early due to memory pressure
     updateStates(nullptr);
   }
@@ -3945,7 +4366,7 @@ KBlock* Executor::calculateTarget(ExecutionState &state) {
   BasicBlock *initialBlock = state.getInitPCBlock();
   VisitedBlock &history = results[initialBlock].history;
   BasicBlock *bb = state.getPCBlock();
-  KFunction *kf = kmodule->functionMap[bb->getParent()];
+  KFunction *kf = getKFunction(bb->getParent());
   KBlock *kb = kf->blockMap[bb];
   KBlock *nearestBlock = nullptr;
   unsigned int minDistance = -1;
@@ -4095,6 +4516,9 @@ void Executor::terminateState(ExecutionState &state) {
       return;
   }
 
+  if (stateSwapper)
+    stateSwapper->discard(state);
+
   interpreterHandler->incPathsExplored();
 
   std::vector<ExecutionState *>::iterator ita =
@@ -4106,8 +4530,10 @@ void Executor::terminateState(ExecutionState &state) {
     // never reached searcher, just delete immediately
     std::map< ExecutionState*, std::vector<SeedInfo> >::iterator it3 = 
       seedMap.find(&state);
-    if (it3 != seedMap.end())
+    if (it3 != seedMap.end()) {
+      seedsRemaining -= it3->second.size();
       seedMap.erase(it3);
+    }
     addedStates.erase(ita);
     processTree->remove(state.ptreeNode);
     delete &state;
@@ -4118,9 +4544,11 @@ void Executor::terminateStateEarly(ExecutionState &state,
                                    const Twine &message) {
   if ((!OnlyOutputStatesCoveringNew || state.coveredNew ||
         (AlwaysOutputSeeds && seedMap.count(&state))) &&
-      !pausedStates.count(&state))
+      !pausedStates.count(&state)) {
+    makeResident(state);
     interpreterHandler->processTestCase(state, (message + "\n").str().c_str(),
                                         "early");
+  }
   terminateState(state);
 }
 
@@ -4143,6 +4571,7 @@ void Executor::terminateStateOnExit(ExecutionState &state) {
 }
 
 void Executor::terminateStateOnTerminator(ExecutionState &state) {
+  makeResident(state);
   if (!OnlyOutputStatesCoveringNew || state.coveredNew ||
       (AlwaysOutputSeeds && seedMap.count(&state)))
     interpreterHandler->processTestCase(state, 0, 0);
@@ -4257,22 +4686,12 @@ void Executor::terminateStateOnError(ExecutionState &state,
     haltExecution = true;
 }
 
-// XXX shoot me
-static const char *okExternalsList[] = { "printf", 
-                                         "fprintf", 
-                                         "puts",
-                                         "getpid" };
-static std::set<std::string> okExternals(okExternalsList,
-                                         okExternalsList + 
-                                         (sizeof(okExternalsList)/sizeof(okExternalsList[0])));
-
 void Executor::callExternalFunction(ExecutionState &state,
                                     KInstruction *target,
                                     Function *function,
                                     std::vector< ref<Expr> > &arguments) {
-  // check if specialFunctionHandler wants it
-  if (specialFunctionHandler->handle(state, function, target, arguments))
-    return;
+  // Special functions are dispatched by executeCall.
+  profiler::PhaseScope phase(profiler::Phase::ExternalCall, function);
 
   if (ExternalCalls == ExternalCallPolicy::None &&
       !okExternals.count(function->getName().str())) {
@@ -4632,6 +5051,11 @@ void Executor::resolveExact(ExecutionState &state,
   }
 }
 
+void Executor::recordSensitiveInstruction(ExecutionState &state) {
+  if (recordSensitiveDepths && seedMap.count(&state))
+    seedSensitiveDepths.insert(state.depth);
+}
+
 void Executor::executeMemoryOperation(ExecutionState &state,
                                       MemoryOperation operation,
                                       ref<Expr> address,
@@ -4643,15 +5067,16 @@ void Executor::executeMemoryOperation(ExecutionState &state,
     type = value->getWidth();
     break;
   case Read:
-    type = getWidthForLLVMType(target->inst->getType());
+    type = target->width;
     break;
   default:
     klee_error("unexpected type of memory operation");
   }
   unsigned bytes = Expr::getMinBytesForWidth(type);
 
-  ref<Expr> base = UseGEPExpr && isGEPExpr(address) ? gepExprBases[address].first : address;
-  unsigned size = UseGEPExpr && isGEPExpr(address) ? gepExprBases[address].second : bytes;
+  const GEPExprBases::Entry *gep = getGEPExprBase(state, address);
+  ref<Expr> base = gep ? gep->base : address;
+  unsigned size = gep ? gep->size : bytes;
 
   if (SimplifySymIndices) {
     if (!isa<ConstantExpr>(address))
@@ -4661,6 +5086,8 @@ void Executor::executeMemoryOperation(ExecutionState &state,
   }
 
   address = optimizer.optimizeExpr(address, true);
+  if (!isa<ConstantExpr>(address))
+    recordSensitiveInstruction(state);
 
   // fast path: single in-bounds resolution
   ObjectPair op;
@@ -4731,7 +5158,7 @@ void Executor::executeMemoryOperation(ExecutionState &state,
   bool incomplete;
 
   if (SkipNotLazyAndSymbolicPointers) {
-    if (UseGEPExpr && isGEPExpr(address))
+    if (getGEPExprBase(state, address))
       incomplete = state.addressSpace.fastResolve(
           state, solver, base, rl, 0,
           coreSolverTimeout);
@@ -4739,7 +5166,7 @@ void Executor::executeMemoryOperation(ExecutionState &state,
       incomplete = state.addressSpace.fastResolve(state, solver, address,
                                                   rl, 0, coreSolverTimeout);
   } else {
-    if (UseGEPExpr && isGEPExpr(address))
+    if (getGEPExprBase(state, address))
       incomplete = state.addressSpace.resolve(
           state, solver, base, rl, 0,
           coreSolverTimeout);
@@ -4759,7 +5186,7 @@ void Executor::executeMemoryOperation(ExecutionState &state,
 
     ref<Expr> inBounds;
 
-    if (UseGEPExpr && isGEPExpr(address))
+    if (getGEPExprBase(state, address))
       inBounds = mo->getBoundsCheckPointer(base, 1);
     else
       inBounds = mo->getBoundsCheckPointer(address, 1);
@@ -4771,7 +5198,7 @@ void Executor::executeMemoryOperation(ExecutionState &state,
     // bound can be 0 on failure or overlapped
     if (bound) {
       ref<Expr> inBounds = mo->getBoundsCheckPointer(address, bytes);
-      if (UseGEPExpr && isGEPExpr(address)) {
+      if (getGEPExprBase(state, address)) {
         inBounds = AndExpr::create(
             inBounds, mo->getBoundsCheckPointer(base, size));
       }
@@ -4812,7 +5239,7 @@ void Executor::executeMemoryOperation(ExecutionState &state,
   if (unbound) {
     if (incomplete) {
       terminateStateEarly(*unbound, "Query timed out (resolve).");
-    } else if (LazyInstantiation && (isa<ReadExpr>(address) || isa<ConcatExpr>(address) || (UseGEPExpr && isGEPExpr(address)))) {
+    } else if (LazyInstantiation && (isa<ReadExpr>(address) || isa<ConcatExpr>(address) || (getGEPExprBase(state, address)))) {
 
       if (!isReadFromSymbolicArray(base)) {
         terminateStateEarly(*unbound, "Instantiation source contains read from concrete array");
@@ -4990,7 +5417,7 @@ ExecutionState* Executor::formState(Function *f,
   for (envc=0; envp[envc]; ++envc) ;
 
   unsigned NumPtrBytes = Context::get().getPointerWidth() / 8;
-  KFunction *kf = kmodule->functionMap[f];
+  KFunction *kf = getKFunction(f);
   assert(kf);
   Function::arg_iterator ai = f->arg_begin(), ae = f->arg_end();
   if (ai!=ae) {
@@ -5017,7 +5444,7 @@ ExecutionState* Executor::formState(Function *f,
     }
   }
 
-  ExecutionState *state = new ExecutionState(kmodule->functionMap[f], kmodule->functionMap[f]->blockMap[&*f->begin()]);
+  ExecutionState *state = new ExecutionState(kf, kf->blockMap[&*f->begin()]);
 
   assert(arguments.size() == f->arg_size() && "wrong number of arguments");
   for (unsigned i = 0, e = f->arg_size(); i != e; ++i)
@@ -5056,6 +5483,8 @@ ExecutionState* Executor::formState(Function *f,
 void Executor::clearGlobal() {
   globalObjects.clear();
   globalAddresses.clear();
+  // The constants may refer to the cleared globals.
+  kmodule->constantTable = nullptr;
 }
 
 void Executor:: prepareSymbolicValue(ExecutionState &state, KInstruction *target) {
@@ -5122,7 +5551,9 @@ void Executor::runFunctionAsMain(Function *f,
 
   processTree = std::make_unique<PTree>(state);
   bindModuleConstants(llvm::APFloat::rmNearestTiesToEven);
+  profiler::start(ProfileSamplingRate);
   run(*state);
+  stopProfiling();
   processTree = nullptr;
 
   // hack to clear memory objects
@@ -5142,7 +5573,7 @@ void Executor::runFunctionGuided(Function *fn,
   ExecutionState *state = formState(fn, argc, argv, envp);
   state->popFrame();
   bindModuleConstants(llvm::APFloat::rmNearestTiesToEven);
-  KFunction *kf = kmodule->functionMap[fn];
+  KFunction *kf = getKFunction(fn);
   ExecutionState *initialState = state->withKFunction(kf);
   prepareSymbolicArgs(*initialState, kf);
   runGuided(*initialState, kf);
@@ -5154,7 +5585,7 @@ void Executor::runMainAsGuided(Function *mainFn,
                                       char **envp) {
   ExecutionState *state = formState(mainFn, argc, argv, envp);
   bindModuleConstants(llvm::APFloat::rmNearestTiesToEven);
-  KFunction *kf = kmodule->functionMap[mainFn];
+  KFunction *kf = getKFunction(mainFn);
   runGuided(*state, kf);
 }
 
@@ -5165,8 +5596,8 @@ void Executor::runMainWithTarget(Function *mainFn,
                                  char **envp) {
   ExecutionState *state = formState(mainFn, argc, argv, envp);
   bindModuleConstants(llvm::APFloat::rmNearestTiesToEven);
-  KFunction *kf = kmodule->functionMap[mainFn];
-  KBlock *kb = kmodule->functionMap[target->getParent()]->blockMap[target];
+  KFunction *kf = getKFunction(mainFn);
+  KBlock *kb = getKFunction(target->getParent())->blockMap[target];
   runWithTarget(*state, kf, kb);
   // hack to clear memory objects
   delete memory;
@@ -5489,11 +5920,22 @@ size_t Executor::getAllocationAlignment(const llvm::Value *allocSite) const {
   return alignment;
 }
 
+void Executor::stopProfiling() {
+  if (!ProfileSamplingRate)
+    return;
+
+  profiler::stop();
+  // The samples of all runs so far are written, replacing older output.
+  if (auto os = interpreterHandler->openOutputFile("profile.folded"))
+    profiler::writeFoldedStacks(*os);
+}
+
 void Executor::prepareForEarlyExit() {
   if (statsTracker) {
     // Make sure stats get flushed out
     statsTracker->done();
   }
+  stopProfiling();
 }
 
 /// Returns the errno location in memory
@@ -5566,8 +6008,10 @@ void Executor::dumpStates() {
   ::dumpStates = 0;
 }
 
-bool Executor::isGEPExpr(ref<Expr> expr) {
-  return gepExprBases.find(expr) != gepExprBases.end();
+const GEPExprBases::Entry *
+Executor::getGEPExprBase(const ExecutionState &state,
+                         const ref<Expr> &expr) const {
+  return UseGEPExpr ? state.gepExprBases.find(expr) : nullptr;
 }
 
 ///
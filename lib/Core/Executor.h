@@ -78,6 +78,9 @@ namespace klee {
   class Searcher;
   class SeedInfo;
   class SpecialFunctionHandler;
+  class AutoMergePoints;
+  class ConcreteBlockJIT;
+  class StateSwapper;
   struct StackFrame;
   class StatsTracker;
   class TimingSolver;
@@ -155,7 +158,24 @@ private:
   SpecialFunctionHandler *specialFunctionHandler;
   TimerGroup timers;
   std::unique_ptr<PTree> processTree;
-  std::map<ref<Expr>, std::pair<ref<Expr>, unsigned>> gepExprBases;
+  /// Non-null when states are swapped out rather than terminated at the
+  /// memory cap.
+  std::unique_ptr<StateSwapper> stateSwapper;
+  /// This process explores the paths that leave those of its seeds if
+  /// their hash is pathPartition modulo pathPartitions (see partitionPaths).
+  unsigned pathPartition = 0;
+  unsigned pathPartitions = 1;
+  /// Non-null when states are merged automatically (--auto-merge).
+  std::unique_ptr<AutoMergePoints> autoMergePoints;
+  /// Non-null when concrete code is run natively (--jit-concrete-blocks).
+  std::unique_ptr<ConcreteBlockJIT> concreteBlockJIT;
+
+  /// The prefix of kmodule->functions and kmodule->constants bound by
+  /// bindNewConstants, and the rounding mode it evaluates constants in.
+  std::size_t boundFunctions = 0;
+  std::size_t boundConstants = 0;
+  llvm::APFloat::roundingMode constantRoundingMode =
+      llvm::APFloat::rmNearestTiesToEven;
 
   /// Used to track states that have been added during the current
   /// instructions step. 
@@ -176,6 +196,17 @@ private:
   /// happens with other states (that don't satisfy the seeds) depends
   /// on as-yet-to-be-determined flags.
   std::map<ExecutionState*, std::vector<SeedInfo> > seedMap;
+
+  /// The number of seeds in \ref seedMap.
+  std::size_t seedsRemaining;
+
+  /// The depths at which states in \ref seedMap executed sensitive
+  /// instructions (memory accesses through symbolic pointers and divisions
+  /// by symbolic values), for the ZESTI searcher.
+  std::set<std::uint32_t> seedSensitiveDepths;
+
+  /// Whether \ref seedSensitiveDepths is to be recorded.
+  bool recordSensitiveDepths;
   
   /// Map of globals to their representative memory object.
   std::map<const llvm::GlobalValue*, MemoryObject*> globalObjects;
@@ -255,6 +286,59 @@ private:
   void addHistoryResult(ExecutionState &state);
 
   void executeInstruction(ExecutionState &state, KInstruction *ki);
+
+  /// The member executing an instruction, stored in KInstruction::handler.
+  typedef void (Executor::*InstructionHandler)(ExecutionState &state,
+                                               KInstruction *ki);
+  typedef ref<Expr> (*BinaryExprCreator)(const ref<Expr> &l,
+                                         const ref<Expr> &r);
+  typedef uint64_t (*BinaryIntEvaluator)(uint64_t l, uint64_t r,
+                                         unsigned inWidth);
+  typedef ref<Expr> (*CastExprCreator)(const ref<Expr> &e, Expr::Width w);
+  typedef uint64_t (*CastIntEvaluator)(uint64_t l, unsigned outWidth,
+                                       unsigned inWidth);
+
+  /// Decode the handler of \p i from its opcode and, for comparisons, its
+  /// predicate, so that executeInstruction calls it directly.
+  static InstructionHandler getInstructionHandler(const llvm::Instruction *i);
+
+  /// Execute the instructions without a handler of their own.
+  void executeGenericInstruction(ExecutionState &state, KInstruction *ki);
+
+  template <BinaryExprCreator Create>
+  void executeBinaryInstruction(ExecutionState &state, KInstruction *ki);
+  /// Execute integer arithmetic or a comparison on inline register values
+  /// when both operands are concrete values of at most 64 bits, without
+  /// allocating expressions.
+  template <BinaryExprCreator Create, BinaryIntEvaluator Evaluate>
+  void executeIntegerInstruction(ExecutionState &state, KInstruction *ki);
+  template <BinaryExprCreator Create>
+  void executeDivisionInstruction(ExecutionState &state, KInstruction *ki);
+  template <CastExprCreator Create>
+  void executeCastInstruction(ExecutionState &state, KInstruction *ki);
+  /// Execute an integer cast on an inline register value when the operand
+  /// is a concrete value of at most 64 bits.
+  template <CastExprCreator Create, CastIntEvaluator Evaluate>
+  void executeIntegerCastInstruction(ExecutionState &state, KInstruction *ki);
+  void executePHI(ExecutionState &state, KInstruction *ki);
+  void executeSelect(ExecutionState &state, KInstruction *ki);
+  void executeLoad(ExecutionState &state, KInstruction *ki);
+  void executeStore(ExecutionState &state, KInstruction *ki);
+  void executeGetElementPtr(ExecutionState &state, KInstruction *ki);
+
+  /// Run the straight-line code at the pc of \p state natively, if it is
+  /// hot and all its inputs are concrete. Returns false if nothing was run.
+  bool executeNatively(ExecutionState &state);
+
+  /// Open an automatic merge for the states a branch \p ki has forked
+  /// into, if it is worth merging them.
+  void openAutoMerge(KInstruction *ki,
+                     const std::vector<ExecutionState *> &branches);
+
+  /// Close the automatic merges of \p state that end at \p ki and leave
+  /// those it can no longer be merged by. Returns true if \p state was
+  /// paused or merged into another state instead of executing \p ki.
+  bool updateAutoMerges(ExecutionState &state, KInstruction *ki);
   void targetedRun(ExecutionState &initialState, KBlock *target);
   void guidedRun(ExecutionState &initialState);
 
@@ -357,7 +441,20 @@ private:
                    KInstruction *ki,
                    llvm::Function *f,
                    std::vector< ref<Expr> > &arguments);
+
+  /// Resolve how calls to \p f are executed. The KFunction of internal
+  /// functions is left to getCallDispatch, so that resolving does not
+  /// construct functions.
+  CallDispatch resolveCall(llvm::Function *f) const;
+
+  /// Return the dispatch of the call \p ki to \p f, resolving it again if
+  /// \p f differs from the function it was last resolved for.
+  const CallDispatch &getCallDispatch(KInstruction *ki, llvm::Function *f);
                    
+  /// Record the depth of a sensitive instruction if \p state is seeded
+  /// (see \ref seedSensitiveDepths).
+  void recordSensitiveInstruction(ExecutionState &state);
+
   // do address resolution / object binding / out of bounds checking
   // and perform the operation
   void executeMemoryOperation(ExecutionState &state,
@@ -383,6 +480,17 @@ private:
   void executeMakeSymbolic(ExecutionState &state, const MemoryObject *mo,
                            const std::string &name, bool isAlloca);
 
+  /// Find the successors of a symbolic switch on \p cond that \p state can
+  /// take, by enumerating models of \p cond instead of querying each case.
+  /// \param cases The case values whose successor is not \p defaultDest;
+  /// values that are out of the range of \p cond are removed.
+  /// \return False if a query failed, in which case \p feasible is
+  /// incomplete.
+  bool getFeasibleSwitchTargets(ExecutionState &state, ref<Expr> cond,
+                                std::map<ref<Expr>, llvm::BasicBlock *> &cases,
+                                llvm::BasicBlock *defaultDest,
+                                std::set<llvm::BasicBlock *> &feasible);
+
   /// Create a new state where each input condition has been added as
   /// a constraint and return the results. The input state is included
   /// as one of the results. Note that the output vector may included
@@ -396,6 +504,10 @@ private:
   // current state, and one of the states may be null.
   StatePair fork(ExecutionState &current, ref<Expr> condition, bool isInternal);
 
+  // Terminate a state that has just left the paths of the seeds if another
+  // process explores its path instead. Returns false if it was terminated.
+  bool keepUnseededPath(ExecutionState &state);
+
   /// Add the given (boolean) condition as a constraint on state. This
   /// function is a wrapper around the state's addConstraint function
   /// which also manages propagation of implied values,
@@ -423,9 +535,19 @@ private:
     return state.stack.back().locals[target->dest];
   }
 
+  /// Read operand \p index of \p ki if it is a concrete value of at most
+  /// 64 bits, without creating its ConstantExpr.
+  bool evalConcrete(KInstruction *ki, unsigned index, ExecutionState &state,
+                    uint64_t &bits, Expr::Width &width) const;
+
   void bindLocal(KInstruction *target, 
                  ExecutionState &state, 
                  ref<Expr> value);
+  /// Bind the concrete result \p bits of \p target inline.
+  void bindLocalConcrete(KInstruction *target, ExecutionState &state,
+                         uint64_t bits) {
+    getDestCell(state, target).setInline(bits, target->width);
+  }
   void bindArgument(KFunction *kf, 
                     unsigned index,
                     ExecutionState &state,
@@ -504,9 +626,25 @@ private:
     terminateStateOnError(state, message, Exec, NULL, info);
   }
 
+  /// stopProfiling - Stop the sampling profiler, if enabled, and write out
+  /// its samples.
+  void stopProfiling();
+
+  /// precompileExternalCalls - Compile the external dispatch stubs for all
+  /// direct calls to external functions in the module.
+  void precompileExternalCalls();
+
   /// bindModuleConstants - Initialize the module constant table.
   void bindModuleConstants(const llvm::APFloat::roundingMode rm);
 
+  /// Bind the instructions and constants of the functions constructed since
+  /// the last binding, growing the constant table.
+  void bindNewConstants();
+
+  /// Return the KFunction of \p f, constructing and binding it if it is
+  /// reached for the first time (see --lazy-functions).
+  KFunction *getKFunction(llvm::Function *f);
+
   template <typename SqType, typename TypeIt>
   void computeOffsetsSeqTy(KGEPInstruction *kgepi,
                            ref<ConstantExpr> &constantOffset, uint64_t index,
@@ -525,7 +663,16 @@ private:
 
   /// check memory usage and terminate states when over threshold of -max-memory + 100MB
   /// \return true if below threshold, false otherwise (states were terminated)
-  bool checkMemoryUsage();
+  bool checkMemoryUsage(const ExecutionState *current);
+
+  /// Swap out states other than \p current, least promising first, until
+  /// about \p bytes were freed.
+  /// \return The number of bytes freed.
+  std::uint64_t swapOutStates(std::uint64_t bytes,
+                              const ExecutionState *current);
+
+  /// Swap in \p state if it was swapped out.
+  void makeResident(ExecutionState &state);
 
   /// check if branching/forking is allowed
   bool branchingPermitted(const ExecutionState &state) const;
@@ -571,6 +718,11 @@ public:
     usingSeeds = seeds;
   }
 
+  void partitionPaths(unsigned job, unsigned jobs) override {
+    pathPartition = job;
+    pathPartitions = jobs;
+  }
+
   ExecutionState *formState(llvm::Function *f, int argc, char **argv, char **envp);
 
   void clearGlobal();
@@ -634,7 +786,10 @@ public:
   void executeStep(ExecutionState &state);
   bool tryBoundedExecuteStep(ExecutionState &state, unsigned bound);
   KBlock* calculateTarget(ExecutionState &state);
-  bool isGEPExpr(ref<Expr> expr);
+  /// \return The base and access size of \p expr if \p state computed it
+  /// with a symbolic GEP, otherwise null.
+  const GEPExprBases::Entry *getGEPExprBase(const ExecutionState &state,
+                                            const ref<Expr> &expr) const;
 };
   
 } // End klee namespace
@@ -9,6 +9,8 @@
 
 #include "ExternalDispatcher.h"
 #include "klee/Config/Version.h"
+#include "klee/Support/ErrorHandling.h"
+#include "klee/Support/OptionCategories.h"
 
 #if LLVM_VERSION_CODE < LLVM_VERSION(8, 0)
 #include "llvm/IR/CallSite.h"
@@ -19,19 +21,35 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
-#include "llvm/ExecutionEngine/GenericValue.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/TargetSelect.h"
 
 #include <csetjmp>
 #include <csignal>
 #include <cfenv>
+#include <set>
 
 using namespace llvm;
 using namespace klee;
 
+namespace {
+cl::opt<std::string> ExternalStubCacheDir(
+    "external-stub-cache-dir",
+    cl::desc("Directory in which compiled external call stubs are kept "
+             "between runs (default=off)"),
+    cl::init(""), cl::cat(klee::ExtCallsCat));
+}
+
 /***/
 
 static sigjmp_buf escapeCallJmpBuf;
@@ -43,21 +61,99 @@ static void sigsegv_handler(int signal, siginfo_t *info, void *context) {
 }
 }
 
+// FIXME: This is not reentrant.
+static uint64_t *gTheArgsP;
+static void *gTheTargetP;
+
 namespace klee {
 
+/// Persists the objects compiled for dispatch stub modules so that later
+/// runs can skip code generation. Stub modules are named after a hash of
+/// the signatures they contain, and reference the call target and argument
+/// buffer only through symbols that are relocated at load time, so their
+/// objects do not depend on the address space layout of the process.
+class DispatchObjectCache : public llvm::ObjectCache {
+private:
+  std::string directory;
+
+  bool getCachePath(const llvm::Module *M, SmallVectorImpl<char> &path) {
+    StringRef id = M->getModuleIdentifier();
+    if (!id.startswith("klee_dispatch_"))
+      return false;
+    path.clear();
+    sys::path::append(path, directory, id + ".o");
+    return true;
+  }
+
+public:
+  explicit DispatchObjectCache(const std::string &directory)
+      : directory(directory) {}
+
+  void notifyObjectCompiled(const llvm::Module *M,
+                            llvm::MemoryBufferRef obj) override {
+    SmallString<128> path;
+    if (!getCachePath(M, path))
+      return;
+
+    // Write to a temporary file first so that concurrent KLEE processes
+    // never load a partially written object.
+    int fd;
+    SmallString<128> tmpPath;
+    if (sys::fs::createUniqueFile(Twine(path) + ".tmp-%%%%%%", fd, tmpPath))
+      return;
+    {
+      raw_fd_ostream os(fd, /*shouldClose=*/true);
+      os << obj.getBuffer();
+    }
+    if (sys::fs::rename(tmpPath, path))
+      sys::fs::remove(tmpPath);
+  }
+
+  std::unique_ptr<llvm::MemoryBuffer>
+  getObject(const llvm::Module *M) override {
+    SmallString<128> path;
+    if (!getCachePath(M, path))
+      return nullptr;
+    auto buffer = MemoryBuffer::getFile(path);
+    if (!buffer)
+      return nullptr;
+    return std::move(*buffer);
+  }
+};
+
 class ExternalDispatcherImpl {
 private:
-  typedef std::map<const llvm::Instruction *, llvm::Function *> dispatchers_ty;
+  typedef void (*stub_ty)();
+  struct Dispatch {
+    stub_ty stub;
+    void *target;
+  };
+
+  /// Call sites (and the function they were resolved to) seen so far.
+  typedef std::map<std::pair<const llvm::Instruction *, const llvm::Function *>,
+                   Dispatch>
+      dispatchers_ty;
   dispatchers_ty dispatchers;
+  /// Compiled stubs, keyed by the name derived from their signature.
+  std::map<std::string, stub_ty> stubs;
+  /// Native addresses of the external functions, null if unresolvable.
+  std::map<const llvm::Function *, void *> targets;
+
+  std::string getStubName(llvm::Function *f, llvm::Instruction *i);
   llvm::Function *createDispatcher(llvm::Function *f, llvm::Instruction *i,
+                                   const std::string &name,
                                    llvm::Module *module);
+  void *getTargetAddress(llvm::Function *f);
+  const Dispatch &getDispatch(llvm::Function *f, llvm::Instruction *i);
   llvm::ExecutionEngine *executionEngine;
+  std::unique_ptr<DispatchObjectCache> objectCache;
   LLVMContext &ctx;
   std::map<std::string, void *> preboundFunctions;
-  bool runProtectedCall(llvm::Function *f, uint64_t *args);
+  bool runProtectedCall(const Dispatch &dispatch, uint64_t *args);
   llvm::Module *singleDispatchModule;
   std::vector<std::string> moduleIDs;
   std::string &getFreshModuleID();
+  std::string &getStubModuleID(const std::set<std::string> &stubNames);
   int lastErrno;
 
 public:
@@ -65,7 +161,12 @@ public:
   ~ExternalDispatcherImpl();
   bool executeCall(llvm::Function *function, llvm::Instruction *i,
                    uint64_t *args, int roundingMode);
+  void compileStubs(
+      const std::vector<std::pair<llvm::Function *, llvm::Instruction *>>
+          &calls);
   void *resolveSymbol(const std::string &name);
+  void *compileFunction(std::unique_ptr<llvm::Module> module,
+                        const std::string &name);
   int getLastErrno();
   void setLastErrno(int newErrno);
 };
@@ -83,6 +184,19 @@ std::string &ExternalDispatcherImpl::getFreshModuleID() {
   return moduleIDs.back();
 }
 
+std::string &
+ExternalDispatcherImpl::getStubModuleID(const std::set<std::string> &stubNames) {
+  // Derived from the stubs only, so that the same set of stubs gets the same
+  // module (and object cache entry) in every run.
+  llvm::MD5 hash;
+  for (const auto &name : stubNames)
+    hash.update(name);
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  moduleIDs.push_back("klee_dispatch_module_" + result.digest().str().str());
+  return moduleIDs.back();
+}
+
 void *ExternalDispatcherImpl::resolveSymbol(const std::string &name) {
   assert(executionEngine);
 
@@ -129,6 +243,30 @@ ExternalDispatcherImpl::ExternalDispatcherImpl(LLVMContext &ctx)
     abort();
   }
 
+  if (!ExternalStubCacheDir.empty()) {
+    if (std::error_code ec =
+            sys::fs::create_directories(ExternalStubCacheDir)) {
+      klee_warning("Unable to create external stub cache directory %s: %s",
+                   ExternalStubCacheDir.c_str(), ec.message().c_str());
+    } else {
+      objectCache.reset(new DispatchObjectCache(ExternalStubCacheDir));
+      executionEngine->setObjectCache(objectCache.get());
+    }
+  }
+
+  // The stubs find their arguments and call target through these two
+  // globals. Binding them here instead of embedding their addresses in the
+  // stubs keeps the generated code position independent.
+  auto argsGV = new GlobalVariable(
+      *singleDispatchModule,
+      PointerType::getUnqual(Type::getInt64Ty(ctx)), false,
+      GlobalValue::ExternalLinkage, nullptr, "klee_dispatch_args");
+  executionEngine->addGlobalMapping(argsGV, &gTheArgsP);
+  auto targetGV = new GlobalVariable(
+      *singleDispatchModule, Type::getInt8PtrTy(ctx), false,
+      GlobalValue::ExternalLinkage, nullptr, "klee_dispatch_target");
+  executionEngine->addGlobalMapping(targetGV, &gTheTargetP);
+
   // If we have a native target, initialize it to ensure it is linked in and
   // usable by the JIT.
   llvm::InitializeNativeTarget();
@@ -157,86 +295,147 @@ ExternalDispatcherImpl::~ExternalDispatcherImpl() {
   // we don't need to delete any of them.
 }
 
+void *ExternalDispatcherImpl::getTargetAddress(Function *f) {
+  auto it = targets.find(f);
+  if (it != targets.end())
+    return it->second;
+
+  void *addr = nullptr;
+#ifdef WINDOWS
+  std::map<std::string, void *>::iterator it2 =
+      preboundFunctions.find(f->getName());
+  if (it2 != preboundFunctions.end())
+    addr = it2->second;
+#endif
+  if (!addr)
+    addr = resolveSymbol(f->getName().str());
+  targets.insert(std::make_pair(f, addr));
+  return addr;
+}
+
+void ExternalDispatcherImpl::compileStubs(
+    const std::vector<std::pair<Function *, Instruction *>> &calls) {
+  // Call sites whose stub still has to be generated, with the stub name.
+  std::vector<std::pair<std::pair<Function *, Instruction *>, std::string>>
+      pending;
+  std::set<std::string> pendingNames;
+
+  for (const auto &call : calls) {
+    Function *f = call.first;
+    Instruction *i = call.second;
+    if (dispatchers.count(std::make_pair(i, f)))
+      continue;
+
+    void *target = getTargetAddress(f);
+    if (!target) {
+      dispatchers.insert(
+          std::make_pair(std::make_pair(i, f), Dispatch{nullptr, nullptr}));
+      continue;
+    }
+
+    std::string name = getStubName(f, i);
+    auto it = stubs.find(name);
+    if (it != stubs.end()) {
+      dispatchers.insert(
+          std::make_pair(std::make_pair(i, f), Dispatch{it->second, target}));
+      continue;
+    }
+    pendingNames.insert(name);
+    pending.push_back(std::make_pair(call, name));
+  }
+
+  if (pending.empty())
+    return;
+
+  // The MCJIT generates whole modules at a time, so all stubs that are
+  // still missing are put into one module and compiled together.
+  Module *dispatchModule = new Module(getStubModuleID(pendingNames), ctx);
+  for (const auto &p : pending) {
+    if (!dispatchModule->getFunction(p.second))
+      createDispatcher(p.first.first, p.first.second, p.second,
+                       dispatchModule);
+  }
+
+  executionEngine->addModule(
+      std::unique_ptr<Module>(dispatchModule)); // MCJIT takes ownership
+
+  // Force code generation. This ensures that any errors or assertions in
+  // the compilation process will trigger crashes instead of being caught as
+  // aborts in the external function.
+  for (const auto &name : pendingNames) {
+    uint64_t fnAddr = executionEngine->getFunctionAddress(name);
+    assert(fnAddr && "failed to get function address");
+    stubs.insert(std::make_pair(name, (stub_ty)fnAddr));
+  }
+  executionEngine->finalizeObject();
+
+  for (const auto &p : pending) {
+    Function *f = p.first.first;
+    Instruction *i = p.first.second;
+    dispatchers.insert(std::make_pair(
+        std::make_pair(i, f), Dispatch{stubs[p.second], getTargetAddress(f)}));
+  }
+}
+
+void *
+ExternalDispatcherImpl::compileFunction(std::unique_ptr<llvm::Module> module,
+                                        const std::string &name) {
+  executionEngine->addModule(std::move(module)); // MCJIT takes ownership
+  uint64_t fnAddr = executionEngine->getFunctionAddress(name);
+  assert(fnAddr && "failed to get function address");
+  executionEngine->finalizeObject();
+  return reinterpret_cast<void *>(fnAddr);
+}
+
+const ExternalDispatcherImpl::Dispatch &
+ExternalDispatcherImpl::getDispatch(Function *f, Instruction *i) {
+  auto key = std::make_pair(static_cast<const Instruction *>(i),
+                            static_cast<const Function *>(f));
+  dispatchers_ty::iterator it = dispatchers.find(key);
+  if (it != dispatchers.end())
+    return it->second;
+
+  // Code for this call site not JIT'ed. Do this now.
+  compileStubs({std::make_pair(f, i)});
+  it = dispatchers.find(key);
+  assert(it != dispatchers.end() && "call site not registered");
+  return it->second;
+}
+
 bool ExternalDispatcherImpl::executeCall(Function *f, Instruction *i,
                                          uint64_t *args, int roundingMode) {
-  dispatchers_ty::iterator it = dispatchers.find(i);
-    // Save current rounding mode used by KLEE internally and set the
-    // rounding mode needed during the external call.
+  const Dispatch &dispatch = getDispatch(f, i);
+
+  // Save current rounding mode used by KLEE internally and set the
+  // rounding mode needed during the external call.
   int oldRoundingMode = fegetround();
   bool success = !fesetround(roundingMode);
   if (!success) {
     llvm::errs() << "Failed to set rounding mode during external call\n";
     abort();
   }
-  bool result;
-  if (it != dispatchers.end()) {
-    // Code already JIT'ed for this
-    result = runProtectedCall(it->second, args);
-  } else {
-      // Code for this not JIT'ed. Do this now.
-      Function *dispatcher;
-#ifdef WINDOWS
-      std::map<std::string, void *>::iterator it2 =
-          preboundFunctions.find(f->getName());
-
-      if (it2 != preboundFunctions.end()) {
-        // only bind once
-        if (it2->second) {
-          executionEngine->addGlobalMapping(f, it2->second);
-          it2->second = 0;
-        }
-      }
-#endif
 
-      Module *dispatchModule = NULL;
-      // The MCJIT generates whole modules at a time so for every call that we
-      // haven't made before we need to create a new Module.
-      dispatchModule = new Module(getFreshModuleID(), ctx);
-      dispatcher = createDispatcher(f, i, dispatchModule);
-      dispatchers.insert(std::make_pair(i, dispatcher));
-
-      // Force the JIT execution engine to go ahead and build the function. This
-      // ensures that any errors or assertions in the compilation process will
-      // trigger crashes instead of being caught as aborts in the external
-      // function.
-      if (dispatcher) {
-          // The dispatchModule is now ready so tell MCJIT to generate the code for
-          // it.
-          auto dispatchModuleUniq = std::unique_ptr<Module>(dispatchModule);
-          executionEngine->addModule(
-                  std::move(dispatchModuleUniq)); // MCJIT takes ownership
-          // Force code generation
-          uint64_t fnAddr =
-                  executionEngine->getFunctionAddress(dispatcher->getName().str());
-          executionEngine->finalizeObject();
-          assert(fnAddr && "failed to get function address");
-          (void) fnAddr;
-      } else {
-          // MCJIT didn't take ownership of the module so delete it.
-          delete dispatchModule;
-      }
-      result = runProtectedCall(dispatcher, args);
-    }
-    // Restore rounding mode.
-    success =!fesetround(oldRoundingMode);
-    if (!success) {
-      llvm::errs() << "Failed to restore rounding mode after externall call\n";
-      abort();
-    }
-    return result;
+  bool result = runProtectedCall(dispatch, args);
+
+  // Restore rounding mode.
+  success = !fesetround(oldRoundingMode);
+  if (!success) {
+    llvm::errs() << "Failed to restore rounding mode after externall call\n";
+    abort();
+  }
+  return result;
 }
 
-// FIXME: This is not reentrant.
-static uint64_t *gTheArgsP;
-bool ExternalDispatcherImpl::runProtectedCall(Function *f, uint64_t *args) {
+bool ExternalDispatcherImpl::runProtectedCall(const Dispatch &dispatch,
+                                              uint64_t *args) {
   struct sigaction segvAction, segvActionOld;
   bool res;
 
-  if (!f)
+  if (!dispatch.stub)
     return false;
 
-  std::vector<GenericValue> gvArgs;
   gTheArgsP = args;
+  gTheTargetP = dispatch.target;
 
   segvAction.sa_handler = nullptr;
   sigemptyset(&(segvAction.sa_mask));
@@ -249,7 +448,7 @@ bool ExternalDispatcherImpl::runProtectedCall(Function *f, uint64_t *args) {
     res = false;
   } else {
     errno = lastErrno;
-    executionEngine->runFunction(f, gvArgs);
+    dispatch.stub();
     // Explicitly acquire errno information
     lastErrno = errno;
     res = true;
@@ -259,22 +458,100 @@ bool ExternalDispatcherImpl::runProtectedCall(Function *f, uint64_t *args) {
   return res;
 }
 
-// FIXME: This might have been relevant for the old JIT but the MCJIT
-// has a completly different implementation so this comment below is
-// likely irrelevant and misleading.
-//
+/// Attributes that change how an argument or the return value is passed
+/// and therefore have to be reproduced on the call made by the stub.
+static const Attribute::AttrKind abiAttributes[] = {
+    Attribute::ZExt, Attribute::SExt, Attribute::InReg, Attribute::ByVal,
+    Attribute::StructRet};
+
+/// Print the parts of \p type that determine how a value of it is passed.
+/// All pointers are passed alike, so their pointee is omitted; aggregates are
+/// spelled out rather than named so that the result does not depend on the
+/// struct names of a particular module.
+static void printABIType(raw_ostream &os, Type *type) {
+  if (type->isPointerTy()) {
+    os << "ptr";
+  } else if (StructType *st = dyn_cast<StructType>(type)) {
+    os << (st->isPacked() ? "<{" : "{");
+    for (unsigned i = 0; i < st->getNumElements(); ++i) {
+      if (i)
+        os << ",";
+      printABIType(os, st->getElementType(i));
+    }
+    os << (st->isPacked() ? "}>" : "}");
+  } else if (ArrayType *at = dyn_cast<ArrayType>(type)) {
+    os << "[" << at->getNumElements() << "x";
+    printABIType(os, at->getElementType());
+    os << "]";
+  } else {
+    type->print(os);
+  }
+}
+
+/// Stubs are shared by all call sites that pass their arguments and result
+/// in the same way, whatever the function being called. The stub name is a
+/// hash of that calling signature together with the host, so it can also
+/// be used to find the stub in the object cache of a later run.
+std::string ExternalDispatcherImpl::getStubName(Function *target,
+                                                Instruction *inst) {
+#if LLVM_VERSION_CODE >= LLVM_VERSION(8, 0)
+  const CallBase &cs = cast<CallBase>(*inst);
+#else
+  const CallSite cs(inst->getOpcode() == Instruction::Call
+                        ? CallSite(cast<CallInst>(inst))
+                        : CallSite(cast<InvokeInst>(inst)));
+#endif
+  FunctionType *FTy = target->getFunctionType();
+  const AttributeList &attrs = target->getAttributes();
+
+  std::string key;
+  llvm::raw_string_ostream ss(key);
+  ss << sys::getProcessTriple() << ";" << LLVM_VERSION_STRING << ";";
+  printABIType(ss, FTy->getReturnType());
+  for (auto kind : abiAttributes)
+    if (attrs.hasAttribute(AttributeList::ReturnIndex, kind))
+      ss << " " << attrs.getAttribute(AttributeList::ReturnIndex, kind)
+                       .getAsString();
+  ss << "(";
+  for (unsigned i = 0, e = cs.arg_size(); i != e; ++i) {
+    if (i >= FTy->getNumParams()) {
+      if (!FTy->isVarArg())
+        break;
+      ss << (i == FTy->getNumParams() ? "; ..." : "") << ", ";
+      printABIType(ss, cs.getArgOperand(i)->getType());
+      continue;
+    }
+    ss << ", ";
+    printABIType(ss, FTy->getParamType(i));
+    for (auto kind : abiAttributes) {
+      if (!attrs.hasParamAttribute(i, kind))
+        continue;
+      ss << " " << attrs.getParamAttr(i, kind).getAsString();
+      if (kind == Attribute::ByVal) {
+        ss << " align " << attrs.getParamAlignment(i) << " ";
+        printABIType(ss, FTy->getParamType(i)->getPointerElementType());
+      }
+    }
+  }
+  ss << (FTy->isVarArg() ? ", ...)" : ")");
+
+  llvm::MD5 hash;
+  hash.update(ss.str());
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  return "klee_dispatch_" + result.digest().str().str();
+}
+
 // For performance purposes we construct the stub in such a way that the
 // arguments pointer is passed through the static global variable gTheArgsP in
-// this file. This is done so that the stub function prototype trivially matches
-// the special cases that the JIT knows how to directly call. If this is not
-// done, then the jit will end up generating a nullary stub just to call our
-// stub, for every single function call.
+// this file, and the function to call through gTheTargetP. This is done so
+// that the stub function prototype is nullary and can be called directly,
+// and so that one stub serves every external function with the same calling
+// signature.
 Function *ExternalDispatcherImpl::createDispatcher(Function *target,
                                                    Instruction *inst,
+                                                   const std::string &name,
                                                    Module *module) {
-  if (!resolveSymbol(target->getName().str()))
-    return 0;
-
 #if LLVM_VERSION_CODE >= LLVM_VERSION(8, 0)
   const CallBase &cs = cast<CallBase>(*inst);
 #else
@@ -283,41 +560,37 @@ Function *ExternalDispatcherImpl::createDispatcher(Function *target,
                         : CallSite(cast<InvokeInst>(inst)));
 #endif
 
-  Value **args = new Value *[cs.arg_size()];
+  // Get the target function type.
+  FunctionType *FTy = target->getFunctionType();
 
-  std::vector<Type *> nullary;
+  // Arguments beyond the declared ones can only be passed to vararg
+  // functions.
+  unsigned numArgs = cs.arg_size();
+  if (!FTy->isVarArg() && numArgs > FTy->getNumParams())
+    numArgs = FTy->getNumParams();
+  std::vector<Value *> args(numArgs);
 
-  // MCJIT functions need unique names, or wrong function can be called.
-  // The module identifier is included because for the MCJIT we need
-  // unique function names across all `llvm::Modules`s.
-  std::string fnName =
-      "dispatcher_" + target->getName().str() + module->getModuleIdentifier();
+  std::vector<Type *> nullary;
   Function *dispatcher =
       Function::Create(FunctionType::get(Type::getVoidTy(ctx), nullary, false),
-                       GlobalVariable::ExternalLinkage, fnName, module);
+                       GlobalVariable::ExternalLinkage, name, module);
 
   BasicBlock *dBB = BasicBlock::Create(ctx, "entry", dispatcher);
 
   llvm::IRBuilder<> Builder(dBB);
-  // Get a Value* for &gTheArgsP, as an i64**.
-  auto argI64sp = Builder.CreateIntToPtr(
-      ConstantInt::get(Type::getInt64Ty(ctx), (uintptr_t)(void *)&gTheArgsP),
-      PointerType::getUnqual(PointerType::getUnqual(Type::getInt64Ty(ctx))),
-      "argsp");
+  // Get a Value* for gTheArgsP, as an i64*.
+  auto argI64sp = module->getOrInsertGlobal(
+      "klee_dispatch_args", PointerType::getUnqual(Type::getInt64Ty(ctx)));
   auto argI64s = Builder.CreateLoad(argI64sp, "args");
 
-  // Get the target function type.
-  FunctionType *FTy = cast<FunctionType>(
-      cast<PointerType>(target->getType())->getElementType());
-
   // Each argument will be passed by writing it into gTheArgsP[i].
-  unsigned i = 0, idx = 2;
-  for (auto ai = cs.arg_begin(), ae = cs.arg_end(); ai != ae; ++ai, ++i) {
+  unsigned idx = 2;
+  for (unsigned i = 0; i != numArgs; ++i) {
     // Determine the type the argument will be passed as. This accommodates for
     // the corresponding code in Executor.cpp for handling calls to bitcasted
     // functions.
-    auto argTy =
-        (i < FTy->getNumParams() ? FTy->getParamType(i) : (*ai)->getType());
+    auto argTy = (i < FTy->getNumParams() ? FTy->getParamType(i)
+                                          : cs.getArgOperand(i)->getType());
     auto argI64p =
         Builder.CreateGEP(nullptr, argI64s,
                           ConstantInt::get(Type::getInt32Ty(ctx), idx));
@@ -329,10 +602,29 @@ Function *ExternalDispatcherImpl::createDispatcher(Function *target,
     idx += ((!!argSize ? argSize : 64) + 63) / 64;
   }
 
-  auto dispatchTarget = module->getOrInsertFunction(target->getName(), FTy,
-                                                    target->getAttributes());
-  auto result = Builder.CreateCall(dispatchTarget,
-                                   llvm::ArrayRef<Value *>(args, args + i));
+  auto targetp = module->getOrInsertGlobal("klee_dispatch_target",
+                                           Type::getInt8PtrTy(ctx));
+  auto dispatchTarget = Builder.CreateBitCast(
+      Builder.CreateLoad(targetp, "target"), PointerType::getUnqual(FTy));
+  auto result = Builder.CreateCall(FTy, dispatchTarget, args);
+
+  // Only the attributes that are part of the stub name are reproduced, as
+  // the stub is shared with other functions of the same signature.
+  const AttributeList &attrs = target->getAttributes();
+  for (auto kind : abiAttributes) {
+    if (attrs.hasAttribute(AttributeList::ReturnIndex, kind))
+      result->addAttribute(AttributeList::ReturnIndex,
+                           attrs.getAttribute(AttributeList::ReturnIndex, kind));
+    for (unsigned i = 0; i < numArgs && i < FTy->getNumParams(); ++i) {
+      if (!attrs.hasParamAttribute(i, kind))
+        continue;
+      result->addParamAttr(i, attrs.getParamAttr(i, kind));
+      if (kind == Attribute::ByVal &&
+          attrs.hasParamAttribute(i, Attribute::Alignment))
+        result->addParamAttr(i, attrs.getParamAttr(i, Attribute::Alignment));
+    }
+  }
+
   if (result->getType() != Type::getVoidTy(ctx)) {
     auto resp = Builder.CreateBitCast(
         argI64s, PointerType::getUnqual(result->getType()));
@@ -341,8 +633,6 @@ Function *ExternalDispatcherImpl::createDispatcher(Function *target,
 
   Builder.CreateRetVoid();
 
-  delete[] args;
-
   return dispatcher;
 }
 
@@ -361,10 +651,21 @@ bool ExternalDispatcher::executeCall(llvm::Function *function,
   return impl->executeCall(function, i, args, roundingMode);
 }
 
+void ExternalDispatcher::compileStubs(
+    const std::vector<std::pair<llvm::Function *, llvm::Instruction *>>
+        &calls) {
+  impl->compileStubs(calls);
+}
+
 void *ExternalDispatcher::resolveSymbol(const std::string &name) {
   return impl->resolveSymbol(name);
 }
 
+void *ExternalDispatcher::compileFunction(std::unique_ptr<llvm::Module> module,
+                                          const std::string &name) {
+  return impl->compileFunction(std::move(module), name);
+}
+
 int ExternalDispatcher::getLastErrno() { return impl->getLastErrno(); }
 void ExternalDispatcher::setLastErrno(int newErrno) {
   impl->setLastErrno(newErrno);
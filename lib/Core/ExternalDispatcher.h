@@ -16,11 +16,14 @@
 #include <memory>
 #include <stdint.h>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace llvm {
 class Instruction;
 class LLVMContext;
 class Function;
+class Module;
 }
 
 namespace klee {
@@ -39,8 +42,22 @@ public:
    */
   bool executeCall(llvm::Function *function, llvm::Instruction *i,
                    uint64_t *args, int roundingMode);
+
+  /* Compile the stubs for the given external call sites, each paired with
+   * the function it calls, ahead of their first execution. Stubs are keyed
+   * by calling signature, so sites that share one are compiled only once.
+   */
+  void compileStubs(
+      const std::vector<std::pair<llvm::Function *, llvm::Instruction *>>
+          &calls);
   void *resolveSymbol(const std::string &name);
 
+  /* Compile \p module, which must not call any external function, and
+   * return the address of its function \p name.
+   */
+  void *compileFunction(std::unique_ptr<llvm::Module> module,
+                        const std::string &name);
+
   int getLastErrno();
   void setLastErrno(int newErrno);
 };
@@ -0,0 +1,76 @@
+//===-- GEPExprBases.cpp --------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "GEPExprBases.h"
+
+#include <algorithm>
+
+using namespace klee;
+
+namespace {
+/// Maps smaller than this are never pruned.
+const std::size_t minPruneSize = 1024;
+
+std::size_t totalEntries = 0;
+} // namespace
+
+class GEPExprBases::Map : public ExprHashMap<Entry> {
+public:
+  Map() = default;
+  Map(const Map &other) : ExprHashMap<Entry>(other) {
+    totalEntries += size();
+  }
+  ~Map() { totalEntries -= size(); }
+};
+
+GEPExprBases::GEPExprBases() : pruneSize(minPruneSize) {}
+
+GEPExprBases::Map &GEPExprBases::getWriteable() {
+  if (!map)
+    map = std::make_shared<Map>();
+  else if (map.use_count() > 1)
+    map = std::make_shared<Map>(*map);
+  return *map;
+}
+
+const GEPExprBases::Entry *
+GEPExprBases::find(const ref<Expr> &address) const {
+  if (!map)
+    return nullptr;
+  auto it = map->find(address);
+  return it == map->end() ? nullptr : &it->second;
+}
+
+void GEPExprBases::set(const ref<Expr> &address, const Entry &entry) {
+  Map &m = getWriteable();
+  auto result = m.insert(std::make_pair(address, entry));
+  if (!result.second) {
+    result.first->second = entry;
+    return;
+  }
+  ++totalEntries;
+
+  if (m.size() < pruneSize)
+    return;
+  // Only the map refers to these pointers, so they can not be looked up any
+  // more.
+  for (auto it = m.begin(); it != m.end();) {
+    if (it->first->_refCount.getCount() == 1) {
+      it = m.erase(it);
+      --totalEntries;
+    } else {
+      ++it;
+    }
+  }
+  pruneSize = std::max(minPruneSize, 2 * m.size());
+}
+
+std::size_t GEPExprBases::size() const { return map ? map->size() : 0; }
+
+std::size_t GEPExprBases::getTotalEntries() { return totalEntries; }
@@ -0,0 +1,59 @@
+//===-- GEPExprBases.h ------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_GEPEXPRBASES_H
+#define KLEE_GEPEXPRBASES_H
+
+#include "klee/Expr/Expr.h"
+#include "klee/Expr/ExprHashMap.h"
+
+#include <cstddef>
+#include <memory>
+
+namespace klee {
+  /// The base pointers and access sizes of the pointers a state computed with
+  /// symbolic GEPs (see --use-gep-expr).
+  ///
+  /// Forked states share their map until one of them changes it. Whenever a
+  /// map has doubled in size, the entries of pointers that are not referenced
+  /// from anywhere else any more are dropped.
+  class GEPExprBases {
+  public:
+    struct Entry {
+      ref<Expr> base;
+      unsigned size;
+    };
+
+  private:
+    class Map;
+
+    std::shared_ptr<Map> map;
+    /// The size at which dead entries are dropped next.
+    std::size_t pruneSize;
+
+    Map &getWriteable();
+
+  public:
+    GEPExprBases();
+
+    /// \return The entry of \p address, or null if it was not computed by a
+    /// symbolic GEP.
+    const Entry *find(const ref<Expr> &address) const;
+
+    void set(const ref<Expr> &address, const Entry &entry);
+
+    std::size_t size() const;
+
+    /// \return The number of entries of all maps, counting shared maps
+    /// once.
+    static std::size_t getTotalEntries();
+  };
+}
+
+#endif /* KLEE_GEPEXPRBASES_H */
@@ -200,6 +200,7 @@ public:
 class ObjectState {
 private:
   friend class AddressSpace;
+  friend class StateSwapper;
   friend class ref<ObjectState>;
 
   unsigned copyOnWriteOwner; // exclusively for AddressSpace
@@ -280,6 +281,7 @@ private:
   ref<Expr> read8(ref<Expr> offset) const;
   void write8(unsigned offset, ref<Expr> value);
   void write8(ref<Expr> offset, ref<Expr> value);
+  void writeConcrete(unsigned offset, uint64_t value, unsigned NumBytes);
 
   void fastRangeCheckOffset(ref<Expr> offset, unsigned *base_r, 
                             unsigned *size_r) const;
@@ -42,6 +42,28 @@ llvm::cl::opt<bool> DebugLogIncompleteMerge(
     llvm::cl::desc("Debug information for incomplete path merging (default=false)"),
     llvm::cl::cat(klee::MergeCat));
 
+llvm::cl::opt<bool> AutoMerge(
+    "auto-merge", llvm::cl::init(false),
+    llvm::cl::desc("Merge the states forked by a branch at its join point "
+                   "when query count estimation predicts that this pays off. "
+                   "Implies --use-merge (default=false)"),
+    llvm::cl::cat(klee::MergeCat));
+
+llvm::cl::opt<double> AutoMergeThreshold(
+    "auto-merge-threshold", llvm::cl::init(0.5),
+    llvm::cl::desc("Do not merge automatically where a value that differs "
+                   "between the merged states decides more than this "
+                   "fraction of the branches after the join point "
+                   "(default=0.5)"),
+    llvm::cl::cat(klee::MergeCat));
+
+llvm::cl::opt<unsigned> AutoMergeWindow(
+    "auto-merge-window", llvm::cl::init(10000),
+    llvm::cl::desc("Number of instructions after a branch within which a "
+                   "state has to reach the join point to be merged "
+                   "automatically (default=10000)"),
+    llvm::cl::cat(klee::MergeCat));
+
 double MergeHandler::getMean() {
   if (closedStateCount == 0)
     return 0;
@@ -105,7 +127,10 @@ void MergeHandler::addClosedState(ExecutionState *es,
     bool mergedSuccessful = false;
 
     for (auto& mState: cpv) {
+      executor->makeResident(*mState);
       if (mState->merge(*es)) {
+        if (DebugLogMerge)
+          llvm::errs() << "merged: " << es << " into " << mState << "\n";
         executor->terminateState(*es);
         executor->mergingSearcher->inCloseMerge.erase(es);
         mergedSuccessful = true;
@@ -133,13 +158,34 @@ bool MergeHandler::hasMergedStates() {
   return (!reachedCloseMerge.empty());
 }
 
+bool MergeHandler::isJoinPoint(const ExecutionState *es,
+                               const KInstruction *ki) const {
+  return ki == join && es->stack.size() == stackSize;
+}
+
+bool MergeHandler::hasExpired(ExecutionState *es) {
+  return es->stack.size() < stackSize ||
+         getInstructionDistance(es) > AutoMergeWindow;
+}
+
 MergeHandler::MergeHandler(Executor *_executor, ExecutionState *es)
     : executor(_executor), openInstruction(es->steppedInstructions),
-      closedMean(0), closedStateCount(0) {
+      closedMean(0), closedStateCount(0), join(nullptr), stackSize(0) {
     executor->mergingSearcher->mergeGroups.push_back(this);
   addOpenState(es);
 }
 
+MergeHandler::MergeHandler(Executor *_executor,
+                           const std::vector<ExecutionState *> &states,
+                           const KInstruction *join)
+    : executor(_executor), openInstruction(states[0]->steppedInstructions),
+      closedMean(0), closedStateCount(0), join(join),
+      stackSize(states[0]->stack.size()) {
+  executor->mergingSearcher->mergeGroups.push_back(this);
+  for (ExecutionState *es : states)
+    addOpenState(es);
+}
+
 MergeHandler::~MergeHandler() {
   auto it = std::find(executor->mergingSearcher->mergeGroups.begin(),
                       executor->mergingSearcher->mergeGroups.end(), this);
@@ -64,6 +64,14 @@
  * possible) will be continued without waiting for the remaining states. When a
  * remaining state now enters a close-merge point, it will again wait for the
  * other states, or until the 'timeout' is reached.
+ *
+ * # Automatic State Merging
+ *
+ * With --auto-merge, the Executor opens a merge region itself whenever a
+ * branch forks at which klee::AutoMergePoints expects merging to pay off,
+ * and closes it when a state reaches the join point of the branch in the
+ * same stack frame. A state that stays in such a region for more than
+ * --auto-merge-window instructions leaves it without being merged.
 */
 
 #ifndef KLEE_MERGEHANDLER_H
@@ -88,8 +96,15 @@ extern llvm::cl::opt<bool> DebugLogMerge;
 
 extern llvm::cl::opt<bool> DebugLogIncompleteMerge;
 
+extern llvm::cl::opt<bool> AutoMerge;
+
+extern llvm::cl::opt<double> AutoMergeThreshold;
+
+extern llvm::cl::opt<unsigned> AutoMergeWindow;
+
 class Executor;
 class ExecutionState;
+struct KInstruction;
 
 /// @brief Represents one `klee_open_merge()` call. 
 /// Handles merging of states that branched from it
@@ -108,8 +123,12 @@ private:
   /// into a relevant klee_close_merge
   unsigned closedStateCount;
 
-  /// @brief Get distance of state from the openInstruction
-  unsigned getInstructionDistance(ExecutionState *es);
+  /// @brief For automatic merges, the join point at which states are merged
+  const KInstruction *join;
+
+  /// @brief For automatic merges, the stack size of the states at the join
+  /// point
+  size_t stackSize;
 
   /// @brief States that ran through the klee_open_merge, but not yet into a
   /// corresponding klee_close_merge
@@ -125,6 +144,20 @@ public:
   /// @brief Called when a state runs into a 'klee_close_merge()' call
   void addClosedState(ExecutionState *es, llvm::Instruction *mp);
 
+  /// @brief Get distance of state from the openInstruction
+  unsigned getInstructionDistance(ExecutionState *es);
+
+  /// @brief True for merges opened by --auto-merge rather than by a
+  /// 'klee_open_merge()' call
+  bool isAutomatic() const { return join != nullptr; }
+
+  /// @brief True if an automatic merge closes for \p es at \p ki
+  bool isJoinPoint(const ExecutionState *es, const KInstruction *ki) const;
+
+  /// @brief True if \p es can no longer be merged by this automatic merge,
+  /// as it returned from the function or ran out of its window
+  bool hasExpired(ExecutionState *es);
+
   /// @brief Return state that should be prioritized to complete this merge
   ExecutionState *getPrioritizeState();
 
@@ -150,6 +183,11 @@ public:
   class ReferenceCounter _refCount;
 
   MergeHandler(Executor *_executor, ExecutionState *es);
+
+  /// @brief Opens an automatic merge for the states \p states that have
+  /// just been forked, to be closed at \p join
+  MergeHandler(Executor *_executor, const std::vector<ExecutionState *> &states,
+               const KInstruction *join);
   ~MergeHandler();
 };
 }
@@ -15,7 +15,7 @@
 #include "klee/Expr/ExprPPrinter.h"
 #include "klee/Support/OptionCategories.h"
 
-#include <bitset>
+#include <algorithm>
 #include <vector>
 
 using namespace klee;
@@ -31,66 +31,145 @@ cl::opt<bool>
 
 } // namespace
 
+std::uint64_t PTree::getChildPathHash(std::uint64_t parent, unsigned side) {
+  // splitmix64 finalizer: children of nearby paths must not collide.
+  std::uint64_t h = parent * 2 + side + 0x9e3779b97f4a7c15ULL;
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+  return h ^ (h >> 31);
+}
+
+constexpr PTreeNodeID PTreeNode::none;
+constexpr int PTree::maxSearchers;
+
 PTree::PTree(ExecutionState *initialState)
-    : root(PTreeNodePtr(new PTreeNode(nullptr, initialState))) {
-  initialState->ptreeNode = root.getPointer();
+    : root(allocate(PTreeNode::none, initialState)) {}
+
+PTreeNodeID PTree::allocate(PTreeNodeID parent, ExecutionState *state) {
+  PTreeNodeID id;
+  if (freeNodes.empty()) {
+    if (nodes.size() >= PTreeNode::none)
+      klee_error("PTree cannot hold more than %u nodes", PTreeNode::none);
+    id = nodes.size();
+    nodes.emplace_back();
+  } else {
+    id = freeNodes.back();
+    freeNodes.pop_back();
+    nodes[id] = PTreeNode();
+  }
+  nodes[id].parent = parent;
+  nodes[id].state = state;
+  state->ptreeNode = id;
+  return id;
 }
 
-void PTree::attach(PTreeNode *node, ExecutionState *leftState, ExecutionState *rightState) {
-  assert(node && !node->left.getPointer() && !node->right.getPointer());
+void PTree::attach(PTreeNodeID node, ExecutionState *leftState,
+                   ExecutionState *rightState) {
+  assert(node != PTreeNode::none && nodes[node].left == PTreeNode::none &&
+         nodes[node].right == PTreeNode::none);
   assert(node == rightState->ptreeNode &&
          "Attach assumes the right state is the current state");
-  node->state = nullptr;
-  node->left = PTreeNodePtr(new PTreeNode(node, leftState));
+  // Allocate first: references into the pool do not survive its growth.
+  PTreeNodeID left = allocate(node, leftState);
+  PTreeNodeID right = allocate(node, rightState);
+  PTreeNode &n = nodes[node];
+  n.state = nullptr;
+  n.left = left;
+  n.right = right;
   // The current node inherits the tag
-  uint8_t currentNodeTag = root.getInt();
-  if (node->parent)
-    currentNodeTag = node->parent->left.getPointer() == node
-                         ? node->parent->left.getInt()
-                         : node->parent->right.getInt();
-  node->right = PTreeNodePtr(new PTreeNode(node, rightState), currentNodeTag);
+  nodes[right].tags = n.tags;
+  nodes[left].pathHash = getChildPathHash(n.pathHash, 0);
+  nodes[right].pathHash = getChildPathHash(n.pathHash, 1);
 }
 
-void PTree::remove(PTreeNode *n) {
-  assert(!n->left.getPointer() && !n->right.getPointer());
+void PTree::remove(PTreeNodeID id) {
+  assert(nodes[id].left == PTreeNode::none &&
+         nodes[id].right == PTreeNode::none);
   do {
-    PTreeNode *p = n->parent;
-    if (p) {
-      if (n == p->left.getPointer()) {
-        p->left = PTreeNodePtr(nullptr);
+    PTreeNodeID p = nodes[id].parent;
+    if (p != PTreeNode::none) {
+      if (id == nodes[p].left) {
+        nodes[p].left = PTreeNode::none;
       } else {
-        assert(n == p->right.getPointer());
-        p->right = PTreeNodePtr(nullptr);
+        assert(id == nodes[p].right);
+        nodes[p].right = PTreeNode::none;
       }
+    } else {
+      root = PTreeNode::none;
     }
-    delete n;
-    n = p;
-  } while (n && !n->left.getPointer() && !n->right.getPointer());
+    freeNodes.push_back(id);
+    id = p;
+  } while (id != PTreeNode::none && nodes[id].left == PTreeNode::none &&
+           nodes[id].right == PTreeNode::none);
 
-  if (n && CompressProcessTree) {
+  if (id != PTreeNode::none && CompressProcessTree) {
     // We're now at a node that has exactly one child; we've just deleted the
     // other one. Eliminate the node and connect its child to the parent
     // directly (if it's not the root).
-    PTreeNodePtr child = n->left.getPointer() ? n->left : n->right;
-    PTreeNode *parent = n->parent;
+    PTreeNode &n = nodes[id];
+    PTreeNodeID child = n.left != PTreeNode::none ? n.left : n.right;
+    PTreeNodeID parent = n.parent;
 
-    child.getPointer()->parent = parent;
-    if (!parent) {
+    nodes[child].parent = parent;
+    if (parent == PTreeNode::none) {
       // We're at the root.
       root = child;
     } else {
-      if (n == parent->left.getPointer()) {
-        parent->left = child;
+      if (id == nodes[parent].left) {
+        nodes[parent].left = child;
       } else {
-        assert(n == parent->right.getPointer());
-        parent->right = child;
+        assert(id == nodes[parent].right);
+        nodes[parent].right = child;
       }
     }
 
-    delete n;
+    freeNodes.push_back(id);
   }
+
+  // Once most of the pool is unused, move the live nodes together again
+  // rather than keeping the memory of long dead subtrees around.
+  if (freeNodes.size() >= 4096 && freeNodes.size() > nodes.size() / 2)
+    compact();
 }
 
+void PTree::compact() {
+  std::vector<PTreeNode> live;
+  live.reserve(nodes.size() - freeNodes.size());
+
+  // Number the nodes in depth-first order, so that a walk from the root
+  // mostly moves forward through memory.
+  if (root != PTreeNode::none) {
+    struct Entry {
+      PTreeNodeID oldID;
+      PTreeNodeID parent; // new ID
+      bool isLeft;
+    };
+    std::vector<Entry> stack;
+    stack.push_back({root, PTreeNode::none, false});
+    while (!stack.empty()) {
+      Entry e = stack.back();
+      stack.pop_back();
+
+      PTreeNodeID id = live.size();
+      live.push_back(nodes[e.oldID]);
+      PTreeNode &n = live.back();
+      n.parent = e.parent;
+      if (e.parent != PTreeNode::none)
+        (e.isLeft ? live[e.parent].left : live[e.parent].right) = id;
+      if (n.state)
+        n.state->ptreeNode = id;
+      if (n.right != PTreeNode::none)
+        stack.push_back({n.right, id, false});
+      if (n.left != PTreeNode::none)
+        stack.push_back({n.left, id, true});
+    }
+    root = 0;
+  }
+
+  nodes.swap(live);
+  freeNodes.clear();
+  freeNodes.shrink_to_fit();
+}
 void PTree::dump(llvm::raw_ostream &os) {
   ExprPPrinter *pp = ExprPPrinter::create(os);
   pp->setNewline("\\l");
@@ -101,34 +180,35 @@ void PTree::dump(llvm::raw_ostream &os) {
   os << "\tcenter = \"true\";\n";
   os << "\tnode [style=\"filled\",width=.1,height=.1,fontname=\"Terminus\"]\n";
   os << "\tedge [arrowsize=.3]\n";
-  std::vector<const PTreeNode*> stack;
-  stack.push_back(root.getPointer());
+  auto printTags = [&](std::uint32_t tags) {
+    os << "0b";
+    for (int i = std::max(registeredIds, 1) - 1; i >= 0; --i)
+      os << ((tags >> i) & 1);
+  };
+  std::vector<PTreeNodeID> stack;
+  if (root != PTreeNode::none)
+    stack.push_back(root);
   while (!stack.empty()) {
-    const PTreeNode *n = stack.back();
+    PTreeNodeID id = stack.back();
+    const PTreeNode &n = nodes[id];
     stack.pop_back();
-    os << "\tn" << n << " [shape=diamond";
-    if (n->state)
+    os << "\tn" << id << " [shape=diamond";
+    if (n.state)
       os << ",fillcolor=green";
     os << "];\n";
-    if (n->left.getPointer()) {
-      os << "\tn" << n << " -> n" << n->left.getPointer();
-      os << " [label=0b"
-         << std::bitset<PtrBitCount>(n->left.getInt()).to_string() << "];\n";
-      stack.push_back(n->left.getPointer());
+    if (n.left != PTreeNode::none) {
+      os << "\tn" << id << " -> n" << n.left << " [label=";
+      printTags(nodes[n.left].tags);
+      os << "];\n";
+      stack.push_back(n.left);
     }
-    if (n->right.getPointer()) {
-      os << "\tn" << n << " -> n" << n->right.getPointer();
-      os << " [label=0b"
-         << std::bitset<PtrBitCount>(n->right.getInt()).to_string() << "];\n";
-      stack.push_back(n->right.getPointer());
+    if (n.right != PTreeNode::none) {
+      os << "\tn" << id << " -> n" << n.right << " [label=";
+      printTags(nodes[n.right].tags);
+      os << "];\n";
+      stack.push_back(n.right);
     }
   }
   os << "}\n";
   delete pp;
 }
-
-PTreeNode::PTreeNode(PTreeNode *parent, ExecutionState *state) : parent{parent}, state{state} {
-  state->ptreeNode = this;
-  left = PTreeNodePtr(nullptr);
-  right = PTreeNodePtr(nullptr);
-}
@@ -12,52 +12,73 @@
 
 #include "klee/Expr/Expr.h"
 #include "klee/Support/ErrorHandling.h"
-#include "llvm/ADT/PointerIntPair.h"
+
+#include <cstdint>
+#include <vector>
 
 namespace klee {
   class ExecutionState;
-  class PTreeNode;
-  /* PTreeNodePtr is used by the Random Path Searcher object to efficiently
-  record which PTreeNode belongs to it. PTree is a global structure that
-  captures all  states, whereas a Random Path Searcher might only care about
-  a subset. The integer part of PTreeNodePtr is a bitmask (a "tag") of which
-  Random Path Searchers PTreeNode belongs to. */
-  constexpr int PtrBitCount = 3;
-  using PTreeNodePtr = llvm::PointerIntPair<PTreeNode *, PtrBitCount, uint8_t>;
+
+  /// Nodes are referred to by their index in the PTree, which is stable
+  /// until the tree is compacted (see PTree::remove).
+  using PTreeNodeID = std::uint32_t;
 
   class PTreeNode {
   public:
-    PTreeNode *parent = nullptr;
+    static constexpr PTreeNodeID none = ~PTreeNodeID(0);
 
-    PTreeNodePtr left; 
-    PTreeNodePtr right;
+    PTreeNodeID parent = none;
+    PTreeNodeID left = none;
+    PTreeNodeID right = none;
+    /* The set of RandomPathSearchers this node belongs to, one bit per
+    searcher. A Random Path Searcher only walks down into nodes tagged with
+    its bit, as it might only care about a subset of all states. */
+    std::uint32_t tags = 0;
     ExecutionState *state = nullptr;
-
-    PTreeNode(const PTreeNode&) = delete;
-    PTreeNode(PTreeNode *parent, ExecutionState *state);
-    ~PTreeNode() = default;
+    /// Identifies the path from the root to this node by the branch
+    /// decisions taken along it, independently of the process or run.
+    std::uint64_t pathHash = 0;
   };
 
+  /// The process tree. Nodes are kept in a single pool and refer to each
+  /// other by 32-bit index, which keeps them small and close together.
   class PTree {
+    std::vector<PTreeNode> nodes;
+    /// Unused slots of \ref nodes.
+    std::vector<PTreeNodeID> freeNodes;
+
     // Number of registered ID
     int registeredIds = 0;
 
+    PTreeNodeID allocate(PTreeNodeID parent, ExecutionState *state);
+    void compact();
+
   public:
-    PTreeNodePtr root;
+    /// The maximal number of RandomPathSearchers sharing one tree.
+    static constexpr int maxSearchers = 32;
+
+    PTreeNodeID root;
     explicit PTree(ExecutionState *initialState);
     ~PTree() = default;
 
-    void attach(PTreeNode *node, ExecutionState *leftState,
+    PTreeNode &getNode(PTreeNodeID id) { return nodes[id]; }
+    const PTreeNode &getNode(PTreeNodeID id) const { return nodes[id]; }
+
+    void attach(PTreeNodeID node, ExecutionState *leftState,
                 ExecutionState *rightState);
-    void remove(PTreeNode *node);
+    /// Remove a leaf and all ancestors left without children. May renumber
+    /// the remaining nodes, updating the states referring to them.
+    void remove(PTreeNodeID node);
     void dump(llvm::raw_ostream &os);
-    std::uint8_t getNextId() {
-      std::uint8_t id = 1 << registeredIds++;
-      if (registeredIds > PtrBitCount) {
+    /// The path hash of the \p side-th child of a node with path hash \p
+    /// parent.
+    static std::uint64_t getChildPathHash(std::uint64_t parent, unsigned side);
+    std::uint32_t getNextId() {
+      if (registeredIds >= maxSearchers) {
         klee_error("PTree cannot support more than %d RandomPathSearchers",
-                   PtrBitCount);
+                   maxSearchers);
       }
-      return id;
+      return std::uint32_t(1) << registeredIds++;
     }
   };
 }
@@ -0,0 +1,144 @@
+//===-- Profiler.cpp ------------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Profiler.h"
+
+#include "klee/Module/KModule.h"
+#include "klee/Support/ErrorHandling.h"
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <signal.h>
+#include <sys/time.h>
+
+using namespace klee;
+using namespace klee::profiler;
+
+Sample profiler::current = {nullptr, 0, Phase::Interpreter, nullptr};
+
+namespace {
+/// Number of times one particular Sample was seen.
+struct Entry {
+  const KFunction *function;
+  const llvm::Function *callee;
+  unsigned opcode;
+  Phase phase;
+  std::uint64_t count; // 0 for unused entries
+};
+
+// The signal handler cannot allocate, so samples are counted in a fixed
+// open addressing hash table.
+const unsigned tableSize = 1 << 14;
+Entry table[tableSize];
+std::uint64_t droppedSamples = 0;
+
+bool running = false;
+struct sigaction previousAction;
+
+const char *phaseNames[] = {"interpreter",      "solver",
+                            "resolve",          "fork",
+                            "special-function", "external-call"};
+static_assert(sizeof(phaseNames) / sizeof(phaseNames[0]) ==
+                  static_cast<unsigned>(Phase::NumPhases),
+              "every phase needs a name");
+
+void takeSample(int) {
+  const KFunction *function = current.function;
+  const llvm::Function *callee = current.callee;
+  unsigned opcode = current.opcode;
+  Phase phase = current.phase;
+
+  std::uintptr_t hash = reinterpret_cast<std::uintptr_t>(function) >> 4;
+  hash = hash * 31 + (reinterpret_cast<std::uintptr_t>(callee) >> 4);
+  hash = hash * 31 + opcode;
+  hash = hash * 31 + static_cast<unsigned>(phase);
+
+  for (unsigned probe = 0; probe < tableSize; ++probe) {
+    Entry &e = table[(hash + probe) & (tableSize - 1)];
+    if (!e.count) {
+      e.function = function;
+      e.callee = callee;
+      e.opcode = opcode;
+      e.phase = phase;
+      e.count = 1;
+      return;
+    }
+    if (e.function == function && e.callee == callee && e.opcode == opcode &&
+        e.phase == phase) {
+      ++e.count;
+      return;
+    }
+  }
+  ++droppedSamples;
+}
+} // namespace
+
+void profiler::start(unsigned frequency) {
+  if (running || !frequency)
+    return;
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = takeSample;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  if (sigaction(SIGPROF, &action, &previousAction)) {
+    klee_warning("Unable to install profiling signal handler: %s",
+                 strerror(errno));
+    return;
+  }
+
+  struct itimerval timer;
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = frequency >= 1000000 ? 1 : 1000000 / frequency;
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF, &timer, nullptr)) {
+    klee_warning("Unable to start profiling timer: %s", strerror(errno));
+    sigaction(SIGPROF, &previousAction, nullptr);
+    return;
+  }
+  running = true;
+}
+
+void profiler::stop() {
+  if (!running)
+    return;
+
+  struct itimerval timer;
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, nullptr);
+  sigaction(SIGPROF, &previousAction, nullptr);
+  running = false;
+}
+
+void profiler::writeFoldedStacks(llvm::raw_ostream &os) {
+  for (const Entry &e : table) {
+    if (!e.count)
+      continue;
+
+    if (e.function)
+      os << e.function->function->getName();
+    else
+      os << "[unknown]";
+    os << ';'
+       << (e.opcode ? llvm::Instruction::getOpcodeName(e.opcode) : "[none]")
+       << ';' << phaseNames[static_cast<unsigned>(e.phase)];
+    if (e.callee)
+      os << ';' << e.callee->getName();
+    os << ' ' << e.count << '\n';
+  }
+
+  if (droppedSamples)
+    os << "[dropped] " << droppedSamples << '\n';
+}
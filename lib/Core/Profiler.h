@@ -0,0 +1,82 @@
+//===-- Profiler.h ----------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_PROFILER_H
+#define KLEE_PROFILER_H
+
+namespace llvm {
+  class Function;
+  class raw_ostream;
+}
+
+namespace klee {
+  struct KFunction;
+
+/// A sampling profiler for the interpreter. The interpreter only publishes
+/// what it is currently doing; a CPU time signal handler periodically
+/// counts that, so the cost does not depend on how often the published
+/// values change.
+namespace profiler {
+
+  enum class Phase : unsigned {
+    Interpreter,
+    Solver,
+    Resolve,
+    Fork,
+    SpecialFunction,
+    ExternalCall,
+    NumPhases
+  };
+
+  /// What the interpreter is doing right now.
+  struct Sample {
+    const KFunction *volatile function;
+    volatile unsigned opcode;
+    volatile Phase phase;
+    /// The special or external function being called, if any.
+    const llvm::Function *volatile callee;
+  };
+
+  extern Sample current;
+
+  /// Called for every instruction the interpreter executes.
+  inline void setInstruction(const KFunction *kf, unsigned opcode) {
+    current.function = kf;
+    current.opcode = opcode;
+  }
+
+  /// Attributes samples taken during its lifetime to \p phase.
+  class PhaseScope {
+    Phase previousPhase;
+    const llvm::Function *previousCallee;
+
+  public:
+    explicit PhaseScope(Phase phase, const llvm::Function *callee = nullptr)
+        : previousPhase(current.phase), previousCallee(current.callee) {
+      current.phase = phase;
+      current.callee = callee;
+    }
+    ~PhaseScope() {
+      current.phase = previousPhase;
+      current.callee = previousCallee;
+    }
+  };
+
+  /// Start taking \p frequency samples per second of CPU time.
+  void start(unsigned frequency);
+  void stop();
+
+  /// Write the samples taken so far in the folded stacks format used by
+  /// flame graph tools: one "function;opcode;phase[;callee] count" line per
+  /// distinct sample.
+  void writeFoldedStacks(llvm::raw_ostream &os);
+}
+}
+
+#endif /* KLEE_PROFILER_H */
@@ -32,6 +32,7 @@
 
 #include <cassert>
 #include <cmath>
+#include <limits>
 
 using namespace klee;
 using namespace llvm;
@@ -164,7 +165,7 @@ bool TargetedSearcher::distanceInCallGraph(KFunction *kf, KBlock *kb, unsigned i
 
   for (auto &kCallBlock : kf->kCallBlocks) {
     if (dist.find(kCallBlock) != dist.end()) {
-      KFunction *calledKFunction = kf->parent->functionMap[kCallBlock->calledFunction];
+      KFunction *calledKFunction = kf->parent->getKFunction(kCallBlock->calledFunction);
       if (distanceToTargetFunction.find(calledKFunction) != distanceToTargetFunction.end() &&
           distance > distanceToTargetFunction[calledKFunction] + 1) {
         distance = distanceToTargetFunction[calledKFunction] + 1;
@@ -199,7 +200,7 @@ TargetedSearcher::WeightResult TargetedSearcher::tryGetPreTargetWeight(Execution
   KFunction *currentKF = es->stack.back().kf;
   std::vector<KBlock*> localTargets;
   for (auto &kCallBlock : currentKF->kCallBlocks) {
-    KFunction *calledKFunction = currentKF->parent->functionMap[kCallBlock->calledFunction];
+    KFunction *calledKFunction = currentKF->parent->getKFunction(kCallBlock->calledFunction);
     if (distanceToTargetFunction.count(calledKFunction) > 0) {
       localTargets.push_back(kCallBlock);
     }
@@ -409,10 +410,31 @@ WeightedRandomSearcher::WeightedRandomSearcher(WeightType type, RNG &rng)
   }
 }
 
+WeightedRandomSearcher::~WeightedRandomSearcher() = default;
+
 ExecutionState &WeightedRandomSearcher::selectState() {
+  refreshWeights();
   return *states->choose(theRNG.getDoubleL());
 }
 
+void WeightedRandomSearcher::refreshWeights() {
+  if (type == MinDistToUncovered || type == CoveringNew) {
+    // New distances change the weight of every state, which is cheaper to
+    // recompute in one pass than one state at a time.
+    std::uint64_t epoch = getMinDistToUncoveredEpoch();
+    if (epoch != weightEpoch) {
+      weightEpoch = epoch;
+      states->updateAll([this](ExecutionState *es) { return getWeight(es); });
+      staleStates.clear();
+      return;
+    }
+  }
+
+  for (const auto state : staleStates)
+    states->update(state, getWeight(state));
+  staleStates.clear();
+}
+
 double WeightedRandomSearcher::getWeight(ExecutionState *es) {
   switch(type) {
     default:
@@ -461,15 +483,17 @@ void WeightedRandomSearcher::update(ExecutionState *current,
   // update current
   if (current && updateWeights &&
       std::find(removedStates.begin(), removedStates.end(), current) == removedStates.end())
-    states->update(current, getWeight(current));
+    staleStates.insert(current);
 
   // insert states
   for (const auto state : addedStates)
     states->insert(state, getWeight(state));
 
   // remove states
-  for (const auto state : removedStates)
+  for (const auto state : removedStates) {
+    staleStates.erase(state);
     states->remove(state);
+  }
 }
 
 bool WeightedRandomSearcher::empty() {
@@ -493,10 +517,6 @@ void WeightedRandomSearcher::printName(llvm::raw_ostream &os) {
 
 ///
 
-// Check if n is a valid pointer and a node belonging to us
-#define IS_OUR_NODE_VALID(n)                                                   \
-  (((n).getPointer() != nullptr) && (((n).getInt() & idBitMask) != 0))
-
 RandomPathSearcher::RandomPathSearcher(PTree &processTree, RNG &rng)
   : processTree{processTree},
     theRNG{rng},
@@ -504,24 +524,22 @@ RandomPathSearcher::RandomPathSearcher(PTree &processTree, RNG &rng)
 
 ExecutionState &RandomPathSearcher::selectState() {
   unsigned flips=0, bits=0;
-  assert(processTree.root.getInt() & idBitMask && "Root should belong to the searcher");
-  PTreeNode *n = processTree.root.getPointer();
+  assert(isOurs(processTree.root) && "Root should belong to the searcher");
+  const PTreeNode *n = &processTree.getNode(processTree.root);
   while (!n->state) {
-    if (!IS_OUR_NODE_VALID(n->left)) {
-      assert(IS_OUR_NODE_VALID(n->right) && "Both left and right nodes invalid");
-      assert(n != n->right.getPointer());
-      n = n->right.getPointer();
-    } else if (!IS_OUR_NODE_VALID(n->right)) {
-      assert(IS_OUR_NODE_VALID(n->left) && "Both right and left nodes invalid");
-      assert(n != n->left.getPointer());
-      n = n->left.getPointer();
+    if (!isOurs(n->left)) {
+      assert(isOurs(n->right) && "Both left and right nodes invalid");
+      n = &processTree.getNode(n->right);
+    } else if (!isOurs(n->right)) {
+      assert(isOurs(n->left) && "Both right and left nodes invalid");
+      n = &processTree.getNode(n->left);
     } else {
       if (bits==0) {
         flips = theRNG.getInt32();
         bits = 32;
       }
       --bits;
-      n = ((flips & (1U << bits)) ? n->left : n->right).getPointer();
+      n = &processTree.getNode((flips & (1U << bits)) ? n->left : n->right);
     }
   }
 
@@ -533,46 +551,30 @@ void RandomPathSearcher::update(ExecutionState *current,
                                 const std::vector<ExecutionState *> &removedStates) {
   // insert states
   for (auto &es : addedStates) {
-    PTreeNode *pnode = es->ptreeNode, *parent = pnode->parent;
-    PTreeNodePtr *childPtr;
-
-    childPtr = parent ? ((parent->left.getPointer() == pnode) ? &parent->left
-                                                              : &parent->right)
-                      : &processTree.root;
-    while (pnode && !IS_OUR_NODE_VALID(*childPtr)) {
-      childPtr->setInt(childPtr->getInt() | idBitMask);
-      pnode = parent;
-      if (pnode)
-        parent = pnode->parent;
-
-      childPtr = parent
-                     ? ((parent->left.getPointer() == pnode) ? &parent->left
-                                                             : &parent->right)
-                     : &processTree.root;
+    PTreeNodeID id = es->ptreeNode;
+    while (id != PTreeNode::none && !isOurs(id)) {
+      PTreeNode &n = processTree.getNode(id);
+      n.tags |= idBitMask;
+      id = n.parent;
     }
   }
 
   // remove states
   for (auto &es : removedStates) {
-    PTreeNode *pnode = es->ptreeNode, *parent = pnode->parent;
-
-    while (pnode && !IS_OUR_NODE_VALID(pnode->left) &&
-           !IS_OUR_NODE_VALID(pnode->right)) {
-      auto childPtr =
-          parent ? ((parent->left.getPointer() == pnode) ? &parent->left
-                                                         : &parent->right)
-                 : &processTree.root;
-      assert(IS_OUR_NODE_VALID(*childPtr) && "Removing pTree child not ours");
-      childPtr->setInt(childPtr->getInt() & ~idBitMask);
-      pnode = parent;
-      if (pnode)
-        parent = pnode->parent;
+    PTreeNodeID id = es->ptreeNode;
+    while (id != PTreeNode::none) {
+      PTreeNode &n = processTree.getNode(id);
+      if (isOurs(n.left) || isOurs(n.right))
+        break;
+      assert((n.tags & idBitMask) && "Removing pTree child not ours");
+      n.tags &= ~idBitMask;
+      id = n.parent;
     }
   }
 }
 
 bool RandomPathSearcher::empty() {
-  return !IS_OUR_NODE_VALID(processTree.root);
+  return !isOurs(processTree.root);
 }
 
 void RandomPathSearcher::printName(llvm::raw_ostream &os) {
@@ -759,6 +761,91 @@ void IterativeDeepeningTimeSearcher::printName(llvm::raw_ostream &os) {
 }
 
 
+///
+
+ZESTISearcher::ZESTISearcher(const std::set<std::uint32_t> &sensitiveDepths,
+                             std::uint32_t bound)
+    : sensitiveDepths(sensitiveDepths), bound(std::max(1U, bound)) {}
+
+std::uint32_t ZESTISearcher::getDistance(std::uint32_t depth) const {
+  auto it = sensitiveDepths.lower_bound(depth);
+  if (it == sensitiveDepths.end())
+    return std::numeric_limits<std::uint32_t>::max();
+  return *it - depth;
+}
+
+void ZESTISearcher::schedule(ExecutionState *es) {
+  const Divergence &divergence = divergences[es];
+  if (es->depth - divergence.depth > bound) {
+    pausedStates.insert(es);
+    return;
+  }
+  queue.emplace(divergence.distance, es->depth, es->getID(), es);
+  queuedDepths[es] = es->depth;
+}
+
+void ZESTISearcher::unschedule(ExecutionState *es) {
+  auto it = queuedDepths.find(es);
+  if (it == queuedDepths.end()) {
+    pausedStates.erase(es);
+    return;
+  }
+  queue.erase(
+      Key(divergences[es].distance, it->second, es->getID(), es));
+  queuedDepths.erase(it);
+}
+
+ExecutionState &ZESTISearcher::selectState() {
+  while (queue.empty()) {
+    assert(!pausedStates.empty() && "no state to select");
+    bound *= 2;
+    klee_message("ZESTI: increased depth bound to %u", bound);
+    std::vector<ExecutionState *> paused(pausedStates.begin(),
+                                         pausedStates.end());
+    pausedStates.clear();
+    for (ExecutionState *es : paused)
+      schedule(es);
+  }
+  return *std::get<3>(*queue.begin());
+}
+
+void ZESTISearcher::update(
+    ExecutionState *current, const std::vector<ExecutionState *> &addedStates,
+    const std::vector<ExecutionState *> &removedStates) {
+  auto it = current ? divergences.find(current) : divergences.end();
+  const bool isKnown = it != divergences.end();
+  const Divergence parent = isKnown ? it->second : Divergence();
+  for (ExecutionState *es : addedStates) {
+    // States forked after seeding belong to the divergence point of their
+    // parent; all others are divergence points themselves.
+    if (isKnown)
+      divergences[es] = parent;
+    else
+      divergences[es] = {es->depth, getDistance(es->depth)};
+    schedule(es);
+  }
+
+  if (isKnown &&
+      std::find(removedStates.begin(), removedStates.end(), current) ==
+          removedStates.end()) {
+    unschedule(current);
+    schedule(current);
+  }
+
+  for (ExecutionState *es : removedStates) {
+    unschedule(es);
+    divergences.erase(es);
+  }
+}
+
+bool ZESTISearcher::empty() { return queue.empty() && pausedStates.empty(); }
+
+void ZESTISearcher::printName(llvm::raw_ostream &os) {
+  os << "ZESTISearcher (" << sensitiveDepths.size()
+     << " sensitive depths)\n";
+}
+
+
 ///
 
 InterleavedSearcher::InterleavedSearcher(const std::vector<Searcher*> &_searchers) {
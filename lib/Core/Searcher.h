@@ -21,6 +21,9 @@
 #include <map>
 #include <queue>
 #include <set>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace llvm {
@@ -191,14 +194,21 @@ namespace klee {
     RNG &theRNG;
     WeightType type;
     bool updateWeights;
+
+    /// States that have executed since their weight was computed. Their
+    /// weights are only recomputed once a state is to be selected.
+    std::unordered_set<ExecutionState *> staleStates;
+    /// The getMinDistToUncoveredEpoch() all weights were last computed in.
+    std::uint64_t weightEpoch = 0;
     
     double getWeight(ExecutionState*);
+    void refreshWeights();
 
   public:
     /// \param type The WeightType that determines the underlying heuristic.
     /// \param RNG A random number generator.
     WeightedRandomSearcher(WeightType type, RNG &rng);
-    ~WeightedRandomSearcher() override = default;
+    ~WeightedRandomSearcher() override;
 
     ExecutionState &selectState() override;
     void update(ExecutionState *current,
@@ -214,13 +224,8 @@ namespace klee {
   ///
   /// To support this, RandomPathSearcher has a subgraph view of PTree, in that it
   /// only walks the PTreeNodes that it "owns". Ownership is stored in the
-  /// getInt method of the PTreeNodePtr class (which hides it in the pointer itself).
-  ///
-  /// The current implementation of PTreeNodePtr supports only 3 instances of the
-  /// RandomPathSearcher. This is because the current PTreeNodePtr implementation
-  /// conforms to C++ and only steals the last 3 alignment bits. This restriction
-  /// could be relaxed slightly by an architecture-specific implementation of
-  /// PTreeNodePtr that also steals the top bits of the pointer.
+  /// tags of each PTreeNode, one bit per searcher, which limits the number of
+  /// RandomPathSearchers sharing a PTree to PTree::maxSearchers.
   ///
   /// The ownership bits are maintained in the update method.
   class RandomPathSearcher final : public Searcher {
@@ -228,7 +233,13 @@ namespace klee {
     RNG &theRNG;
 
     // Unique bitmask of this searcher
-    const uint8_t idBitMask;
+    const std::uint32_t idBitMask;
+
+    // Check if id is a valid node belonging to us
+    bool isOurs(PTreeNodeID id) const {
+      return id != PTreeNode::none &&
+             (processTree.getNode(id).tags & idBitMask) != 0;
+    }
 
   public:
     /// \param processTree The process tree.
@@ -341,6 +352,52 @@ namespace klee {
     void printName(llvm::raw_ostream &os) override;
   };
 
+  /// ZESTISearcher explores the states that diverged from the paths of the
+  /// seeds (see ICSE'12 paper "make test-zesti"). While seeding, the depths at
+  /// which seeded states executed sensitive instructions are recorded. The
+  /// states left afterwards are divergence points; they are explored in order
+  /// of their distance to the next sensitive instruction on the seed path,
+  /// then in order of depth. The states of a divergence point may branch at
+  /// most `bound` times before they are paused; the bound is doubled
+  /// whenever only paused states remain.
+  class ZESTISearcher final : public Searcher {
+    struct Divergence {
+      std::uint32_t depth;
+      std::uint32_t distance;
+    };
+    typedef std::tuple<std::uint32_t, std::uint32_t, std::uint32_t,
+                       ExecutionState *>
+        Key;
+
+    const std::set<std::uint32_t> sensitiveDepths;
+    std::uint32_t bound;
+
+    std::unordered_map<ExecutionState *, Divergence> divergences;
+    /// The depth each queued state was queued with.
+    std::unordered_map<ExecutionState *, std::uint32_t> queuedDepths;
+    std::set<Key> queue;
+    std::set<ExecutionState *, ExecutionStateIDCompare> pausedStates;
+
+    std::uint32_t getDistance(std::uint32_t depth) const;
+    void schedule(ExecutionState *es);
+    void unschedule(ExecutionState *es);
+
+  public:
+    /// \param sensitiveDepths The depths of sensitive instructions on the
+    /// paths of the seeds.
+    /// \param bound The initial number of branches per divergence point.
+    ZESTISearcher(const std::set<std::uint32_t> &sensitiveDepths,
+                  std::uint32_t bound);
+    ~ZESTISearcher() override = default;
+
+    ExecutionState &selectState() override;
+    void update(ExecutionState *current,
+                const std::vector<ExecutionState *> &addedStates,
+                const std::vector<ExecutionState *> &removedStates) override;
+    bool empty() override;
+    void printName(llvm::raw_ostream &os) override;
+  };
+
   /// InterleavedSearcher selects states from a set of searchers in round-robin
   /// manner. It is used for KLEE's default strategy where it switches between
   /// RandomPathSearcher and WeightedRandomSearcher with CoveringNew metric.
@@ -14,6 +14,7 @@
 #include "Memory.h"
 #include "MemoryManager.h"
 #include "MergeHandler.h"
+#include "Profiler.h"
 #include "Searcher.h"
 #include "StatsTracker.h"
 #include "TimingSolver.h"
@@ -282,29 +283,27 @@ void SpecialFunctionHandler::bind() {
     Function *f = executor.kmodule->module->getFunction(hi.name);
     
     if (f && (!hi.doNotOverride || f->isDeclaration()))
-      handlers[f] = std::make_pair(hi.handler, hi.hasReturnValue);
+      handlers[f] = i;
   }
 }
 
 
-bool SpecialFunctionHandler::handle(ExecutionState &state, 
-                                    Function *f,
-                                    KInstruction *target,
-                                    std::vector< ref<Expr> > &arguments) {
-  handlers_ty::iterator it = handlers.find(f);
-  if (it != handlers.end()) {    
-    Handler h = it->second.first;
-    bool hasReturnValue = it->second.second;
-     // FIXME: Check this... add test?
-    if (!hasReturnValue && !target->inst->use_empty()) {
-      executor.terminateStateOnExecError(state, 
-                                         "expected return value from void special function");
-    } else {
-      (this->*h)(state, target, arguments);
-    }
-    return true;
+int SpecialFunctionHandler::getHandlerID(const Function *f) const {
+  handlers_ty::const_iterator it = handlers.find(f);
+  return it == handlers.end() ? -1 : static_cast<int>(it->second);
+}
+
+void SpecialFunctionHandler::callHandler(unsigned id, ExecutionState &state,
+                                         Function *f, KInstruction *target,
+                                         std::vector<ref<Expr>> &arguments) {
+  profiler::PhaseScope phase(profiler::Phase::SpecialFunction, f);
+  const HandlerInfo &hi = handlerInfo[id];
+   // FIXME: Check this... add test?
+  if (!hi.hasReturnValue && !target->inst->use_empty()) {
+    executor.terminateStateOnExecError(state, 
+                                       "expected return value from void special function");
   } else {
-    return false;
+    (this->*hi.handler)(state, target, arguments);
   }
 }
 
@@ -11,9 +11,9 @@
 #define KLEE_SPECIALFUNCTIONHANDLER_H
 
 #include <iterator>
-#include <map>
-#include <vector>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace llvm {
   class Function;
@@ -32,8 +32,8 @@ namespace klee {
                                                     KInstruction *target, 
                                                     std::vector<ref<Expr> > 
                                                       &arguments);
-    typedef std::map<const llvm::Function*, 
-                     std::pair<Handler,bool> > handlers_ty;
+    /// The index of the handler info of each bound function.
+    typedef std::unordered_map<const llvm::Function *, unsigned> handlers_ty;
 
     handlers_ty handlers;
     class Executor &executor;
@@ -86,10 +86,15 @@ namespace klee {
     /// prepared for execution.
     void bind();
 
-    bool handle(ExecutionState &state, 
-                llvm::Function *f,
-                KInstruction *target,
-                std::vector< ref<Expr> > &arguments);
+    /// \return The index of the handler bound to \p f, or -1 if there is
+    /// none.
+    int getHandlerID(const llvm::Function *f) const;
+
+    /// Call the handler with index \p id, as returned by getHandlerID for
+    /// \p f.
+    void callHandler(unsigned id, ExecutionState &state, llvm::Function *f,
+                     KInstruction *target,
+                     std::vector<ref<Expr>> &arguments);
 
     /* Convenience routines */
 
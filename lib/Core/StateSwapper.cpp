@@ -0,0 +1,140 @@
+//===-- StateSwapper.cpp --------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "StateSwapper.h"
+
+#include "ExecutionState.h"
+#include "Memory.h"
+
+#include "klee/Support/ErrorHandling.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+// A swap file holds the magic, the number of objects and then the size and
+// concrete contents of each object, in the order of SwappedState::objects.
+const char swapMagic[8] = {'K', 'L', 'E', 'E', 'S', 'W', 'A', 'P'};
+} // namespace
+
+StateSwapper::StateSwapper(std::string pathPrefix)
+    : pathPrefix(std::move(pathPrefix)) {}
+
+StateSwapper::~StateSwapper() {
+  for (const auto &entry : swapped)
+    unlink(entry.second.path.c_str());
+}
+
+std::string StateSwapper::getPath(const ExecutionState &state) const {
+  // KLEE may fork, and the children share the output directory.
+  return pathPrefix + std::to_string(state.getID()) + "." +
+         std::to_string(getpid()) + ".swap";
+}
+
+std::uint64_t StateSwapper::swapOut(ExecutionState &state) {
+  assert(!isSwappedOut(state) && "state is already swapped out");
+
+  SwappedState entry;
+  state.addressSpace.getOwnedObjects(entry.objects);
+  entry.objects.erase(std::remove_if(entry.objects.begin(),
+                                     entry.objects.end(),
+                                     [](const ObjectState *os) {
+                                       return os->size == 0;
+                                     }),
+                      entry.objects.end());
+  if (entry.objects.empty())
+    return 0;
+
+  entry.path = getPath(state);
+  std::FILE *f = std::fopen(entry.path.c_str(), "wb");
+  if (!f) {
+    klee_warning_once(0, "Unable to swap out state to %s: %s",
+                      entry.path.c_str(), strerror(errno));
+    return 0;
+  }
+
+  std::uint32_t count = entry.objects.size();
+  bool ok = std::fwrite(swapMagic, sizeof(swapMagic), 1, f) == 1 &&
+            std::fwrite(&count, sizeof(count), 1, f) == 1;
+  for (const ObjectState *os : entry.objects) {
+    ok = ok && std::fwrite(&os->size, sizeof(os->size), 1, f) == 1 &&
+         std::fwrite(os->concreteStore, 1, os->size, f) == os->size;
+  }
+  ok = std::fclose(f) == 0 && ok;
+  if (!ok) {
+    klee_warning_once(0, "Unable to swap out state to %s: %s",
+                      entry.path.c_str(), strerror(errno));
+    unlink(entry.path.c_str());
+    return 0;
+  }
+
+  std::uint64_t bytes = 0;
+  for (ObjectState *os : entry.objects) {
+    delete[] os->concreteStore;
+    os->concreteStore = nullptr;
+    bytes += os->size;
+  }
+  swappedBytes += bytes;
+  swapped.emplace(&state, std::move(entry));
+  return bytes;
+}
+
+void StateSwapper::swapIn(ExecutionState &state) {
+  auto it = swapped.find(&state);
+  assert(it != swapped.end() && "state is not swapped out");
+  const SwappedState &entry = it->second;
+
+  std::FILE *f = std::fopen(entry.path.c_str(), "rb");
+  if (!f)
+    klee_error("Unable to swap in state from %s: %s", entry.path.c_str(),
+               strerror(errno));
+
+  char magic[sizeof(swapMagic)];
+  std::uint32_t count;
+  bool ok = std::fread(magic, sizeof(magic), 1, f) == 1 &&
+            !memcmp(magic, swapMagic, sizeof(magic)) &&
+            std::fread(&count, sizeof(count), 1, f) == 1 &&
+            count == entry.objects.size();
+  for (ObjectState *os : entry.objects) {
+    unsigned size;
+    ok = ok && std::fread(&size, sizeof(size), 1, f) == 1 && size == os->size;
+    if (!ok)
+      break;
+    os->concreteStore = new uint8_t[size];
+    ok = std::fread(os->concreteStore, 1, size, f) == size;
+    swappedBytes -= size;
+  }
+  std::fclose(f);
+  if (!ok)
+    klee_error("Unable to swap in state from %s: corrupt swap file",
+               entry.path.c_str());
+
+  unlink(entry.path.c_str());
+  swapped.erase(it);
+}
+
+void StateSwapper::discard(const ExecutionState &state) {
+  auto it = swapped.find(&state);
+  if (it == swapped.end())
+    return;
+
+  // The objects are only referenced by this state and are about to be
+  // freed with it, they are left without contents.
+  for (const ObjectState *os : it->second.objects)
+    swappedBytes -= os->size;
+  unlink(it->second.path.c_str());
+  swapped.erase(it);
+}
@@ -0,0 +1,68 @@
+//===-- StateSwapper.h ------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_STATESWAPPER_H
+#define KLEE_STATESWAPPER_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace klee {
+  class ExecutionState;
+  class ObjectState;
+
+  /// Moves the memory contents of execution states that are not being
+  /// executed to disk, so that they do not have to be terminated when KLEE
+  /// runs out of memory.
+  ///
+  /// Only the object states a state owns exclusively are swapped out: all
+  /// others, like the expressions making up its constraints and stack, are
+  /// shared with other states and would not be freed. Everything but the
+  /// concrete contents of those objects stays resident, so a swapped out
+  /// state can still be scheduled, paused or terminated, but has to be
+  /// swapped in before it is executed or its memory is read.
+  class StateSwapper {
+    struct SwappedState {
+      std::string path;
+      std::vector<ObjectState *> objects;
+    };
+
+    /// Swap files are named <prefix><state id>.<pid>.swap.
+    std::string pathPrefix;
+    std::unordered_map<const ExecutionState *, SwappedState> swapped;
+    std::uint64_t swappedBytes = 0;
+
+    std::string getPath(const ExecutionState &state) const;
+
+  public:
+    explicit StateSwapper(std::string pathPrefix);
+    ~StateSwapper();
+
+    StateSwapper(const StateSwapper &) = delete;
+    StateSwapper &operator=(const StateSwapper &) = delete;
+
+    bool isSwappedOut(const ExecutionState &state) const {
+      return !swapped.empty() && swapped.count(&state);
+    }
+
+    /// \return The number of bytes freed.
+    std::uint64_t swapOut(ExecutionState &state);
+    void swapIn(ExecutionState &state);
+
+    /// Drop the swapped out contents of a state that is being terminated.
+    void discard(const ExecutionState &state);
+
+    std::size_t getNumSwappedStates() const { return swapped.size(); }
+    std::uint64_t getSwappedBytes() const { return swappedBytes; }
+  };
+}
+
+#endif /* KLEE_STATESWAPPER_H */
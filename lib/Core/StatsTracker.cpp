@@ -24,6 +24,7 @@
 #include "CallPathManager.h"
 #include "CoreStats.h"
 #include "Executor.h"
+#include "GEPExprBases.h"
 #include "MemoryManager.h"
 #include "UserSearcher.h"
 
@@ -35,6 +36,7 @@
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Module.h"
@@ -68,6 +70,18 @@ cl::opt<bool>
                 cl::desc("Write running stats trace file (default=true)"),
                 cl::cat(StatsCat));
 
+cl::opt<bool> OutputStatsTrace(
+    "output-stats-trace", cl::init(false),
+    cl::desc("Also write the running stats as a compact binary trace to "
+             "run.stats.bin (default=false)"),
+    cl::cat(StatsCat));
+
+cl::opt<bool> AsyncStats(
+    "async-stats", cl::init(true),
+    cl::desc("Write statistics files from a background thread instead of "
+             "the interpreter loop (default=true)"),
+    cl::cat(StatsCat));
+
 cl::opt<bool> OutputIStats("output-istats", cl::init(true),
                            cl::desc("Write instruction level statistics in "
                                     "callgrind format (default=true)"),
@@ -122,6 +136,15 @@ cl::opt<bool> UseCallPaths("use-call-paths", cl::init(true),
                                     "level statistics (default=true)"),
                            cl::cat(StatsCat));
 
+cl::opt<bool> IncrementalMinDistToUncovered(
+    "incremental-min-dist-to-uncovered", cl::init(true),
+    cl::desc("Only recompute the distances to uncovered instructions that new "
+             "coverage can have changed, instead of those of all functions "
+             "(default=true)"),
+    cl::cat(StatsCat));
+
+uint64_t minDistToUncoveredEpoch = 0;
+
 } // namespace
 
 ///
@@ -163,13 +186,6 @@ static bool instructionIsCoverable(Instruction *i) {
   return true;
 }
 
-std::string sqlite3ErrToStringAndFree(const std::string& prefix , char* sqlite3ErrMsg) {
-  std::ostringstream sstream;
-  sstream << prefix << sqlite3ErrMsg;
-  sqlite3_free(sqlite3ErrMsg);
-  return sstream.str();
-}
-
 StatsTracker::StatsTracker(Executor &_executor, std::string _objectFilename,
                            bool _updateMinDistToUncovered)
   : executor(_executor),
@@ -197,6 +213,7 @@ StatsTracker::StatsTracker(Executor &_executor, std::string _objectFilename,
   const time::Span bCovCheckInterval{BCovCheckInterval};
 
   KModule *km = executor.kmodule.get();
+  std::uint32_t statsCommitEvery;
   if(CommitEvery > 0) {
       statsCommitEvery = CommitEvery;
   } else {
@@ -216,71 +233,34 @@ StatsTracker::StatsTracker(Executor &_executor, std::string _objectFilename,
   if (useStatistics() || userSearcherRequiresMD2U())
     theStatisticManager->useIndexedStats(km->infos->getMaxID());
 
-  for (auto &kfp : km->functions) {
-    KFunction *kf = kfp.get();
-    kf->trackCoverage = 1;
-
-    for (unsigned i=0; i<kf->numInstructions; ++i) {
-      KInstruction *ki = kf->instructions[i];
-
+  // Walk the LLVM module, as KFunctions may be constructed lazily. All
+  // functions track coverage.
+  for (auto &fn : *km->module) {
+    for (auto &inst : instructions(fn)) {
       if (OutputIStats) {
-        unsigned id = ki->info->id;
+        unsigned id = km->infos->getInfo(inst).id;
         theStatisticManager->setIndex(id);
-        if (kf->trackCoverage && instructionIsCoverable(ki->inst))
+        if (instructionIsCoverable(&inst))
           ++stats::uncoveredInstructions;
       }
-      
-      if (kf->trackCoverage) {
-        if (BranchInst *bi = dyn_cast<BranchInst>(ki->inst))
-          if (!bi->isUnconditional())
-            numBranches++;
-      }
-    }
-  }
 
-  if (OutputStats) {
-    sqlite3_config(SQLITE_CONFIG_SINGLETHREAD);
-    sqlite3_enable_shared_cache(0);
-
-    // open database
-    auto db_filename = executor.interpreterHandler->getOutputFilename("run.stats");
-    if (sqlite3_open(db_filename.c_str(), &statsFile) != SQLITE_OK) {
-      std::ostringstream errorstream;
-      errorstream << "Can't open database: " << sqlite3_errmsg(statsFile);
-      sqlite3_close(statsFile);
-      klee_error("%s", errorstream.str().c_str());
+      if (BranchInst *bi = dyn_cast<BranchInst>(&inst))
+        if (!bi->isUnconditional())
+          numBranches++;
     }
+  }
 
-    // prepare statements
-    if (sqlite3_prepare_v2(statsFile, "BEGIN TRANSACTION", -1, &transactionBeginStmt, nullptr) != SQLITE_OK) {
-      klee_error("Cannot create prepared statement: %s", sqlite3_errmsg(statsFile));
-    }
-
-    if (sqlite3_prepare_v2(statsFile, "END TRANSACTION", -1, &transactionEndStmt, nullptr) != SQLITE_OK) {
-      klee_error("Cannot create prepared statement: %s", sqlite3_errmsg(statsFile));
-    }
-
-    // set options
-    char *zErrMsg;
-    if (sqlite3_exec(statsFile, "PRAGMA synchronous = OFF", nullptr, nullptr, &zErrMsg) != SQLITE_OK) {
-      klee_error("%s", sqlite3ErrToStringAndFree("Can't set options for database: ", zErrMsg).c_str());
-    }
-
-    // note: we use WAL here a) for speed and b) to prevent creation of new file descriptors (as with TRUNCATE)
-    if (sqlite3_exec(statsFile, "PRAGMA journal_mode = WAL", nullptr, nullptr, &zErrMsg) != SQLITE_OK) {
-      klee_error("%s", sqlite3ErrToStringAndFree("Can't set options for database: ", zErrMsg).c_str());
-    }
-
-    // create table
-    writeStatsHeader();
-
-    // begin transaction
-    auto rc = sqlite3_step(transactionBeginStmt);
-    if (rc != SQLITE_DONE) {
-      klee_warning("Can't begin transaction: %s", sqlite3_errmsg(statsFile));
-    }
-    sqlite3_reset(transactionBeginStmt);
-
+  statsWriter = std::unique_ptr<StatsWriter>(new StatsWriter(AsyncStats));
+  if (OutputStats)
+    statsWriter->addBackend(createSQLiteStatsBackend(
+        executor.interpreterHandler->getOutputFilename("run.stats"),
+        statsCommitEvery));
+  if (OutputStatsTrace)
+    statsWriter->addBackend(createBinaryStatsBackend(
+        executor.interpreterHandler->getOutputFilename("run.stats.bin")));
+  writeStats = statsWriter->hasBackends();
+
+  if (writeStats) {
     writeStatsLine();
 
     if (statsWriteInterval)
@@ -321,22 +301,13 @@ StatsTracker::StatsTracker(Executor &_executor, std::string _objectFilename,
   }
 }
 
-StatsTracker::~StatsTracker() {  
-  if (statsFile) {
-    auto rc = sqlite3_step(transactionEndStmt);
-    if (rc != SQLITE_DONE) {
-      klee_warning("Can't commit transaction: %s", sqlite3_errmsg(statsFile));
-    }
-    sqlite3_reset(transactionEndStmt);
-    sqlite3_finalize(transactionBeginStmt);
-    sqlite3_finalize(transactionEndStmt);
-    sqlite3_finalize(insertStmt);
-    sqlite3_close(statsFile);
-  }
+StatsTracker::~StatsTracker() {
+  // Finish writing before the files are closed.
+  statsWriter.reset();
 }
 
 void StatsTracker::done() {
-  if (statsFile)
+  if (writeStats)
     writeStatsLine();
 
   if (OutputIStats) {
@@ -345,6 +316,8 @@ void StatsTracker::done() {
     if (istatsFile)
       writeIStats();
   }
+
+  statsWriter->flush();
 }
 
 void StatsTracker::stepInstruction(ExecutionState &es) {
@@ -389,11 +362,12 @@ void StatsTracker::stepInstruction(ExecutionState &es) {
         es.instsSinceCovNew = 1;
 	++stats::coveredInstructions;
 	stats::uncoveredInstructions += (uint64_t)-1;
+        functionsWithNewCoverage.insert(sf.kf->function);
       }
     }
   }
 
-  if (statsFile && StatsWriteAfterInstructions &&
+  if (writeStats && StatsWriteAfterInstructions &&
       stats::instructions % StatsWriteAfterInstructions.getValue() == 0)
     writeStatsLine();
 
@@ -460,134 +434,39 @@ void StatsTracker::markBranchVisited(ExecutionState *visitedTrue,
   }
 }
 
-void StatsTracker::writeStatsHeader() {
-  std::ostringstream create, insert;
-  create << "CREATE TABLE stats ("
-             << "Instructions INTEGER,"
-             << "FullBranches INTEGER,"
-             << "PartialBranches INTEGER,"
-             << "NumBranches INTEGER,"
-             << "UserTime REAL,"
-             << "NumStates INTEGER,"
-             << "MallocUsage INTEGER,"
-             << "NumQueries INTEGER,"
-             << "NumQueryConstructs INTEGER,"
-             << "WallTime REAL,"
-             << "CoveredInstructions INTEGER,"
-             << "UncoveredInstructions INTEGER,"
-             << "QueryTime INTEGER,"
-             << "SolverTime INTEGER,"
-             << "CexCacheTime INTEGER,"
-             << "ForkTime INTEGER,"
-             << "ResolveTime INTEGER,"
-             << "QueryCexCacheMisses INTEGER,"
-             << "QueryCexCacheHits INTEGER,"
-             << "ArrayHashTime INTEGER"
-         << ')';
-  char *zErrMsg = nullptr;
-  if(sqlite3_exec(statsFile, create.str().c_str(), nullptr, nullptr, &zErrMsg)) {
-    klee_error("%s", sqlite3ErrToStringAndFree("ERROR creating table: ", zErrMsg).c_str());
-  }
-  /* Sometimes KLEE runs out of file descriptors and hence we try to a) keep important fds open and b) prevent the
-   * creation of temporary files. SQLite3 uses temporary files for statement journals, which help rollbacks when
-   * constraints are violated. We have no constraints in our table so there shouldn't be a constraint violation.
-   * `OR FAIL` will not write to temp files and therefore not rollback but simply fail. As said before this should not
-   * happen, but if it does this statement will fail with SQLITE_CONSTRAINT error. If this happens you should either
-   * remove the constraints or consider using `IGNORE` mode.
-   */
-  insert << "INSERT OR FAIL INTO stats ("
-             << "Instructions,"
-             << "FullBranches,"
-             << "PartialBranches,"
-             << "NumBranches,"
-             << "UserTime,"
-             << "NumStates,"
-             << "MallocUsage,"
-             << "NumQueries,"
-             << "NumQueryConstructs,"
-             << "WallTime,"
-             << "CoveredInstructions,"
-             << "UncoveredInstructions,"
-             << "QueryTime,"
-             << "SolverTime,"
-             << "CexCacheTime,"
-             << "ForkTime,"
-             << "ResolveTime,"
-             << "QueryCexCacheMisses,"
-             << "QueryCexCacheHits,"
-             << "ArrayHashTime"
-         << ") VALUES ("
-             << "?,"
-             << "?,"
-             << "?,"
-             << "?,"
-             << "?,"
-             << "?,"
-             << "?,"
-             << "?,"
-             << "?,"
-             << "?,"
-             << "?,"
-             << "?,"
-             << "?,"
-             << "?,"
-             << "?,"
-             << "?,"
-             << "?,"
-             << "?,"
-             << "?,"
-             << "? "
-         << ')';
-
-  if(sqlite3_prepare_v2(statsFile, insert.str().c_str(), -1, &insertStmt, nullptr) != SQLITE_OK) {
-    klee_error("Cannot create prepared statement: %s", sqlite3_errmsg(statsFile));
-  }
-}
-
 time::Span StatsTracker::elapsed() {
   return time::getWallTime() - startWallTime;
 }
 
 void StatsTracker::writeStatsLine() {
-  sqlite3_bind_int64(insertStmt, 1, stats::instructions);
-  sqlite3_bind_int64(insertStmt, 2, fullBranches);
-  sqlite3_bind_int64(insertStmt, 3, partialBranches);
-  sqlite3_bind_int64(insertStmt, 4, numBranches);
-  sqlite3_bind_int64(insertStmt, 5, time::getUserTime().toMicroseconds());
-  sqlite3_bind_int64(insertStmt, 6, executor.states.size());
-  sqlite3_bind_int64(insertStmt, 7, util::GetTotalMallocUsage() + executor.memory->getUsedDeterministicSize());
-  sqlite3_bind_int64(insertStmt, 8, stats::queries);
-  sqlite3_bind_int64(insertStmt, 9, stats::queryConstructs);
-  sqlite3_bind_int64(insertStmt, 10, elapsed().toMicroseconds());
-  sqlite3_bind_int64(insertStmt, 11, stats::coveredInstructions);
-  sqlite3_bind_int64(insertStmt, 12, stats::uncoveredInstructions);
-  sqlite3_bind_int64(insertStmt, 13, stats::queryTime);
-  sqlite3_bind_int64(insertStmt, 14, stats::solverTime);
-  sqlite3_bind_int64(insertStmt, 15, stats::cexCacheTime);
-  sqlite3_bind_int64(insertStmt, 16, stats::forkTime);
-  sqlite3_bind_int64(insertStmt, 17, stats::resolveTime);
-  sqlite3_bind_int64(insertStmt, 18, stats::queryCexCacheMisses);
-  sqlite3_bind_int64(insertStmt, 19, stats::queryCexCacheHits);
+  StatsSnapshot snapshot;
+  int64_t *v = snapshot.values;
+  v[StatsSnapshot::Instructions] = stats::instructions;
+  v[StatsSnapshot::FullBranches] = fullBranches;
+  v[StatsSnapshot::PartialBranches] = partialBranches;
+  v[StatsSnapshot::NumBranches] = numBranches;
+  v[StatsSnapshot::UserTime] = time::getUserTime().toMicroseconds();
+  v[StatsSnapshot::NumStates] = executor.states.size();
+  v[StatsSnapshot::MallocUsage] = util::GetTotalMallocUsage() + executor.memory->getUsedDeterministicSize();
+  v[StatsSnapshot::NumQueries] = stats::queries;
+  v[StatsSnapshot::NumQueryConstructs] = stats::queryConstructs;
+  v[StatsSnapshot::WallTime] = elapsed().toMicroseconds();
+  v[StatsSnapshot::CoveredInstructions] = stats::coveredInstructions;
+  v[StatsSnapshot::UncoveredInstructions] = stats::uncoveredInstructions;
+  v[StatsSnapshot::QueryTime] = stats::queryTime;
+  v[StatsSnapshot::SolverTime] = stats::solverTime;
+  v[StatsSnapshot::CexCacheTime] = stats::cexCacheTime;
+  v[StatsSnapshot::ForkTime] = stats::forkTime;
+  v[StatsSnapshot::ResolveTime] = stats::resolveTime;
+  v[StatsSnapshot::QueryCexCacheMisses] = stats::queryCexCacheMisses;
+  v[StatsSnapshot::QueryCexCacheHits] = stats::queryCexCacheHits;
 #ifdef KLEE_ARRAY_DEBUG
-  sqlite3_bind_int64(insertStmt, 20, stats::arrayHashTime);
+  v[StatsSnapshot::ArrayHashTime] = stats::arrayHashTime;
 #else
-  sqlite3_bind_int64(insertStmt, 20, -1LL);
+  v[StatsSnapshot::ArrayHashTime] = -1LL;
 #endif
-  int errCode = sqlite3_step(insertStmt);
-  if(errCode != SQLITE_DONE) klee_error("Error writing stats data: %s", sqlite3_errmsg(statsFile));
-  sqlite3_reset(insertStmt);
-
-  statsWriteCount++;
-  if(statsWriteCount == statsCommitEvery) {
-    errCode = sqlite3_step(transactionEndStmt);
-    if (errCode != SQLITE_DONE) klee_warning("Transaction commit error: %s", sqlite3_errmsg(statsFile));
-    sqlite3_reset(transactionEndStmt);
-    errCode = sqlite3_step(transactionBeginStmt);
-    if (errCode != SQLITE_DONE) klee_warning("Transaction begin error: %s", sqlite3_errmsg(statsFile));
-    sqlite3_reset(transactionBeginStmt);
-
-    statsWriteCount = 0;
-  }
+  v[StatsSnapshot::GEPExprBases] = GEPExprBases::getTotalEntries();
+  statsWriter->push(snapshot);
 }
 
 void StatsTracker::updateStateStatistics(uint64_t addend) {
@@ -601,21 +480,18 @@ void StatsTracker::updateStateStatistics(uint64_t addend) {
   }
 }
 
-void StatsTracker::writeIStats() {
-  const auto m = executor.kmodule->module.get();
-  llvm::raw_fd_ostream &of = *istatsFile;
-  
-  // We assume that we didn't move the file pointer
-  unsigned istatsSize = of.tell();
-
-  of.seek(0);
-
-  of << "version: 1\n";
-  of << "creator: klee\n";
-  of << "pid: " << getpid() << "\n";
-  of << "cmd: " << m->getModuleIdentifier() << "\n\n";
-  of << "\n";
+/// The instruction level statistics at one point of the execution. It is
+/// taken on the interpreter thread, and turned into run.istats by the stats
+/// writer.
+struct StatsTracker::IStatsSnapshot {
+  /// IDs of the statistics that are written.
+  std::vector<unsigned> statistics;
+  /// The value of each of these statistics for each instruction ID.
+  std::vector<uint64_t> values;
+  CallSiteSummaryTable callSiteStats;
+};
 
+void StatsTracker::writeIStats() {
   StatisticManager &sm = *theStatisticManager;
   unsigned nStats = sm.getNumStatistics();
   llvm::SmallBitVector istatsMask(nStats);
@@ -634,33 +510,66 @@ void StatsTracker::writeIStats() {
   istatsMask.set(sm.getStatisticID("States"));
   istatsMask.set(sm.getStatisticID("MinDistToUncovered"));
 
+  auto snapshot = std::make_shared<IStatsSnapshot>();
+  for (unsigned i=0; i<nStats; i++)
+    if (istatsMask.test(i))
+      snapshot->statistics.push_back(i);
+
+  // set state counts, decremented after we copied them so that we don't
+  // have to zero all records each time.
+  if (istatsMask.test(stats::states.getID()))
+    updateStateStatistics(1);
+
+  unsigned numIDs = executor.kmodule->infos->getMaxID();
+  snapshot->values.reserve(numIDs * snapshot->statistics.size());
+  for (unsigned id=0; id<numIDs; ++id)
+    for (unsigned i : snapshot->statistics)
+      snapshot->values.push_back(sm.getIndexedValue(sm.getStatistic(i), id));
+
+  if (UseCallPaths)
+    callPathManager.getSummaryStatistics(snapshot->callSiteStats);
+
+  if (istatsMask.test(stats::states.getID()))
+    updateStateStatistics((uint64_t)-1);
+
+  statsWriter->post([this, snapshot] { writeIStats(*snapshot); });
+}
+
+void StatsTracker::writeIStats(const IStatsSnapshot &snapshot) {
+  const auto m = executor.kmodule->module.get();
+  llvm::raw_fd_ostream &of = *istatsFile;
+  
+  // We assume that we didn't move the file pointer
+  unsigned istatsSize = of.tell();
+
+  of.seek(0);
+
+  of << "version: 1\n";
+  of << "creator: klee\n";
+  of << "pid: " << getpid() << "\n";
+  of << "cmd: " << m->getModuleIdentifier() << "\n\n";
+  of << "\n";
+
+  StatisticManager &sm = *theStatisticManager;
+  const std::vector<unsigned> &statistics = snapshot.statistics;
+  unsigned nStats = statistics.size();
+
   of << "positions: instr line\n";
 
-  for (unsigned i=0; i<nStats; i++) {
-    if (istatsMask.test(i)) {
-      Statistic &s = sm.getStatistic(i);
-      of << "event: " << s.getShortName() << " : " 
-         << s.getName() << "\n";
-    }
+  for (unsigned i : statistics) {
+    Statistic &s = sm.getStatistic(i);
+    of << "event: " << s.getShortName() << " : " 
+       << s.getName() << "\n";
   }
 
   of << "events: ";
-  for (unsigned i=0; i<nStats; i++) {
-    if (istatsMask.test(i))
-      of << sm.getStatistic(i).getShortName() << " ";
-  }
+  for (unsigned i : statistics)
+    of << sm.getStatistic(i).getShortName() << " ";
   of << "\n";
-  
-  // set state counts, decremented after we process so that we don't
-  // have to zero all records each time.
-  if (istatsMask.test(stats::states.getID()))
-    updateStateStatistics(1);
 
   std::string sourceFile = "";
 
-  CallSiteSummaryTable callSiteStats;
-  if (UseCallPaths)
-    callPathManager.getSummaryStatistics(callSiteStats);
+  const CallSiteSummaryTable &callSiteStats = snapshot.callSiteStats;
 
   of << "ob=" << llvm::sys::path::filename(objectFilename).str() << "\n";
 
@@ -692,18 +601,17 @@ void StatsTracker::writeIStats() {
           of << ii.assemblyLine << " ";
           of << ii.line << " ";
           for (unsigned i=0; i<nStats; i++)
-            if (istatsMask.test(i))
-              of << sm.getIndexedValue(sm.getStatistic(i), index) << " ";
+            of << snapshot.values[index * nStats + i] << " ";
           of << "\n";
 
           if (UseCallPaths && 
               (isa<CallInst>(instr) || isa<InvokeInst>(instr))) {
-            CallSiteSummaryTable::iterator it = callSiteStats.find(instr);
+            CallSiteSummaryTable::const_iterator it = callSiteStats.find(instr);
             if (it!=callSiteStats.end()) {
               for (auto fit = it->second.begin(), fie = it->second.end();
                    fit != fie; ++fit) {
                 const Function *f = fit->first;
-                CallSiteInfo &csi = fit->second;
+                const CallSiteInfo &csi = fit->second;
                 const FunctionInfo &fii =
                     executor.kmodule->infos->getFunctionInfo(*f);
 
@@ -716,21 +624,19 @@ void StatsTracker::writeIStats() {
 
                 of << ii.assemblyLine << " ";
                 of << ii.line << " ";
-                for (unsigned i=0; i<nStats; i++) {
-                  if (istatsMask.test(i)) {
-                    Statistic &s = sm.getStatistic(i);
-                    uint64_t value;
-
-                    // Hack, ignore things that don't make sense on
-                    // call paths.
-                    if (&s == &stats::uncoveredInstructions) {
-                      value = 0;
-                    } else {
-                      value = csi.statistics.getValue(s);
-                    }
-
-                    of << value << " ";
+                for (unsigned i : statistics) {
+                  Statistic &s = sm.getStatistic(i);
+                  uint64_t value;
+
+                  // Hack, ignore things that don't make sense on
+                  // call paths.
+                  if (&s == &stats::uncoveredInstructions) {
+                    value = 0;
+                  } else {
+                    value = csi.statistics.getValue(s);
                   }
+
+                  of << value << " ";
                 }
                 of << "\n";
               }
@@ -741,9 +647,6 @@ void StatsTracker::writeIStats() {
     }
   }
 
-  if (istatsMask.test(stats::states.getID()))
-    updateStateStatistics((uint64_t)-1);
-  
   // Clear then end of the file if necessary (no truncate op?).
   unsigned pos = of.tell();
   for (unsigned i=pos; i<istatsSize; ++i)
@@ -796,6 +699,98 @@ uint64_t klee::computeMinDistToUncovered(const KInstruction *ki,
   }
 }
 
+uint64_t klee::getMinDistToUncoveredEpoch() { return minDistToUncoveredEpoch; }
+
+/// Recompute minDistToUncovered for the instructions of \p f from its
+/// coverage and the current distances of its callees. The distance from the
+/// entry of \p f is stored under the ID of the function itself, which is
+/// what callers use; returns whether it changed.
+static bool computeFunctionMinDistToUncovered(Function *f,
+                                              const InstructionInfoTable &infos) {
+  StatisticManager &sm = *theStatisticManager;
+
+  std::vector<Instruction *> instructions;
+  for (Function::iterator bbIt = f->begin(), bb_ie = f->end(); 
+       bbIt != bb_ie; ++bbIt) {
+    for (BasicBlock::iterator it = bbIt->begin(), ie = bbIt->end(); 
+         it != ie; ++it) {
+      Instruction *inst = &*it;
+      unsigned id = infos.getInfo(*inst).id;
+      instructions.push_back(inst);
+      sm.setIndexedValue(stats::minDistToUncovered, 
+                         id, 
+                         sm.getIndexedValue(stats::uncoveredInstructions, id));
+    }
+  }
+
+  std::reverse(instructions.begin(), instructions.end());
+
+  bool changed;
+  do {
+    changed = false;
+    for (std::vector<Instruction*>::iterator it = instructions.begin(),
+           ie = instructions.end(); it != ie; ++it) {
+      Instruction *inst = *it;
+      uint64_t best, cur = best = sm.getIndexedValue(stats::minDistToUncovered,
+                                                     infos.getInfo(*inst).id);
+      unsigned bestThrough = 0;
+      
+      if (isa<CallInst>(inst) || isa<InvokeInst>(inst)) {
+        std::vector<Function*> &targets = callTargets[inst];
+        for (std::vector<Function*>::iterator fnIt = targets.begin(),
+               ie = targets.end(); fnIt != ie; ++fnIt) {
+          uint64_t dist = functionShortestPath[*fnIt];
+          if (dist) {
+            dist = 1+dist; // count instruction itself
+            if (bestThrough==0 || dist<bestThrough)
+              bestThrough = dist;
+          }
+
+          if (!(*fnIt)->isDeclaration()) {
+            uint64_t calleeDist = sm.getIndexedValue(
+                stats::minDistToUncovered, infos.getFunctionInfo(*(*fnIt)).id);
+            if (calleeDist) {
+              calleeDist = 1+calleeDist; // count instruction itself
+              if (best==0 || calleeDist<best)
+                best = calleeDist;
+            }
+          }
+        }
+      } else {
+        bestThrough = 1;
+      }
+      
+      if (bestThrough) {
+        std::vector<Instruction*> succs = getSuccs(inst);
+        for (std::vector<Instruction*>::iterator it2 = succs.begin(),
+               ie = succs.end(); it2 != ie; ++it2) {
+          uint64_t dist = sm.getIndexedValue(stats::minDistToUncovered,
+                                             infos.getInfo(*(*it2)).id);
+          if (dist) {
+            uint64_t val = bestThrough + dist;
+            if (best==0 || val<best)
+              best = val;
+          }
+        }
+      }
+
+      if (best != cur) {
+        sm.setIndexedValue(stats::minDistToUncovered, infos.getInfo(*inst).id,
+                           best);
+        changed = true;
+      }
+    }
+  } while (changed);
+
+  unsigned id = infos.getFunctionInfo(*f).id;
+  uint64_t entryDist = sm.getIndexedValue(
+      stats::minDistToUncovered, infos.getInfo(f->front().front()).id);
+  if (sm.getIndexedValue(stats::minDistToUncovered, id) == entryDist)
+    return false;
+  sm.setIndexedValue(stats::minDistToUncovered, id, entryDist);
+  return true;
+}
+
 void StatsTracker::computeReachableUncovered() {
   KModule *km = executor.kmodule.get();
   const auto m = km->module.get();
@@ -939,84 +934,59 @@ void StatsTracker::computeReachableUncovered() {
     } while (changed);
   }
 
-  // compute minDistToUncovered, 0 is unreachable
-  std::vector<Instruction *> instructions;
-  for (Module::iterator fnIt = m->begin(), fn_ie = m->end(); 
-       fnIt != fn_ie; ++fnIt) {
-    // Not sure if I should bother to preorder here.
-    for (Function::iterator bbIt = fnIt->begin(), bb_ie = fnIt->end(); 
-         bbIt != bb_ie; ++bbIt) {
-      for (BasicBlock::iterator it = bbIt->begin(), ie = bbIt->end(); 
-           it != ie; ++it) {
-        Instruction *inst = &*it;
-        unsigned id = infos.getInfo(*inst).id;
-        instructions.push_back(inst);
-        sm.setIndexedValue(stats::minDistToUncovered, 
-                           id, 
-                           sm.getIndexedValue(stats::uncoveredInstructions, id));
+  // compute minDistToUncovered, 0 is unreachable. Coverage only grows, so
+  // distances can only grow as well: only the functions with new coverage,
+  // and the callers that may have reached uncovered code through them, need
+  // to be recomputed.
+  std::set<Function *> invalid;
+  std::vector<Function *> worklist;
+  if (!minDistToUncoveredComputed || !IncrementalMinDistToUncovered) {
+    for (auto fnIt = m->rbegin(), fn_ie = m->rend(); fnIt != fn_ie; ++fnIt) {
+      if (!fnIt->isDeclaration()) {
+        worklist.push_back(&*fnIt);
+        sm.setIndexedValue(stats::minDistToUncovered,
+                           infos.getFunctionInfo(*fnIt).id, 0);
       }
     }
-  }
-  
-  std::reverse(instructions.begin(), instructions.end());
-  
-  // I'm so lazy it's not even worklisted.
-  bool changed;
-  do {
-    changed = false;
-    for (std::vector<Instruction*>::iterator it = instructions.begin(),
-           ie = instructions.end(); it != ie; ++it) {
-      Instruction *inst = *it;
-      uint64_t best, cur = best = sm.getIndexedValue(stats::minDistToUncovered,
-                                                     infos.getInfo(*inst).id);
-      unsigned bestThrough = 0;
-      
-      if (isa<CallInst>(inst) || isa<InvokeInst>(inst)) {
-        std::vector<Function*> &targets = callTargets[inst];
-        for (std::vector<Function*>::iterator fnIt = targets.begin(),
-               ie = targets.end(); fnIt != ie; ++fnIt) {
-          uint64_t dist = functionShortestPath[*fnIt];
-          if (dist) {
-            dist = 1+dist; // count instruction itself
-            if (bestThrough==0 || dist<bestThrough)
-              bestThrough = dist;
-          }
-
-          if (!(*fnIt)->isDeclaration()) {
-            uint64_t calleeDist = sm.getIndexedValue(
-                stats::minDistToUncovered, infos.getFunctionInfo(*(*fnIt)).id);
-            if (calleeDist) {
-              calleeDist = 1+calleeDist; // count instruction itself
-              if (best==0 || calleeDist<best)
-                best = calleeDist;
-            }
-          }
-        }
-      } else {
-        bestThrough = 1;
-      }
-      
-      if (bestThrough) {
-        std::vector<Instruction*> succs = getSuccs(inst);
-        for (std::vector<Instruction*>::iterator it2 = succs.begin(),
-               ie = succs.end(); it2 != ie; ++it2) {
-          uint64_t dist = sm.getIndexedValue(stats::minDistToUncovered,
-                                             infos.getInfo(*(*it2)).id);
-          if (dist) {
-            uint64_t val = bestThrough + dist;
-            if (best==0 || val<best)
-              best = val;
-          }
-        }
+    invalid.insert(worklist.begin(), worklist.end());
+    minDistToUncoveredComputed = true;
+  } else {
+    std::vector<Function *> pending(functionsWithNewCoverage.begin(),
+                                    functionsWithNewCoverage.end());
+    while (!pending.empty()) {
+      Function *f = pending.back();
+      pending.pop_back();
+      if (!invalid.insert(f).second)
+        continue;
+      worklist.push_back(f);
+
+      unsigned id = infos.getFunctionInfo(*f).id;
+      if (sm.getIndexedValue(stats::minDistToUncovered, id)) {
+        // callers may have used the old distance
+        for (Instruction *caller : functionCallers[f])
+          pending.push_back(caller->getParent()->getParent());
       }
-
-      if (best != cur) {
-        sm.setIndexedValue(stats::minDistToUncovered, infos.getInfo(*inst).id,
-                           best);
-        changed = true;
+      sm.setIndexedValue(stats::minDistToUncovered, id, 0);
+    }
+  }
+  functionsWithNewCoverage.clear();
+
+  // Distances of the other functions are up to date, so the invalidated
+  // ones only have to be iterated among themselves.
+  std::set<Function *> queued(invalid);
+  while (!worklist.empty()) {
+    Function *f = worklist.back();
+    worklist.pop_back();
+    queued.erase(f);
+
+    if (computeFunctionMinDistToUncovered(f, infos)) {
+      for (Instruction *caller : functionCallers[f]) {
+        Function *cf = caller->getParent()->getParent();
+        if (invalid.count(cf) && queued.insert(cf).second)
+          worklist.push_back(cf);
       }
     }
-  } while (changed);
+  }
 
   for (std::set<ExecutionState*>::iterator it = executor.states.begin(),
          ie = executor.states.end(); it != ie; ++it) {
@@ -1039,4 +1009,5 @@ void StatsTracker::computeReachableUncovered() {
       currentFrameMinDist = computeMinDistToUncovered(kii, currentFrameMinDist);
     }
   }
+  ++minDistToUncoveredEpoch;
 }
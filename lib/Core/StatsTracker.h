@@ -11,11 +11,11 @@
 #define KLEE_STATSTRACKER_H
 
 #include "CallPathManager.h"
+#include "StatsWriter.h"
 #include "klee/System/Time.h"
 
 #include <memory>
 #include <set>
-#include <sqlite3.h>
 
 namespace llvm {
   class BranchInst;
@@ -40,12 +40,10 @@ namespace klee {
     std::string objectFilename;
 
     std::unique_ptr<llvm::raw_fd_ostream> istatsFile;
-    ::sqlite3 *statsFile = nullptr;
-    ::sqlite3_stmt *transactionBeginStmt = nullptr;
-    ::sqlite3_stmt *transactionEndStmt = nullptr;
-    ::sqlite3_stmt *insertStmt = nullptr;
-    std::uint32_t statsCommitEvery;
-    std::uint32_t statsWriteCount = 0;
+    /// Writes run.stats and run.istats, possibly from another thread.
+    std::unique_ptr<StatsWriter> statsWriter;
+    /// Whether run.stats (or its binary trace) is written.
+    bool writeStats = false;
     time::Point startWallTime;
 
     unsigned numBranches;
@@ -55,15 +53,22 @@ namespace klee {
 
     bool updateMinDistToUncovered;
 
+    /// Functions in which instructions were covered since the last
+    /// computeReachableUncovered().
+    std::set<llvm::Function *> functionsWithNewCoverage;
+    bool minDistToUncoveredComputed = false;
+
   public:
     static bool useStatistics();
     static bool useIStats();
 
   private:
+    struct IStatsSnapshot;
+
     void updateStateStatistics(uint64_t addend);
-    void writeStatsHeader();
     void writeStatsLine();
     void writeIStats();
+    void writeIStats(const IStatsSnapshot &snapshot);
 
   public:
     StatsTracker(Executor &_executor, std::string _objectFilename,
@@ -103,6 +108,10 @@ namespace klee {
   uint64_t computeMinDistToUncovered(const KInstruction *ki,
                                      uint64_t minDistAtRA);
 
+  /// Changes whenever StatsTracker::computeReachableUncovered() has updated
+  /// the distances computeMinDistToUncovered() is based on.
+  uint64_t getMinDistToUncoveredEpoch();
+
 }
 
 #endif /* KLEE_STATSTRACKER_H */
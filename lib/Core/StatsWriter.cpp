@@ -0,0 +1,407 @@
+//===-- StatsWriter.cpp ---------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "StatsWriter.h"
+
+#include "klee/Support/ErrorHandling.h"
+
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <pthread.h>
+#include <signal.h>
+#include <sqlite3.h>
+#include <sstream>
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+struct ColumnInfo {
+  const char *name;
+  const char *type;
+};
+
+const ColumnInfo columns[StatsSnapshot::NumColumns] = {
+    {"Instructions", "INTEGER"},
+    {"FullBranches", "INTEGER"},
+    {"PartialBranches", "INTEGER"},
+    {"NumBranches", "INTEGER"},
+    {"UserTime", "REAL"},
+    {"NumStates", "INTEGER"},
+    {"MallocUsage", "INTEGER"},
+    {"NumQueries", "INTEGER"},
+    {"NumQueryConstructs", "INTEGER"},
+    {"WallTime", "REAL"},
+    {"CoveredInstructions", "INTEGER"},
+    {"UncoveredInstructions", "INTEGER"},
+    {"QueryTime", "INTEGER"},
+    {"SolverTime", "INTEGER"},
+    {"CexCacheTime", "INTEGER"},
+    {"ForkTime", "INTEGER"},
+    {"ResolveTime", "INTEGER"},
+    {"QueryCexCacheMisses", "INTEGER"},
+    {"QueryCexCacheHits", "INTEGER"},
+    {"ArrayHashTime", "INTEGER"},
+    {"GEPExprBases", "INTEGER"},
+};
+
+std::string sqlite3ErrToStringAndFree(const std::string &prefix,
+                                      char *sqlite3ErrMsg) {
+  std::ostringstream sstream;
+  sstream << prefix << sqlite3ErrMsg;
+  sqlite3_free(sqlite3ErrMsg);
+  return sstream.str();
+}
+
+class SQLiteStatsBackend : public StatsBackend {
+  ::sqlite3 *statsFile = nullptr;
+  ::sqlite3_stmt *transactionBeginStmt = nullptr;
+  ::sqlite3_stmt *transactionEndStmt = nullptr;
+  ::sqlite3_stmt *insertStmt = nullptr;
+  std::uint32_t statsCommitEvery;
+  std::uint32_t statsWriteCount = 0;
+
+  void writeStatsHeader();
+  void commit();
+
+public:
+  SQLiteStatsBackend(const std::string &path, std::uint32_t commitEvery);
+  ~SQLiteStatsBackend() override;
+
+  void write(const StatsSnapshot &snapshot) override;
+  void flush() override;
+};
+
+class BinaryStatsBackend : public StatsBackend {
+  FILE *file;
+
+public:
+  explicit BinaryStatsBackend(const std::string &path);
+  ~BinaryStatsBackend() override;
+
+  void write(const StatsSnapshot &snapshot) override;
+  void flush() override;
+};
+} // namespace
+
+const char *StatsSnapshot::getColumnName(unsigned column) {
+  return columns[column].name;
+}
+
+const char *StatsSnapshot::getColumnType(unsigned column) {
+  return columns[column].type;
+}
+
+///
+
+SQLiteStatsBackend::SQLiteStatsBackend(const std::string &path,
+                                       std::uint32_t commitEvery)
+    : statsCommitEvery(commitEvery) {
+  // The connection is used by one thread at a time only: the one creating
+  // the backend, then the stats writer thread.
+  sqlite3_config(SQLITE_CONFIG_SINGLETHREAD);
+  sqlite3_enable_shared_cache(0);
+
+  // open database
+  if (sqlite3_open(path.c_str(), &statsFile) != SQLITE_OK) {
+    std::ostringstream errorstream;
+    errorstream << "Can't open database: " << sqlite3_errmsg(statsFile);
+    sqlite3_close(statsFile);
+    klee_error("%s", errorstream.str().c_str());
+  }
+
+  // prepare statements
+  if (sqlite3_prepare_v2(statsFile, "BEGIN TRANSACTION", -1, &transactionBeginStmt, nullptr) != SQLITE_OK) {
+    klee_error("Cannot create prepared statement: %s", sqlite3_errmsg(statsFile));
+  }
+
+  if (sqlite3_prepare_v2(statsFile, "END TRANSACTION", -1, &transactionEndStmt, nullptr) != SQLITE_OK) {
+    klee_error("Cannot create prepared statement: %s", sqlite3_errmsg(statsFile));
+  }
+
+  // set options
+  char *zErrMsg;
+  if (sqlite3_exec(statsFile, "PRAGMA synchronous = OFF", nullptr, nullptr, &zErrMsg) != SQLITE_OK) {
+    klee_error("%s", sqlite3ErrToStringAndFree("Can't set options for database: ", zErrMsg).c_str());
+  }
+
+  // note: we use WAL here a) for speed and b) to prevent creation of new file descriptors (as with TRUNCATE)
+  if (sqlite3_exec(statsFile, "PRAGMA journal_mode = WAL", nullptr, nullptr, &zErrMsg) != SQLITE_OK) {
+    klee_error("%s", sqlite3ErrToStringAndFree("Can't set options for database: ", zErrMsg).c_str());
+  }
+
+  // create table
+  writeStatsHeader();
+
+  // begin transaction
+  auto rc = sqlite3_step(transactionBeginStmt);
+  if (rc != SQLITE_DONE) {
+    klee_warning("Can't begin transaction: %s", sqlite3_errmsg(statsFile));
+  }
+  sqlite3_reset(transactionBeginStmt);
+}
+
+SQLiteStatsBackend::~SQLiteStatsBackend() {
+  auto rc = sqlite3_step(transactionEndStmt);
+  if (rc != SQLITE_DONE) {
+    klee_warning("Can't commit transaction: %s", sqlite3_errmsg(statsFile));
+  }
+  sqlite3_reset(transactionEndStmt);
+  sqlite3_finalize(transactionBeginStmt);
+  sqlite3_finalize(transactionEndStmt);
+  sqlite3_finalize(insertStmt);
+  sqlite3_close(statsFile);
+}
+
+void SQLiteStatsBackend::writeStatsHeader() {
+  std::ostringstream create, insert;
+  create << "CREATE TABLE stats (";
+  for (unsigned i = 0; i < StatsSnapshot::NumColumns; ++i)
+    create << (i ? "," : "") << columns[i].name << ' ' << columns[i].type;
+  create << ')';
+  char *zErrMsg = nullptr;
+  if(sqlite3_exec(statsFile, create.str().c_str(), nullptr, nullptr, &zErrMsg)) {
+    klee_error("%s", sqlite3ErrToStringAndFree("ERROR creating table: ", zErrMsg).c_str());
+  }
+  /* Sometimes KLEE runs out of file descriptors and hence we try to a) keep important fds open and b) prevent the
+   * creation of temporary files. SQLite3 uses temporary files for statement journals, which help rollbacks when
+   * constraints are violated. We have no constraints in our table so there shouldn't be a constraint violation.
+   * `OR FAIL` will not write to temp files and therefore not rollback but simply fail. As said before this should not
+   * happen, but if it does this statement will fail with SQLITE_CONSTRAINT error. If this happens you should either
+   * remove the constraints or consider using `IGNORE` mode.
+   */
+  insert << "INSERT OR FAIL INTO stats (";
+  for (unsigned i = 0; i < StatsSnapshot::NumColumns; ++i)
+    insert << (i ? "," : "") << columns[i].name;
+  insert << ") VALUES (";
+  for (unsigned i = 0; i < StatsSnapshot::NumColumns; ++i)
+    insert << (i ? ",?" : "?");
+  insert << ')';
+
+  if(sqlite3_prepare_v2(statsFile, insert.str().c_str(), -1, &insertStmt, nullptr) != SQLITE_OK) {
+    klee_error("Cannot create prepared statement: %s", sqlite3_errmsg(statsFile));
+  }
+}
+
+void SQLiteStatsBackend::commit() {
+  int errCode = sqlite3_step(transactionEndStmt);
+  if (errCode != SQLITE_DONE) klee_warning("Transaction commit error: %s", sqlite3_errmsg(statsFile));
+  sqlite3_reset(transactionEndStmt);
+  errCode = sqlite3_step(transactionBeginStmt);
+  if (errCode != SQLITE_DONE) klee_warning("Transaction begin error: %s", sqlite3_errmsg(statsFile));
+  sqlite3_reset(transactionBeginStmt);
+
+  statsWriteCount = 0;
+}
+
+void SQLiteStatsBackend::write(const StatsSnapshot &snapshot) {
+  for (unsigned i = 0; i < StatsSnapshot::NumColumns; ++i)
+    sqlite3_bind_int64(insertStmt, i + 1, snapshot.values[i]);
+  int errCode = sqlite3_step(insertStmt);
+  if(errCode != SQLITE_DONE) klee_error("Error writing stats data: %s", sqlite3_errmsg(statsFile));
+  sqlite3_reset(insertStmt);
+
+  statsWriteCount++;
+  if (statsWriteCount == statsCommitEvery)
+    commit();
+}
+
+void SQLiteStatsBackend::flush() {
+  if (statsWriteCount)
+    commit();
+}
+
+///
+
+BinaryStatsBackend::BinaryStatsBackend(const std::string &path) {
+  file = fopen(path.c_str(), "wb");
+  if (!file)
+    klee_error("Unable to open statistics trace %s: %s", path.c_str(),
+               strerror(errno));
+
+  const char magic[8] = {'K', 'L', 'E', 'E', 'S', 'T', 'A', 'T'};
+  std::uint32_t header[2] = {1, StatsSnapshot::NumColumns};
+  fwrite(magic, sizeof(magic), 1, file);
+  fwrite(header, sizeof(header), 1, file);
+  for (unsigned i = 0; i < StatsSnapshot::NumColumns; ++i)
+    fwrite(columns[i].name, strlen(columns[i].name) + 1, 1, file);
+}
+
+BinaryStatsBackend::~BinaryStatsBackend() { fclose(file); }
+
+void BinaryStatsBackend::write(const StatsSnapshot &snapshot) {
+  // KLEE only runs on little-endian hosts, so the record is written as is.
+  if (fwrite(snapshot.values, sizeof(snapshot.values), 1, file) != 1)
+    klee_warning("Error writing statistics trace: %s", strerror(errno));
+}
+
+void BinaryStatsBackend::flush() { fflush(file); }
+
+std::unique_ptr<StatsBackend>
+klee::createSQLiteStatsBackend(const std::string &path,
+                               std::uint32_t commitEvery) {
+  return std::unique_ptr<StatsBackend>(
+      new SQLiteStatsBackend(path, commitEvery));
+}
+
+std::unique_ptr<StatsBackend>
+klee::createBinaryStatsBackend(const std::string &path) {
+  return std::unique_ptr<StatsBackend>(new BinaryStatsBackend(path));
+}
+
+///
+
+StatsWriter::StatsWriter(bool async) : async(async) {}
+
+StatsWriter::~StatsWriter() {
+  stop();
+
+  // Whatever the writer thread did not get to is written here.
+  drain();
+  if (control && control->pendingJob)
+    control->pendingJob();
+}
+
+void StatsWriter::addBackend(std::unique_ptr<StatsBackend> backend) {
+  backends.push_back(std::move(backend));
+}
+
+bool StatsWriter::drain() {
+  bool any = false;
+  StatsSnapshot snapshot;
+  while (queue.pop(snapshot)) {
+    for (auto &backend : backends)
+      backend->write(snapshot);
+    any = true;
+  }
+  return any;
+}
+
+void StatsWriter::ensureThread() {
+  pid_t pid = getpid();
+  if (thread && threadOwner == pid)
+    return;
+
+  if (thread) {
+    // We are in a process forked from the one that started the writer: its
+    // thread does not exist here, and its mutex may be held forever.
+    (void)thread.release();
+    (void)control.release();
+  }
+
+  control.reset(new Control());
+  threadOwner = pid;
+  Control &c = *control;
+
+  // The profiler samples with ITIMER_PROF, whose SIGPROF may be delivered to
+  // any thread; the writer inherits this mask so only the interpreter is hit.
+  sigset_t profMask, oldMask;
+  sigemptyset(&profMask);
+  sigaddset(&profMask, SIGPROF);
+  pthread_sigmask(SIG_BLOCK, &profMask, &oldMask);
+  thread.reset(new std::thread([this, &c] { run(c); }));
+  pthread_sigmask(SIG_SETMASK, &oldMask, nullptr);
+}
+
+void StatsWriter::run(Control &c) {
+  std::unique_lock<std::mutex> lock(c.mutex);
+  while (true) {
+    std::function<void()> job;
+    job.swap(c.pendingJob);
+    c.busy = true;
+    lock.unlock();
+
+    drain();
+    if (job)
+      job();
+
+    lock.lock();
+    c.busy = false;
+    if (queue.empty() && !c.pendingJob) {
+      c.writerIdle.notify_all();
+      if (c.stopping)
+        break;
+      // Snapshots do not wake the writer up, it polls for them instead so
+      // that pushing one never needs a system call.
+      c.wakeWriter.wait_for(lock, std::chrono::milliseconds(100));
+    }
+  }
+}
+
+void StatsWriter::stop() {
+  if (!thread)
+    return;
+
+  if (threadOwner != getpid()) {
+    (void)thread.release();
+    (void)control.release();
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(control->mutex);
+    control->stopping = true;
+  }
+  control->wakeWriter.notify_one();
+  thread->join();
+  thread.reset();
+}
+
+void StatsWriter::push(const StatsSnapshot &snapshot) {
+  if (!async) {
+    for (auto &backend : backends)
+      backend->write(snapshot);
+    return;
+  }
+
+  ensureThread();
+  while (!queue.push(snapshot)) {
+    // Only happens if the writer is stalled; wait for it to catch up
+    // rather than lose the snapshot.
+    control->wakeWriter.notify_one();
+    std::this_thread::yield();
+  }
+}
+
+void StatsWriter::post(std::function<void()> job) {
+  if (!async) {
+    job();
+    return;
+  }
+
+  ensureThread();
+  {
+    std::lock_guard<std::mutex> lock(control->mutex);
+    control->pendingJob = std::move(job);
+  }
+  control->wakeWriter.notify_one();
+}
+
+void StatsWriter::flush() {
+  if (async && thread) {
+    ensureThread();
+    std::unique_lock<std::mutex> lock(control->mutex);
+    control->wakeWriter.notify_one();
+    Control &c = *control;
+    c.writerIdle.wait(lock, [this, &c] {
+      return !c.busy && queue.empty() && !c.pendingJob;
+    });
+    // The writer is idle and cannot start anything new while we hold the
+    // lock, so the backends can be used from this thread.
+    for (auto &backend : backends)
+      backend->flush();
+    return;
+  }
+
+  drain();
+  for (auto &backend : backends)
+    backend->flush();
+}
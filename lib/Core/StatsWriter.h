@@ -0,0 +1,135 @@
+//===-- StatsWriter.h -------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_STATSWRITER_H
+#define KLEE_STATSWRITER_H
+
+#include "klee/ADT/SPSCQueue.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace klee {
+  /// One row of run.stats.
+  struct StatsSnapshot {
+    enum Column : unsigned {
+      Instructions,
+      FullBranches,
+      PartialBranches,
+      NumBranches,
+      UserTime,
+      NumStates,
+      MallocUsage,
+      NumQueries,
+      NumQueryConstructs,
+      WallTime,
+      CoveredInstructions,
+      UncoveredInstructions,
+      QueryTime,
+      SolverTime,
+      CexCacheTime,
+      ForkTime,
+      ResolveTime,
+      QueryCexCacheMisses,
+      QueryCexCacheHits,
+      ArrayHashTime,
+      GEPExprBases,
+      NumColumns
+    };
+
+    std::int64_t values[NumColumns];
+
+    static const char *getColumnName(unsigned column);
+    static const char *getColumnType(unsigned column);
+  };
+
+  /// Destination for statistics snapshots. Backends are only ever used from
+  /// one thread at a time.
+  class StatsBackend {
+  public:
+    virtual ~StatsBackend() = default;
+    virtual void write(const StatsSnapshot &snapshot) = 0;
+    /// Make everything written so far durable.
+    virtual void flush() {}
+  };
+
+  /// The run.stats SQLite database.
+  std::unique_ptr<StatsBackend>
+  createSQLiteStatsBackend(const std::string &path, std::uint32_t commitEvery);
+
+  /// A compact binary trace: the magic "KLEESTAT", a 32-bit version and
+  /// column count, the NUL-terminated column names and then one record of
+  /// little-endian 64-bit values per snapshot.
+  std::unique_ptr<StatsBackend>
+  createBinaryStatsBackend(const std::string &path);
+
+  /// Hands statistics from the interpreter to the backends. When
+  /// asynchronous, snapshots are passed through a lock-free ring buffer to a
+  /// background thread, so that the interpreter never waits on the disk.
+  class StatsWriter {
+    std::vector<std::unique_ptr<StatsBackend>> backends;
+    bool async;
+
+    SPSCQueue<StatsSnapshot, 1024> queue;
+
+    // Everything the writer thread synchronises on. It is replaced, not
+    // reused, in a process forked while the writer was running, as the
+    // thread that may have held the mutex does not exist there.
+    struct Control {
+      std::mutex mutex;
+      std::condition_variable wakeWriter;
+      std::condition_variable writerIdle;
+      // Only the most recent job is kept: a job that has not started by the
+      // time the next one is posted is superseded by it.
+      std::function<void()> pendingJob;
+      bool busy = false;
+      bool stopping = false;
+    };
+    std::unique_ptr<Control> control;
+
+    // The thread is started on first use and belongs to the process that
+    // started it, as KLEE may fork after the writer has been created.
+    std::unique_ptr<std::thread> thread;
+    pid_t threadOwner = 0;
+
+    void ensureThread();
+    void run(Control &c);
+    bool drain();
+    void stop();
+
+  public:
+    explicit StatsWriter(bool async);
+    ~StatsWriter();
+
+    StatsWriter(const StatsWriter &) = delete;
+    StatsWriter &operator=(const StatsWriter &) = delete;
+
+    void addBackend(std::unique_ptr<StatsBackend> backend);
+    bool hasBackends() const { return !backends.empty(); }
+
+    /// Record a snapshot in all backends.
+    void push(const StatsSnapshot &snapshot);
+
+    /// Run \p job on the writer thread, replacing any job not yet started.
+    void post(std::function<void()> job);
+
+    /// Wait until all snapshots and jobs have been written out.
+    void flush();
+  };
+}
+
+#endif /* KLEE_STATSWRITER_H */
@@ -15,8 +15,10 @@
 #include "klee/Statistics/Statistics.h"
 #include "klee/Statistics/TimerStatIncrementer.h"
 #include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverImpl.h"
 
 #include "CoreStats.h"
+#include "Profiler.h"
 
 using namespace klee;
 using namespace llvm;
@@ -33,6 +35,7 @@ bool TimingSolver::evaluate(const ConstraintSet &constraints, ref<Expr> expr,
   }
 
   TimerStatIncrementer timer(stats::solverTime);
+  profiler::PhaseScope phase(profiler::Phase::Solver);
 
   if (simplifyExprs)
     expr = ConstraintManager::simplifyExpr(constraints, expr);
@@ -44,6 +47,70 @@ bool TimingSolver::evaluate(const ConstraintSet &constraints, ref<Expr> expr,
   return success;
 }
 
+bool TimingSolver::evaluateBranch(
+    const ConstraintSet &constraints, ref<Expr> condition,
+    const std::vector<const Array *> &objects,
+    const std::shared_ptr<const Assignment> &hint, BranchResult &result,
+    SolverQueryMetaData &metaData) {
+  result.trueModel = result.falseModel = nullptr;
+  // Fast path, to avoid timer and OS overhead.
+  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(condition)) {
+    result.validity = CE->isTrue() ? Solver::True : Solver::False;
+    return true;
+  }
+
+  TimerStatIncrementer timer(stats::solverTime);
+  profiler::PhaseScope phase(profiler::Phase::Solver);
+
+  if (simplifyExprs)
+    condition = ConstraintManager::simplifyExpr(constraints, condition);
+
+  if (hint) {
+    ref<Expr> value = AssignmentEvaluator(*hint).visit(condition);
+    if (ConstantExpr *CE = dyn_cast<ConstantExpr>(value))
+      (CE->isTrue() ? result.trueModel : result.falseModel) = hint;
+  }
+
+  // A model of a side is a counterexample to the validity of the other.
+  // As the constraints are satisfiable, one side is feasible if the other
+  // one is not.
+  bool trueFeasible = result.trueModel != nullptr;
+  bool falseFeasible = result.falseModel != nullptr;
+  bool otherInfeasible = false;
+  bool success = true;
+  for (bool side : {true, false}) {
+    bool &feasible = side ? trueFeasible : falseFeasible;
+    if (feasible)
+      continue;
+    if (otherInfeasible) {
+      feasible = true;
+      break;
+    }
+    ref<Expr> other = side ? Expr::createIsZero(condition) : condition;
+    std::vector<std::vector<unsigned char>> values;
+    bool hasSolution;
+    success = solver->impl->computeInitialValues(
+        Query(constraints, other), objects, values, hasSolution);
+    if (!success)
+      break;
+    if (hasSolution) {
+      feasible = true;
+      (side ? result.trueModel : result.falseModel) =
+          std::make_shared<Assignment>(objects, values, true);
+    } else {
+      otherInfeasible = true;
+    }
+  }
+
+  metaData.queryCost += timer.delta();
+
+  if (trueFeasible && falseFeasible)
+    result.validity = Solver::Unknown;
+  else
+    result.validity = trueFeasible ? Solver::True : Solver::False;
+  return success;
+}
+
 bool TimingSolver::mustBeTrue(const ConstraintSet &constraints, ref<Expr> expr,
                               bool &result, SolverQueryMetaData &metaData) {
   // Fast path, to avoid timer and OS overhead.
@@ -53,6 +120,7 @@ bool TimingSolver::mustBeTrue(const ConstraintSet &constraints, ref<Expr> expr,
   }
 
   TimerStatIncrementer timer(stats::solverTime);
+  profiler::PhaseScope phase(profiler::Phase::Solver);
 
   if (simplifyExprs)
     expr = ConstraintManager::simplifyExpr(constraints, expr);
@@ -97,6 +165,7 @@ bool TimingSolver::getValue(const ConstraintSet &constraints, ref<Expr> expr,
   }
   
   TimerStatIncrementer timer(stats::solverTime);
+  profiler::PhaseScope phase(profiler::Phase::Solver);
 
   if (simplifyExprs)
     expr = ConstraintManager::simplifyExpr(constraints, expr);
@@ -116,6 +185,7 @@ bool TimingSolver::getInitialValues(
     return true;
 
   TimerStatIncrementer timer(stats::solverTime);
+  profiler::PhaseScope phase(profiler::Phase::Solver);
 
   bool success = solver->getInitialValues(
       Query(constraints, ConstantExpr::alloc(0, Expr::Bool)), objects, result);
@@ -129,6 +199,7 @@ std::pair<ref<Expr>, ref<Expr>>
 TimingSolver::getRange(const ConstraintSet &constraints, ref<Expr> expr,
                        SolverQueryMetaData &metaData, time::Span timeout) {
   TimerStatIncrementer timer(stats::solverTime);
+  profiler::PhaseScope phase(profiler::Phase::Solver);
   auto query = Query(constraints, expr);
   auto result = solver->getRange(query, timeout);
   metaData.queryCost += timer.delta();
@@ -10,6 +10,7 @@
 #ifndef KLEE_TIMINGSOLVER_H
 #define KLEE_TIMINGSOLVER_H
 
+#include "klee/Expr/Assignment.h"
 #include "klee/Expr/Constraints.h"
 #include "klee/Expr/Expr.h"
 #include "klee/Solver/Solver.h"
@@ -47,6 +48,26 @@ public:
   bool evaluate(const ConstraintSet &, ref<Expr>, Solver::Validity &result,
                 SolverQueryMetaData &metaData);
 
+  /// The feasibility of both sides of a branch, with a model of each
+  /// feasible side.
+  struct BranchResult {
+    Solver::Validity validity;
+    std::shared_ptr<const Assignment> trueModel;
+    std::shared_ptr<const Assignment> falseModel;
+  };
+
+  /// evaluateBranch - Evaluate a branch condition like evaluate(), and
+  /// compute a model binding \p objects for each feasible side, in at
+  /// most two solver queries. A constant condition gets no models.
+  ///
+  /// \param hint - A model of the constraints, or null. It is reused as
+  /// the model of the side it satisfies, so that only the other side is
+  /// queried.
+  bool evaluateBranch(const ConstraintSet &, ref<Expr> condition,
+                      const std::vector<const Array *> &objects,
+                      const std::shared_ptr<const Assignment> &hint,
+                      BranchResult &result, SolverQueryMetaData &metaData);
+
   bool mustBeTrue(const ConstraintSet &, ref<Expr>, bool &result,
                   SolverQueryMetaData &metaData);
 
@@ -80,9 +80,32 @@ cl::opt<std::string> BatchTime(
     cl::init("5s"),
     cl::cat(SearchCat));
 
+cl::opt<bool> UseZESTI(
+    "zesti",
+    cl::desc("Explore the paths that diverge from the paths of the seeds "
+             "near sensitive instructions first, instead of using --search "
+             "(see ICSE'12 paper \"make test-zesti\") (default=false)"),
+    cl::init(false),
+    cl::cat(SearchCat));
+
+cl::opt<unsigned> ZESTIDepth(
+    "zesti-depth",
+    cl::desc("Initial number of branches to explore after each divergence "
+             "from the seed paths with --zesti, doubled whenever exhausted "
+             "(default=2)"),
+    cl::init(2),
+    cl::cat(SearchCat));
+
 } // namespace
 
 void klee::initializeSearchOptions() {
+  if (UseZESTI) {
+    if (!CoreSearch.empty())
+      klee_warning("--zesti enabled. Ignoring --search.");
+    CoreSearch.clear();
+    return;
+  }
+
   // default values
   if (CoreSearch.empty()) {
     if (UseMerge){
@@ -103,6 +126,7 @@ bool klee::userSearcherRequiresMD2U() {
           std::find(CoreSearch.begin(), CoreSearch.end(), Searcher::NURS_QC) != CoreSearch.end());
 }
 
+bool klee::userSearcherRequiresZESTI() { return UseZESTI; }
 
 Searcher *getNewSearcher(Searcher::CoreSearchType type, RNG &rng, PTree &processTree) {
   Searcher *searcher = nullptr;
@@ -125,9 +149,17 @@ Searcher *getNewSearcher(Searcher::CoreSearchType type, RNG &rng, PTree &process
 
 Searcher *klee::constructUserSearcher(Executor &executor) {
 
-  Searcher *searcher = getNewSearcher(CoreSearch[0], executor.theRNG, *executor.processTree);
+  Searcher *searcher = nullptr;
+  if (UseZESTI) {
+    if (!executor.usingSeeds)
+      klee_warning("--zesti enabled without seeds. Exploring by depth.");
+    searcher = new ZESTISearcher(executor.seedSensitiveDepths, ZESTIDepth);
+  } else {
+    searcher = getNewSearcher(CoreSearch[0], executor.theRNG,
+                              *executor.processTree);
+  }
 
-  if (CoreSearch.size() > 1) {
+  if (!UseZESTI && CoreSearch.size() > 1) {
     std::vector<Searcher *> s;
     s.push_back(searcher);
 
@@ -146,7 +178,7 @@ Searcher *klee::constructUserSearcher(Executor &executor) {
     searcher = new IterativeDeepeningTimeSearcher(searcher);
   }
 
-  if (UseMerge) {
+  if (UseMerge || AutoMerge) {
     auto *ms = new MergingSearcher(searcher);
     executor.setMergingSearcher(ms);
 
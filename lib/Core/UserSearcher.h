@@ -17,6 +17,9 @@ namespace klee {
   // XXX gross, should be on demand?
   bool userSearcherRequiresMD2U();
 
+  /// Whether the seeds have to record their sensitive instructions.
+  bool userSearcherRequiresZESTI();
+
   void initializeSearchOptions();
 
   Searcher *constructUserSearcher(Executor &executor);
@@ -242,4 +242,13 @@ bool FunctionAliasPass::isFunctionOrGlobalFunctionAlias(const GlobalValue *gv) {
 
 char FunctionAliasPass::ID = 0;
 
+std::string describeFunctionAliasOptions() {
+  std::string result;
+  raw_string_ostream os(result);
+  os << "function-alias=";
+  for (const auto &pair : FunctionAlias)
+    os << pair.size() << ':' << pair;
+  return os.str();
+}
+
 } // namespace klee
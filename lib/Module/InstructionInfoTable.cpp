@@ -10,6 +10,8 @@
 #include "klee/Module/InstructionInfoTable.h"
 #include "klee/Config/Version.h"
 
+#include "ParallelFor.h"
+
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/AssemblyAnnotationWriter.h"
 #include "llvm/IR/DebugInfo.h"
@@ -28,7 +30,9 @@
 
 #include <cstdint>
 #include <map>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 using namespace klee;
 
@@ -83,6 +87,8 @@ buildInstructionToLineMap(const llvm::Module &m) {
 
 class DebugInfoExtractor {
   std::vector<std::unique_ptr<std::string>> &internedStrings;
+  std::unordered_map<std::string, std::string *> internedIndex;
+  std::mutex internedMutex;
   std::map<uintptr_t, uint64_t> lineTable;
 
   const llvm::Module &module;
@@ -95,18 +101,18 @@ public:
     lineTable = buildInstructionToLineMap(module);
   }
 
+  /// May be called from several threads.
   std::string &getInternedString(const std::string &s) {
-    auto found = std::find_if(internedStrings.begin(), internedStrings.end(),
-                              [&s](const std::unique_ptr<std::string> &item) {
-                                return *item.get() == s;
-                              });
-    if (found != internedStrings.end())
-      return *found->get();
+    std::lock_guard<std::mutex> lock(internedMutex);
+    auto found = internedIndex.find(s);
+    if (found != internedIndex.end())
+      return *found->second;
 
     auto newItem = std::unique_ptr<std::string>(new std::string(s));
     auto result = newItem.get();
 
     internedStrings.emplace_back(std::move(newItem));
+    internedIndex.emplace(s, result);
     return *result;
   }
 
@@ -164,19 +170,40 @@ public:
   }
 };
 
-InstructionInfoTable::InstructionInfoTable(const llvm::Module &m) {
+InstructionInfoTable::InstructionInfoTable(const llvm::Module &m,
+                                           unsigned threads) {
   // Generate all debug instruction information
   DebugInfoExtractor DI(internedStrings, m);
-  for (const auto &Func : m) {
-    auto F = DI.getFunctionInfo(Func);
-    auto FR = F.get();
-    functionInfos.insert(std::make_pair(&Func, std::move(F)));
-
+  std::vector<const llvm::Function *> functions;
+  for (const auto &Func : m)
+    functions.push_back(&Func);
+
+  // Functions are extracted in parallel, but inserted in module order so
+  // that the ids do not depend on the threads.
+  struct ExtractedFunction {
+    std::unique_ptr<FunctionInfo> info;
+    std::vector<std::pair<const llvm::Instruction *,
+                          std::unique_ptr<InstructionInfo>>>
+        instructions;
+  };
+  std::vector<ExtractedFunction> extracted(functions.size());
+  parallelFor(functions.size(), threads, [&](size_t i) {
+    const llvm::Function &Func = *functions[i];
+    ExtractedFunction &result = extracted[i];
+    result.info = DI.getFunctionInfo(Func);
     for (auto it = llvm::inst_begin(Func), ie = llvm::inst_end(Func); it != ie;
          ++it) {
       auto instr = &*it;
-      infos.insert(std::make_pair(instr, DI.getInstructionInfo(*instr, FR)));
+      result.instructions.emplace_back(
+          instr, DI.getInstructionInfo(*instr, result.info.get()));
     }
+  });
+
+  for (size_t i = 0; i < functions.size(); ++i) {
+    functionInfos.insert(
+        std::make_pair(functions[i], std::move(extracted[i].info)));
+    for (auto &info : extracted[i].instructions)
+      infos.insert(std::move(info));
   }
 
   // Make sure that every item has a unique ID
@@ -19,7 +19,9 @@ KInstruction::KInstruction(const KInstruction& ki):
   inst(ki.inst),
   info(ki.info),
   operands(ki.operands),
-  dest(ki.dest) {}
+  dest(ki.dest),
+  width(ki.width),
+  handler(ki.handler) {}
 
 KInstruction::~KInstruction() {
   delete[] operands;
@@ -30,6 +32,11 @@ KGEPInstruction::KGEPInstruction(const KGEPInstruction& ki):
   indices(ki.indices),
   offset(ki.offset) {}
 
+KCallInstruction::KCallInstruction(const KCallInstruction& ki):
+  KInstruction(ki),
+  calledFunction(ki.calledFunction),
+  dispatch(ki.dispatch) {}
+
 std::string KInstruction::getSourceLocation() const {
   if (!info->file.empty())
     return info->file + ":" + std::to_string(info->line) + " " +
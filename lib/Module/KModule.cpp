@@ -9,6 +9,7 @@
 
 #define DEBUG_TYPE "KModule"
 
+#include "ParallelFor.h"
 #include "Passes.h"
 
 #include "klee/Config/Version.h"
@@ -21,6 +22,7 @@
 #include "klee/Support/Debug.h"
 #include "klee/Support/ErrorHandling.h"
 #include "klee/Support/ModuleUtil.h"
+#include "klee/Support/Timer.h"
 
 #if LLVM_VERSION_CODE >= LLVM_VERSION(4, 0)
 #include "llvm/Bitcode/BitcodeWriter.h"
@@ -54,6 +56,7 @@
 #endif
 
 #include <sstream>
+#include <thread>
 
 using namespace llvm;
 using namespace klee;
@@ -119,12 +122,71 @@ namespace {
                              cl::desc("Allow optimization of functions that "
                                       "contain KLEE calls (default=true)"),
                              cl::init(true), cl::cat(ModuleCat));
+
+  cl::opt<unsigned> ModuleThreads(
+      "module-threads",
+      cl::desc("Number of threads extracting debug information and building "
+               "the functions of the module. 0 uses one per hardware thread "
+               "(default=0)"),
+      cl::init(0), cl::cat(ModuleCat));
+
+  cl::opt<bool> LazyFunctions(
+      "lazy-functions",
+      cl::desc("Construct the KLEE representation of a function only when it "
+               "is first called or named as a target, instead of for all "
+               "functions of the module up front (default=false)"),
+      cl::init(false), cl::cat(ModuleCat));
+
+  unsigned getModuleThreads() {
+    if (ModuleThreads)
+      return ModuleThreads;
+    return std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  /// Adds the wall time from its construction to its destruction to a
+  /// stage of KModule::preparationTimes.
+  class StageTimer {
+    std::vector<std::pair<std::string, time::Span>> &times;
+    const char *stage;
+    WallTimer timer;
+
+  public:
+    StageTimer(KModule &km, const char *stage)
+        : times(km.preparationTimes), stage(stage) {}
+    ~StageTimer() {
+      for (auto &time : times) {
+        if (time.first == stage) {
+          time.second += timer.delta();
+          return;
+        }
+      }
+      times.emplace_back(stage, timer.delta());
+    }
+  };
+
+  /// The function a KCallBlock for \p bb would call, or null if \p bb does
+  /// not start with a direct call.
+  Function *getCallBlockTarget(BasicBlock &bb) {
+    Instruction *first = &bb.front();
+    if (!isa<CallInst>(first) && !isa<InvokeInst>(first))
+      return nullptr;
+#if LLVM_VERSION_CODE >= LLVM_VERSION(8, 0)
+    return getTargetFunction(cast<CallBase>(first)->getCalledOperand());
+#else
+    return getTargetFunction(CallSite(first).getCalledValue());
+#endif
+  }
 }
 
 /***/
 
 namespace llvm {
 extern void Optimize(Module *, llvm::ArrayRef<const char *> preservedFunctions);
+extern std::string describeOptimizeOptions();
+}
+
+namespace klee {
+extern std::string describeFunctionAliasOptions();
 }
 
 // what a hack
@@ -229,6 +291,38 @@ void KModule::addInternalFunction(const char* functionName){
   internalFunctions.insert(internalFunction);
 }
 
+void KModule::addInternalFunctions(const Interpreter::ModuleOptions &opts) {
+  // Add internal functions which are not used to check if instructions
+  // have been already visited
+  if (opts.CheckDivZero)
+    addInternalFunction("klee_div_zero_check");
+  if (opts.CheckOvershift)
+    addInternalFunction("klee_overshift_check");
+}
+
+std::string
+KModule::describePreparation(const Interpreter::ModuleOptions &opts) const {
+  std::string result;
+  llvm::raw_string_ostream os(result);
+  os << "entry=" << opts.EntryPoint << " optimize=" << opts.Optimize
+     << " div-zero=" << opts.CheckDivZero
+     << " overshift=" << opts.CheckOvershift
+     << " fp-runtime=" << opts.WithFPRuntime
+     << " switch-type=" << static_cast<int>(SwitchType)
+     << " klee-call-optimisation=" << OptimiseKLEECall
+     << " float-internals=" << UseKleeFloatInternals
+     << " feround-internals=" << UseKleeFERoundInternals << " "
+     << describeOptimizeOptions() << " " << describeFunctionAliasOptions();
+  return os.str();
+}
+
+void KModule::setPreparedModule(std::unique_ptr<llvm::Module> m,
+                                const Interpreter::ModuleOptions &opts) {
+  module = std::move(m);
+  targetData = std::unique_ptr<llvm::DataLayout>(new DataLayout(module.get()));
+  addInternalFunctions(opts);
+}
+
 void KModule::calculateBackwardDistance(KFunction *kf) {
   std::map<KFunction*, unsigned int> &bdist = backwardDistance[kf];
   std::deque<KFunction*> nodes;
@@ -238,7 +332,7 @@ void KModule::calculateBackwardDistance(KFunction *kf) {
     KFunction *currKF = nodes.front();
     for (auto &cf : callMap[currKF->function]) {
       if (cf->isDeclaration()) continue;
-      KFunction *callKF = functionMap[cf];
+      KFunction *callKF = getKFunction(cf);
       if (bdist.find(callKF) == bdist.end()) {
         bdist[callKF] = bdist[callKF] + 1;
         nodes.push_back(callKF);
@@ -257,7 +351,7 @@ void KModule::calculateDistance(KFunction *kf) {
     KFunction *currKF = nodes.front();
     for (auto &callBlock : currKF->kCallBlocks) {
       if (!callBlock->calledFunction || callBlock->calledFunction->isDeclaration()) continue;
-      KFunction *callKF = functionMap[callBlock->calledFunction];
+      KFunction *callKF = getKFunction(callBlock->calledFunction);
       if (dist.find(callKF) == dist.end()) {
         dist[callKF] = dist[callKF] + 1;
         nodes.push_back(callKF);
@@ -269,6 +363,7 @@ void KModule::calculateDistance(KFunction *kf) {
 
 bool KModule::link(std::vector<std::unique_ptr<llvm::Module>> &modules,
                    const std::string &entryPoint) {
+  StageTimer timer(*this, "link");
   auto numRemainingModules = modules.size();
   // Add the currently active module to the list of linkables
   modules.push_back(std::move(module));
@@ -302,6 +397,7 @@ void KModule::instrument(const Interpreter::ModuleOptions &opts) {
   // invariant transformations that we will end up doing later so that
   // optimize is seeing what is as close as possible to the final
   // module.
+  StageTimer timer(*this, "instrument");
   legacy::PassManager pm;
   pm.add(new RaiseAsmPass());
 
@@ -333,16 +429,16 @@ void KModule::optimiseAndPrepare(
     pm.run(*module);
   }
 
-  if (opts.Optimize)
+  if (opts.Optimize) {
+    StageTimer timer(*this, "optimize");
     Optimize(module.get(), preservedFunctions);
+  }
 
-  // Add internal functions which are not used to check if instructions
-  // have been already visited
-  if (opts.CheckDivZero)
-    addInternalFunction("klee_div_zero_check");
-  if (opts.CheckOvershift)
-    addInternalFunction("klee_overshift_check");
-    // Use KLEE's internal float classification functions if requested.
+  StageTimer timer(*this, "prepare");
+
+  addInternalFunctions(opts);
+
+  // Use KLEE's internal float classification functions if requested.
   if (opts.WithFPRuntime) {
     if (UseKleeFloatInternals) {
       for (const auto& p : klee::floatReplacements) {
@@ -419,18 +515,22 @@ static void splitByCall(Function *function) {
 }
 
 void KModule::manifest(InterpreterHandler *ih, bool forceSourceOutput) {
-
-  for (auto &Function : *module) {
-    splitByCall(&Function);
+  {
+    StageTimer timer(*this, "split calls");
+    for (auto &Function : *module) {
+      splitByCall(&Function);
+    }
   }
 
   if (OutputSource || forceSourceOutput) {
+    StageTimer timer(*this, "output");
     std::unique_ptr<llvm::raw_fd_ostream> os(ih->openOutputFile("assembly.ll"));
     assert(os && !os->has_error() && "unable to open source output");
     *os << *module;
   }
 
   if (OutputModule) {
+    StageTimer timer(*this, "output");
     std::unique_ptr<llvm::raw_fd_ostream> f(ih->openOutputFile("final.bc"));
 #if LLVM_VERSION_CODE >= LLVM_VERSION(7, 0)
     WriteBitcodeToFile(*module, *f);
@@ -441,38 +541,51 @@ void KModule::manifest(InterpreterHandler *ih, bool forceSourceOutput) {
 
   /* Build shadow structures */
 
-  infos = std::unique_ptr<InstructionInfoTable>(
-      new InstructionInfoTable(*module.get()));
-
-  std::vector<Function *> declarations;
+  unsigned threads = getModuleThreads();
+  {
+    StageTimer timer(*this, "debug info");
+    infos = std::unique_ptr<InstructionInfoTable>(
+        new InstructionInfoTable(*module.get(), threads));
+  }
 
-  for (auto &Function : *module) {
-    if (Function.isDeclaration()) {
-      declarations.push_back(&Function);
-      continue;
+  std::vector<Function *> declarations, definitions;
+  {
+    StageTimer timer(*this, "functions");
+    for (auto &Function : *module) {
+      if (Function.isDeclaration())
+        declarations.push_back(&Function);
+      else
+        definitions.push_back(&Function);
     }
 
-    auto kf = std::unique_ptr<KFunction>(new KFunction(&Function, this));
-
-    llvm::Function *function = &Function;
-    for (auto &BasicBlock : *function) {
-        unsigned numInstructions = kf->blockMap[&BasicBlock]->numInstructions;
-        KBlock *kb = kf->blockMap[&BasicBlock];
-        for (unsigned i=0; i<numInstructions; ++i) {
-          KInstruction *ki = kb->instructions[i];
-          ki->info = &infos->getInfo(*ki->inst);
-        }
+    // The LLVM module is only read here; the constant table is filled in
+    // module order afterwards, so that constant ids do not depend on the
+    // threads. With --lazy-functions, getKFunction constructs each function
+    // when it is first needed instead.
+    if (!LazyFunctions) {
+      std::vector<std::unique_ptr<KFunction>> built(definitions.size());
+      parallelFor(definitions.size(), threads, [&](size_t i) {
+        auto kf =
+            std::unique_ptr<KFunction>(new KFunction(definitions[i], this));
+        setInstructionInfos(*kf);
+        built[i] = std::move(kf);
+      });
+
+      for (auto &kf : built) {
+        resolveConstants(*kf);
+        setInstructionWidths(*kf);
+        functionMap.insert(std::make_pair(kf->function, kf.get()));
+        functions.push_back(std::move(kf));
+      }
     }
-
-    functionMap.insert(std::make_pair(&Function, kf.get()));
-    functions.push_back(std::move(kf));
   }
 
   /* Compute various interesting properties */
 
-  for (auto &kf : functions) {
-    if (functionEscapes(kf->function))
-      escapingFunctions.insert(kf->function);
+  StageTimer timer(*this, "call graph");
+  for (auto &definition : definitions) {
+    if (functionEscapes(definition))
+      escapingFunctions.insert(definition);
   }
 
   for (auto &declaration : declarations) {
@@ -480,9 +593,12 @@ void KModule::manifest(InterpreterHandler *ih, bool forceSourceOutput) {
       escapingFunctions.insert(declaration);
   }
 
-  for (auto &kfp : functions) {
-    for (auto &kcb : kfp.get()->kCallBlocks) {
-      callMap[kcb->calledFunction].insert(kfp.get()->function);
+  // Read from the LLVM module rather than the kCallBlocks, as functions may
+  // not be constructed yet.
+  for (auto &definition : definitions) {
+    for (auto &bb : *definition) {
+      if (Function *callee = getCallBlockTarget(bb))
+        callMap[callee].insert(definition);
     }
   }
 
@@ -498,6 +614,7 @@ void KModule::manifest(InterpreterHandler *ih, bool forceSourceOutput) {
 }
 
 void KModule::checkModule() {
+  StageTimer timer(*this, "check");
   InstructionOperandTypeCheckPass *operandTypeCheckPass =
       new InstructionOperandTypeCheckPass();
 
@@ -515,8 +632,40 @@ void KModule::checkModule() {
   }
 }
 
+KFunction *KModule::getKFunction(llvm::Function *f) {
+  auto it = functionMap.find(f);
+  if (it != functionMap.end())
+    return it->second;
+  if (!f || f->isDeclaration())
+    return nullptr;
+
+  auto kf = std::unique_ptr<KFunction>(new KFunction(f, this));
+  setInstructionInfos(*kf);
+  resolveConstants(*kf);
+  setInstructionWidths(*kf);
+  KFunction *result = kf.get();
+  functionMap.insert(std::make_pair(f, result));
+  functions.push_back(std::move(kf));
+  return result;
+}
+
+void KModule::setInstructionInfos(KFunction &kf) const {
+  for (unsigned i = 0; i < kf.numInstructions; ++i) {
+    KInstruction *ki = kf.instructions[i];
+    ki->info = &infos->getInfo(*ki->inst);
+  }
+}
+
+void KModule::setInstructionWidths(KFunction &kf) const {
+  for (unsigned i = 0; i < kf.numInstructions; ++i) {
+    KInstruction *ki = kf.instructions[i];
+    Type *type = ki->inst->getType();
+    ki->width = type->isSized() ? targetData->getTypeSizeInBits(type) : 0;
+  }
+}
+
 KBlock* KModule::getKBlock(llvm::BasicBlock *bb) {
-  return functionMap[bb->getParent()]->blockMap[bb];
+  return getKFunction(bb->getParent())->blockMap[bb];
 }
 
 std::map<KFunction*, unsigned int>& KModule::getBackwardDistance(KFunction *kf) {
@@ -577,6 +726,16 @@ unsigned KModule::getConstantID(Constant *c, KInstruction* ki) {
   return id;
 }
 
+void KModule::resolveConstants(KFunction &kf) {
+  for (const auto &pending : kf.pendingConstants) {
+    KInstruction *ki = std::get<0>(pending);
+    ki->operands[std::get<1>(pending)] =
+        -(getConstantID(std::get<2>(pending), ki) + 2);
+  }
+  kf.pendingConstants.clear();
+  kf.pendingConstants.shrink_to_fit();
+}
+
 /***/
 
 KConstant::KConstant(llvm::Constant* _ct, unsigned _id, KInstruction* _ki) {
@@ -589,8 +748,7 @@ KConstant::KConstant(llvm::Constant* _ct, unsigned _id, KInstruction* _ki) {
 
 static int getOperandNum(Value *v,
                          std::map<Instruction*, unsigned> &registerMap,
-                         KModule *km,
-                         KInstruction *ki) {
+                         KInstruction *ki, unsigned index) {
   if (Instruction *inst = dyn_cast<Instruction>(v)) {
     return registerMap[inst];
   } else if (Argument *a = dyn_cast<Argument>(v)) {
@@ -600,8 +758,10 @@ static int getOperandNum(Value *v,
     return -1;
   } else {
     assert(isa<Constant>(v));
-    Constant *c = cast<Constant>(v);
-    return -(km->getConstantID(c, ki) + 2);
+    // numbered by KModule::resolveConstants
+    ki->parent->parent->pendingConstants.emplace_back(ki, index,
+                                                      cast<Constant>(v));
+    return 0;
   }
 }
 
@@ -622,17 +782,17 @@ void KBlock::handleKInstruction(
 #endif
     unsigned numArgs = cs.arg_size();
     ki->operands = new int[numArgs+1];
-    ki->operands[0] = getOperandNum(val, registerMap, km, ki);
+    ki->operands[0] = getOperandNum(val, registerMap, ki, 0);
     for (unsigned j=0; j<numArgs; j++) {
       Value *v = cs.getArgOperand(j);
-      ki->operands[j+1] = getOperandNum(v, registerMap, km, ki);
+      ki->operands[j+1] = getOperandNum(v, registerMap, ki, j+1);
     }
   } else {
     unsigned numOperands = inst->getNumOperands();
     ki->operands = new int[numOperands];
     for (unsigned j=0; j<numOperands; j++) {
       Value *v = inst->getOperand(j);
-      ki->operands[j] = getOperandNum(v, registerMap, km, ki);
+      ki->operands[j] = getOperandNum(v, registerMap, ki, j);
     }
   }
 }
@@ -766,6 +926,18 @@ KBlock::KBlock(KFunction *_kfunction, llvm::BasicBlock *block, KModule *km,
     case Instruction::InsertValue:
     case Instruction::ExtractValue:
       ki = new KGEPInstruction(); break;
+    case Instruction::Call:
+    case Instruction::Invoke: {
+      auto *kci = new KCallInstruction();
+#if LLVM_VERSION_CODE >= LLVM_VERSION(8, 0)
+      kci->calledFunction =
+          getTargetFunction(cast<CallBase>(*it).getCalledOperand());
+#else
+      kci->calledFunction = getTargetFunction(CallSite(&*it).getCalledValue());
+#endif
+      ki = kci;
+      break;
+    }
     default:
       ki = new KInstruction(); break;
     }
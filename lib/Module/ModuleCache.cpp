@@ -0,0 +1,128 @@
+//===-- ModuleCache.cpp ---------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Module/ModuleCache.h"
+
+#include "klee/Config/Version.h"
+#include "klee/Support/ErrorHandling.h"
+
+#if LLVM_VERSION_CODE >= LLVM_VERSION(4, 0)
+#include "llvm/Bitcode/BitcodeWriter.h"
+#else
+#include "llvm/Bitcode/ReaderWriter.h"
+#endif
+#include "llvm/ADT/SmallString.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+using namespace klee;
+
+namespace {
+/// Changed whenever the layout of the cache or the key changes.
+const char cacheVersion[] = "klee-module-cache-1";
+} // namespace
+
+ModuleCache::ModuleCache(const std::string &directory)
+    : directory(directory) {
+  addString(cacheVersion);
+  addString(std::to_string(LLVM_VERSION_CODE));
+}
+
+void ModuleCache::addString(StringRef value) {
+  assert(key.empty() && "key already computed");
+  // Prefix each input with its size, so that inputs cannot run together.
+  uint64_t size = value.size();
+  hasher.update(ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(&size),
+                                  sizeof(size)));
+  hasher.update(value);
+}
+
+void ModuleCache::addModule(const Module &m) {
+  SmallString<0> bitcode;
+  raw_svector_ostream os(bitcode);
+#if LLVM_VERSION_CODE >= LLVM_VERSION(7, 0)
+  WriteBitcodeToFile(m, os);
+#else
+  WriteBitcodeToFile(&m, os);
+#endif
+  addString(bitcode);
+}
+
+bool ModuleCache::addFile(const std::string &path) {
+  auto buffer = MemoryBuffer::getFile(path);
+  if (!buffer)
+    return false;
+  addString((*buffer)->getBuffer());
+  return true;
+}
+
+const std::string &ModuleCache::getKey() {
+  if (key.empty()) {
+    MD5::MD5Result result;
+    hasher.final(result);
+    key = result.digest().str().str();
+  }
+  return key;
+}
+
+std::string ModuleCache::getPath() {
+  SmallString<128> path;
+  sys::path::append(path, directory, getKey() + ".bc");
+  return path.str().str();
+}
+
+std::unique_ptr<Module> ModuleCache::load(LLVMContext &context) {
+  std::string path = getPath();
+  if (!sys::fs::exists(path))
+    return nullptr;
+
+  SMDiagnostic error;
+  std::unique_ptr<Module> m = parseIRFile(path, error, context);
+  if (!m)
+    klee_warning("Ignoring unreadable cached module %s: %s", path.c_str(),
+                 error.getMessage().str().c_str());
+  return m;
+}
+
+void ModuleCache::store(const Module &m) {
+  if (std::error_code ec = sys::fs::create_directories(directory)) {
+    klee_warning("Unable to create module cache directory %s: %s",
+                 directory.c_str(), ec.message().c_str());
+    return;
+  }
+
+  // Write to a temporary file first so that concurrent KLEE processes
+  // never load a partially written module.
+  std::string path = getPath();
+  int fd;
+  SmallString<128> tmpPath;
+  if (std::error_code ec =
+          sys::fs::createUniqueFile(path + ".tmp-%%%%%%", fd, tmpPath)) {
+    klee_warning("Unable to write cached module %s: %s", path.c_str(),
+                 ec.message().c_str());
+    return;
+  }
+  {
+    raw_fd_ostream os(fd, /*shouldClose=*/true);
+#if LLVM_VERSION_CODE >= LLVM_VERSION(7, 0)
+    WriteBitcodeToFile(m, os);
+#else
+    WriteBitcodeToFile(&m, os);
+#endif
+  }
+  if (sys::fs::rename(tmpPath, path))
+    sys::fs::remove(tmpPath);
+}
@@ -32,6 +32,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/PluginLoader.h"
+#include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/Scalar.h"
@@ -288,4 +289,12 @@ void Optimize(Module *M, llvm::ArrayRef<const char *> preservedFunctions) {
   // Run our queue of passes all at once now, efficiently.
   Passes.run(*M);
 }
+
+std::string describeOptimizeOptions() {
+  std::string result;
+  raw_string_ostream os(result);
+  os << "inline=" << !DisableInline << " internalize=" << !DisableInternalize
+     << " strip-all=" << Strip << " strip-debug=" << StripDebug;
+  return os.str();
+}
 }
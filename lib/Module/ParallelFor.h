@@ -0,0 +1,49 @@
+//===-- ParallelFor.h -------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_PARALLELFOR_H
+#define KLEE_PARALLELFOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace klee {
+
+/// Call \p body for each index in [0, n) on up to \p threads threads, the
+/// calling thread included, and wait for all calls to return. Indices are
+/// handed out one at a time, so that \p body may take very different times
+/// for different indices.
+template <typename Body>
+void parallelFor(std::size_t n, unsigned threads, const Body &body) {
+  std::size_t workers = std::min<std::size_t>(std::max(threads, 1u), n);
+  if (workers <= 1) {
+    for (std::size_t i = 0; i < n; ++i)
+      body(i);
+    return;
+  }
+
+  std::atomic<std::size_t> next{0};
+  auto work = [&]() {
+    for (std::size_t i = next++; i < n; i = next++)
+      body(i);
+  };
+  std::vector<std::thread> pool;
+  for (std::size_t i = 1; i < workers; ++i)
+    pool.emplace_back(work);
+  work();
+  for (auto &thread : pool)
+    thread.join();
+}
+
+} // namespace klee
+
+#endif /* KLEE_PARALLELFOR_H */
@@ -300,6 +300,20 @@ cl::list<std::string>
                    cl::desc("Specify a directory to replay ktest files from"),
                    cl::value_desc("output directory"), cl::cat(ReplayCat));
 
+cl::opt<bool> FastReplay(
+    "fast-replay",
+    cl::desc("When replaying ktest files, only report errors instead of "
+             "writing a new test case for every replayed path, and merge the "
+             "lines covered by all of them into replay.cov (default=false)"),
+    cl::init(false), cl::cat(ReplayCat));
+
+cl::opt<unsigned> ReplayJobs(
+    "replay-jobs",
+    cl::desc("Number of processes to split the replayed ktest files between. "
+             "Each process writes to its own replay<N> subdirectory of the "
+             "output directory (default=1)"),
+    cl::init(1), cl::cat(ReplayCat));
+
 cl::opt<std::string> ReplayPathFile("replay-path",
                                     cl::desc("Specify a path file to replay"),
                                     cl::value_desc("path file"),
@@ -314,6 +328,13 @@ cl::list<std::string>
                cl::desc("Directory with .ktest files to be used as seeds"),
                cl::cat(SeedingCat));
 
+cl::opt<unsigned> SeedJobs(
+    "seed-jobs",
+    cl::desc("Number of processes to split the seeds between. Each process "
+             "writes to its own seed<N> subdirectory of the output directory "
+             "and no two processes explore the same path (default=1)"),
+    cl::init(1), cl::cat(SeedingCat));
+
 cl::opt<unsigned> MakeConcreteSymbolic(
     "make-concrete-symbolic",
     cl::desc("Probabilistic rate at which to make concrete reads symbolic, "
@@ -370,6 +391,11 @@ private:
 
   SmallString<128> m_outputDirectory;
 
+  // used by --fast-replay
+  std::string m_replayedKTest;
+  std::map<std::string, std::set<unsigned>> m_replayCoverage;
+  std::unique_ptr<llvm::raw_fd_ostream> m_replayErrors;
+
   unsigned m_numTotalTests;     // Number of tests received from the interpreter
   unsigned m_numGeneratedTests; // Number of tests successfully generated
   unsigned m_pathsExplored;     // number of paths explored so far
@@ -422,6 +448,12 @@ public:
   void setOutputDirectory(const std::string &directory);
 
   SmallString<128> getOutputDirectory() const;
+
+  /// The ktest file being replayed, for --fast-replay error reports.
+  void setReplayedKTest(const std::string &path) { m_replayedKTest = path; }
+
+  /// Write the lines covered by all paths replayed so far to replay.cov.
+  void writeReplayCoverage();
 };
 
 KleeHandler::KleeHandler(int argc, char **argv)
@@ -505,6 +537,8 @@ KleeHandler::~KleeHandler() {
   delete m_symPathWriter;
   fclose(klee_warning_file);
   fclose(klee_message_file);
+  klee_warning_file = nullptr;
+  klee_message_file = nullptr;
 }
 
 void KleeHandler::setInterpreter(Interpreter *i) {
@@ -552,6 +586,17 @@ std::string KleeHandler::getTestFilename(const std::string &suffix,
   return filename.str();
 }
 
+void KleeHandler::writeReplayCoverage() {
+  auto f = openOutputFile("replay.cov");
+  if (!f)
+    return;
+  for (const auto &entry : m_replayCoverage) {
+    for (const auto &line : entry.second) {
+      *f << entry.first << ':' << line << '\n';
+    }
+  }
+}
+
 SmallString<128> KleeHandler::getOutputDirectory() const {
   return m_outputDirectory;
 }
@@ -695,6 +740,17 @@ void KleeHandler::processTestCase(ExecutionState &state,
 
   unsigned state_id = ++m_statesTerminated;
 
+  if (FastReplay) {
+    std::map<const std::string *, std::set<unsigned>> cov;
+    m_interpreter->getCoveredLines(state, cov);
+    for (const auto &entry : cov)
+      m_replayCoverage[*entry.first].insert(entry.second.begin(),
+                                            entry.second.end());
+    // the replayed ktest file already is the test case for this path
+    if (!errorMessage)
+      return;
+  }
+
   if (!WriteNone) {
     const auto start_time = time::getWallTime();
     TestCase assignments{};
@@ -742,6 +798,14 @@ void KleeHandler::processTestCase(ExecutionState &state,
       auto f = openTestFile(errorSuffix, test_id);
       if (f)
         *f << errorMessage;
+
+      if (FastReplay) {
+        if (!m_replayErrors)
+          m_replayErrors = openOutputFile("replay.errors");
+        if (m_replayErrors)
+          *m_replayErrors << m_replayedKTest << '\t'
+                          << getTestFilename(errorSuffix, test_id) << '\n';
+      }
     }
 
     if (m_pathWriter) {
@@ -846,7 +910,8 @@ void KleeHandler::getKTestFilesInDir(std::string directoryPath,
   llvm::sys::fs::directory_iterator i(directoryPath, ec), e;
   for (; i != e && !ec; i.increment(ec)) {
     auto f = i->path();
-    if (f.size() >= 6 && f.substr(f.size() - 6, f.size()) == ".ktest") {
+    if (StringRef(f).endswith(".ktest") ||
+        StringRef(f).endswith(".ktestbundle")) {
       results.push_back(f);
     }
   }
@@ -915,6 +980,12 @@ void KleeHandler::setOutputDirectory(const std::string &directoryName) {
 
   klee_message("output directory is \"%s\"", m_outputDirectory.c_str());
 
+  // Close the files inherited from the parent process, which flushed them
+  // before forking, so that nothing is written to them twice.
+  fclose(klee_warning_file);
+  fclose(klee_message_file);
+  m_replayErrors.reset();
+
   // open warnings.txt
   std::string file_path = getOutputFilename("warnings.txt");
   if ((klee_warning_file = fopen(file_path.c_str(), "w")) == NULL)
@@ -1385,6 +1456,142 @@ linkWithUclibc(StringRef libDir, std::string opt_suffix,
 }
 #endif
 
+static std::string getReplayJobDirectory(unsigned job) {
+  return "replay" + std::to_string(job);
+}
+
+/// Orders ktest files by the bytes of their objects, so that seeds likely
+/// to take the same early branches end up next to each other.
+static bool compareKTestInputs(const KTest *a, const KTest *b) {
+  for (unsigned i = 0; i < a->numObjects && i < b->numObjects; ++i) {
+    const KTestObject &x = a->objects[i], &y = b->objects[i];
+    int cmp = memcmp(x.bytes, y.bytes, std::min(x.numBytes, y.numBytes));
+    if (cmp)
+      return cmp < 0;
+    if (x.numBytes != y.numBytes)
+      return x.numBytes < y.numBytes;
+  }
+  return a->numObjects < b->numObjects;
+}
+
+namespace {
+/// A ktest within a ktest file or bundle; ktest files are bundles of one.
+struct KTestEntry {
+  std::string name;
+  KTestBundle *bundle;
+  unsigned index;
+
+  KTest *get() const { return kTestBundle_getKTest(bundle, index); }
+};
+} // namespace
+
+/// Map the ktest files and bundles \p paths and list the ktests in them.
+/// The ktests themselves are only parsed when they are used.
+/// \return False if a file could not be opened.
+static bool openKTests(const std::vector<std::string> &paths,
+                       std::vector<KTestBundle *> &bundles,
+                       std::vector<KTestEntry> &entries) {
+  bool success = true;
+  for (const std::string &path : paths) {
+    KTestBundle *bundle = kTestBundle_open(path.c_str());
+    if (!bundle) {
+      klee_warning("unable to open: %s\n", path.c_str());
+      success = false;
+      continue;
+    }
+    bundles.push_back(bundle);
+    bool isBundle = kTest_isBundleFile(path.c_str());
+    for (unsigned i = 0, e = kTestBundle_size(bundle); i < e; ++i)
+      entries.push_back(
+          {isBundle ? path + ":" + kTestBundle_getName(bundle, i) : path,
+           bundle, i});
+  }
+  return success;
+}
+
+/// Replay every \p jobs-th ktest of \p entries, starting with the \p
+/// job-th one.
+static void replayKTests(KleeHandler &handler, Interpreter &interpreter,
+                         Function *mainFn, char **pEnvp,
+                         const std::vector<KTestEntry> &entries,
+                         unsigned job, unsigned jobs) {
+  std::vector<std::pair<std::string, KTest *>> kTests;
+  for (std::size_t i = job; i < entries.size(); i += jobs) {
+    KTest *out = entries[i].get();
+    if (out) {
+      kTests.emplace_back(entries[i].name, out);
+    } else {
+      klee_warning("unable to open: %s\n", entries[i].name.c_str());
+    }
+  }
+
+  unsigned i = 0;
+  for (const auto &kTest : kTests) {
+    KTest *out = kTest.second;
+    interpreter.setReplayKTest(out);
+    handler.setReplayedKTest(kTest.first);
+    llvm::errs() << "KLEE: replaying: " << kTest.first << " ("
+                 << kTest_numBytes(out) << " bytes)"
+                 << " (" << ++i << "/" << kTests.size() << ")\n";
+    // XXX should put envp in .ktest ?
+    switch (ExecutionMode) {
+    case ExecutionKind::Default:
+      interpreter.runFunctionAsMain(mainFn, out->numArgs, out->args, pEnvp);
+      break;
+    case ExecutionKind::Guided:
+      interpreter.runMainAsGuided(mainFn, out->numArgs, out->args, pEnvp);
+      break;
+    }
+    if (interrupted)
+      break;
+  }
+  interpreter.setReplayKTest(0);
+
+  if (FastReplay)
+    handler.writeReplayCoverage();
+}
+
+/// Combine the replay.cov and replay.errors files written by the replay
+/// processes into the output directory.
+static void mergeReplayResults(KleeHandler &handler, unsigned jobs) {
+  std::map<std::string, std::set<unsigned>> coverage;
+  auto errors = handler.openOutputFile("replay.errors");
+
+  for (unsigned job = 0; job < jobs; ++job) {
+    SmallString<128> directory(getReplayJobDirectory(job));
+
+    SmallString<128> covPath(handler.getOutputFilename(directory.c_str()));
+    sys::path::append(covPath, "replay.cov");
+    std::ifstream cov(covPath.c_str());
+    for (std::string line; std::getline(cov, line);) {
+      auto colon = line.rfind(':');
+      if (colon != std::string::npos)
+        coverage[line.substr(0, colon)].insert(
+            std::stoul(line.substr(colon + 1)));
+    }
+
+    SmallString<128> errPath(handler.getOutputFilename(directory.c_str()));
+    sys::path::append(errPath, "replay.errors");
+    std::ifstream err(errPath.c_str());
+    for (std::string line; std::getline(err, line);) {
+      // make the error files relative to the output directory
+      auto tab = line.find('\t');
+      if (errors && tab != std::string::npos)
+        *errors << line.substr(0, tab + 1) << directory << '/'
+                << line.substr(tab + 1) << '\n';
+    }
+  }
+
+  auto f = handler.openOutputFile("replay.cov");
+  if (!f)
+    return;
+  for (const auto &entry : coverage) {
+    for (const auto &line : entry.second) {
+      *f << entry.first << ':' << line << '\n';
+    }
+  }
+}
+
 static int run_klee_on_function(
     int pArgc, char **pArgv, char **pEnvp,
     std::unique_ptr<KleeHandler> &handler,
@@ -1459,17 +1666,6 @@ static int run_klee_on_function(
                                             ie = ReplayKTestDir.end();
          it != ie; ++it)
       KleeHandler::getKTestFilesInDir(*it, kTestFiles);
-    std::vector<KTest *> kTests;
-    for (std::vector<std::string>::iterator it = kTestFiles.begin(),
-                                            ie = kTestFiles.end();
-         it != ie; ++it) {
-      KTest *out = kTest_fromFile(it->c_str());
-      if (out) {
-        kTests.push_back(out);
-      } else {
-        klee_warning("unable to open: %s\n", (*it).c_str());
-      }
-    }
 
     if (RunInDir != "") {
       int res = chdir(RunInDir.c_str());
@@ -1479,65 +1675,75 @@ static int run_klee_on_function(
       }
     }
 
-    unsigned i = 0;
-    for (std::vector<KTest *>::iterator it = kTests.begin(), ie = kTests.end();
-         it != ie; ++it) {
-      KTest *out = *it;
-      interpreter->setReplayKTest(out);
-      llvm::errs() << "KLEE: replaying: " << *it << " (" << kTest_numBytes(out)
-                   << " bytes)"
-                   << " (" << ++i << "/" << kTestFiles.size() << ")\n";
-      // XXX should put envp in .ktest ?
-      switch (ExecutionMode) {
-      case ExecutionKind::Default:
-        interpreter->runFunctionAsMain(mainFn, out->numArgs, out->args, pEnvp);
-        break;
-      case ExecutionKind::Guided:
-        interpreter->runMainAsGuided(mainFn, out->numArgs, out->args, pEnvp);
-        break;
+    std::vector<KTestBundle *> bundles;
+    std::vector<KTestEntry> entries;
+    openKTests(kTestFiles, bundles, entries);
+
+    unsigned jobs = std::max<std::size_t>(
+        1, std::min<std::size_t>(ReplayJobs, entries.size()));
+    if (jobs == 1) {
+      replayKTests(*handler, *interpreter, mainFn, pEnvp, entries, 0, 1);
+    } else {
+      klee_message("Replaying %zu ktest files in %u processes.",
+                   entries.size(), jobs);
+      SmallString<128> outputDirectory = handler->getOutputDirectory();
+      // Otherwise, buffered output would be written again by every process.
+      fflush(nullptr);
+      std::vector<pid_t> workers;
+      for (unsigned job = 0; job < jobs; ++job) {
+        pid_t pid = fork();
+        if (pid < 0) {
+          klee_error("Cannot create replay process: %s", strerror(errno));
+        } else if (pid == 0) {
+          SmallString<128> workerDirectory = outputDirectory;
+          sys::path::append(workerDirectory, getReplayJobDirectory(job));
+          handler->setOutputDirectory(workerDirectory.c_str());
+          replayKTests(*handler, *interpreter, mainFn, pEnvp, entries, job,
+                       jobs);
+          // write out replay.errors and close the output files
+          handler.reset();
+          exit(0);
+        }
+        workers.push_back(pid);
       }
-      if (interrupted)
-        break;
-    }
-    interpreter->setReplayKTest(0);
-    while (!kTests.empty()) {
-      kTest_free(kTests.back());
-      kTests.pop_back();
-    }
-  } else {
-    std::vector<KTest *> seeds;
-    for (std::vector<std::string>::iterator it = SeedOutFile.begin(),
-                                            ie = SeedOutFile.end();
-         it != ie; ++it) {
-      KTest *out = kTest_fromFile(it->c_str());
-      if (!out) {
-        klee_error("unable to open: %s\n", (*it).c_str());
+
+      for (pid_t pid : workers) {
+        int status;
+        if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != 0)
+          klee_warning("replay process %d did not finish", pid);
       }
-      seeds.push_back(out);
+      if (FastReplay)
+        mergeReplayResults(*handler, jobs);
     }
+
+    for (KTestBundle *bundle : bundles)
+      kTestBundle_close(bundle);
+  } else {
+    std::vector<std::string> kTestFiles = SeedOutFile;
     for (std::vector<std::string>::iterator it = SeedOutDir.begin(),
                                             ie = SeedOutDir.end();
          it != ie; ++it) {
-      std::vector<std::string> kTestFiles;
+      std::size_t numFiles = kTestFiles.size();
       KleeHandler::getKTestFilesInDir(*it, kTestFiles);
-      for (std::vector<std::string>::iterator it2 = kTestFiles.begin(),
-                                              ie = kTestFiles.end();
-           it2 != ie; ++it2) {
-        KTest *out = kTest_fromFile(it2->c_str());
-        if (!out) {
-          klee_error("unable to open: %s\n", (*it2).c_str());
-        }
-        seeds.push_back(out);
-      }
-      if (kTestFiles.empty()) {
+      if (kTestFiles.size() == numFiles) {
         klee_error("seeds directory is empty: %s\n", (*it).c_str());
       }
     }
 
-    if (!seeds.empty()) {
-      klee_message("KLEE: using %lu seeds\n", seeds.size());
-      interpreter->useSeeds(&seeds);
+    std::vector<KTestBundle *> bundles;
+    std::vector<KTestEntry> entries;
+    if (!openKTests(kTestFiles, bundles, entries))
+      klee_error("unable to open seeds");
+    std::vector<KTest *> seeds;
+    for (const KTestEntry &entry : entries) {
+      KTest *out = entry.get();
+      if (!out) {
+        klee_error("unable to open: %s\n", entry.name.c_str());
+      }
+      seeds.push_back(out);
     }
+
     if (RunInDir != "") {
       int res = chdir(RunInDir.c_str());
       if (res < 0) {
@@ -1546,19 +1752,65 @@ static int run_klee_on_function(
       }
     }
 
-    switch (ExecutionMode) {
-    case ExecutionKind::Default:
-      interpreter->runFunctionAsMain(mainFn, pArgc, pArgv, pEnvp);
-      break;
-    case ExecutionKind::Guided:
-      interpreter->runMainAsGuided(mainFn, pArgc, pArgv, pEnvp);
-      break;
-    }
+    auto run = [&]() {
+      switch (ExecutionMode) {
+      case ExecutionKind::Default:
+        interpreter->runFunctionAsMain(mainFn, pArgc, pArgv, pEnvp);
+        break;
+      case ExecutionKind::Guided:
+        interpreter->runMainAsGuided(mainFn, pArgc, pArgv, pEnvp);
+        break;
+      }
+    };
+
+    unsigned jobs = std::max<std::size_t>(
+        1, std::min<std::size_t>(SeedJobs, seeds.size()));
+    if (jobs == 1) {
+      if (!seeds.empty()) {
+        klee_message("KLEE: using %lu seeds\n", seeds.size());
+        interpreter->useSeeds(&seeds);
+      }
+      run();
+    } else {
+      klee_message("KLEE: using %lu seeds in %u processes\n", seeds.size(),
+                   jobs);
+      // Each process gets a contiguous range of similar seeds, so that the
+      // processes mostly explore disjoint parts of the tree.
+      std::sort(seeds.begin(), seeds.end(), compareKTestInputs);
+
+      SmallString<128> outputDirectory = handler->getOutputDirectory();
+      fflush(nullptr);
+      std::vector<pid_t> workers;
+      for (unsigned job = 0; job < jobs; ++job) {
+        pid_t pid = fork();
+        if (pid < 0) {
+          klee_error("Cannot create seeding process: %s", strerror(errno));
+        } else if (pid == 0) {
+          SmallString<128> workerDirectory = outputDirectory;
+          sys::path::append(workerDirectory, "seed" + std::to_string(job));
+          handler->setOutputDirectory(workerDirectory.c_str());
+          std::vector<KTest *> jobSeeds(
+              seeds.begin() + seeds.size() * job / jobs,
+              seeds.begin() + seeds.size() * (job + 1) / jobs);
+          interpreter->useSeeds(&jobSeeds);
+          interpreter->partitionPaths(job, jobs);
+          run();
+          handler.reset();
+          exit(0);
+        }
+        workers.push_back(pid);
+      }
 
-    while (!seeds.empty()) {
-      kTest_free(seeds.back());
-      seeds.pop_back();
+      for (pid_t pid : workers) {
+        int status;
+        if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != 0)
+          klee_warning("seeding process %d did not finish", pid);
+      }
     }
+
+    for (KTestBundle *bundle : bundles)
+      kTestBundle_close(bundle);
   }
 
   auto endTime = std::time(nullptr);
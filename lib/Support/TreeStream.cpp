@@ -11,40 +11,122 @@
 #include "klee/ADT/TreeStream.h"
 
 #include "klee/Support/Debug.h"
+#include "klee/Support/ErrorHandling.h"
 
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
 #include <cassert>
-#include <iomanip>
-#include <fstream>
-#include <iterator>
-#include <map>
+#include <cerrno>
+#include <cstring>
 
-#include "llvm/Support/raw_ostream.h"
-#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 using namespace klee;
 
+namespace {
+/// Chunks are allocated in units of this size; larger records get a chunk of
+/// their own.
+const std::size_t chunkSize = 1 << 20;
+
+struct RecordHeader {
+  /// Previous record of the same stream.
+  std::uint64_t prev;
+  std::uint32_t stream;
+  std::uint32_t size;
+};
+
+std::size_t alignTo(std::size_t value, std::size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
 ///
 
-TreeStreamWriter::TreeStreamWriter(const std::string &_path) 
-  : lastID(0),
-    bufferCount(0),
-    path(_path),
-    output(new std::ofstream(path.c_str(), 
-                             std::ios::out | std::ios::binary)),
-    ids(1) {
-  if (!output->good()) {
-    delete output;
-    output = 0;
-  }
+TreeStreamWriter::TreeStreamWriter(const std::string &_path)
+  : path(_path),
+    fd(::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)),
+    owner(getpid()),
+    segmentSize(0),
+    chunkUsed(0),
+    ownsLastChunk(false),
+    openRecord(noRecord),
+    openRecordSize(0),
+    tails(1, noRecord) {
 }
 
 TreeStreamWriter::~TreeStreamWriter() {
-  flush();
-  delete output;
+  if (fd >= 0 && owner == getpid()) {
+    // Give back the unused part of the last chunk.
+    off_t unused = ownsLastChunk ? chunks.back().size - chunkUsed : 0;
+    if (ftruncate(fd, segmentSize - unused))
+      klee_warning("Unable to truncate %s: %s", path.c_str(), strerror(errno));
+  }
+  for (const Chunk &c : chunks)
+    munmap(c.base, c.size);
+  if (fd >= 0)
+    close(fd);
 }
 
 bool TreeStreamWriter::good() {
-  return !!output;
+  return fd >= 0;
+}
+
+char *TreeStreamWriter::getRecord(RecordAddress address) const {
+  assert(address != noRecord);
+  return chunks[address >> 32].base + (address & 0xFFFFFFFF);
+}
+
+bool TreeStreamWriter::ensureSegment() {
+  pid_t pid = getpid();
+  if (pid == owner)
+    return fd >= 0;
+
+  // This process was forked from the one writing the current segment. The
+  // chunks mapped so far stay readable, but new records go to a segment of
+  // its own, so that the processes do not overwrite each other.
+  if (openRecord != noRecord)
+    forkedRecords.emplace_back(openRecord, openRecordSize);
+  if (fd >= 0)
+    close(fd);
+  std::string segmentPath = path + "." + std::to_string(pid);
+  fd = ::open(segmentPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    klee_warning("Unable to open %s: %s", segmentPath.c_str(),
+                 strerror(errno));
+  owner = pid;
+  segmentSize = 0;
+  chunkUsed = 0;
+  ownsLastChunk = false;
+  openRecord = noRecord;
+  return fd >= 0;
+}
+
+bool TreeStreamWriter::addChunk(std::size_t minSize) {
+  static const std::size_t pageSize = sysconf(_SC_PAGESIZE);
+  std::size_t size = std::max(chunkSize, alignTo(minSize, pageSize));
+  assert(size <= 0xFFFFFFFF && chunks.size() < 0xFFFFFFFF &&
+         "record address out of range");
+
+  if (ftruncate(fd, segmentSize + size)) {
+    klee_warning("Unable to extend %s: %s", path.c_str(), strerror(errno));
+    return false;
+  }
+  void *base =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, segmentSize);
+  if (base == MAP_FAILED) {
+    klee_warning("Unable to map %s: %s", path.c_str(), strerror(errno));
+    return false;
+  }
+
+  chunks.push_back({static_cast<char *>(base), size});
+  segmentSize += size;
+  chunkUsed = 0;
+  ownsLastChunk = true;
+  openRecord = noRecord;
+  return true;
 }
 
 TreeOStream TreeStreamWriter::open() {
@@ -52,112 +134,87 @@ TreeOStream TreeStreamWriter::open() {
 }
 
 TreeOStream TreeStreamWriter::open(const TreeOStream &os) {
-  assert(output && os.writer==this);
-  flushBuffer();
-  unsigned id = ids++;
-  output->write(reinterpret_cast<const char*>(&os.id), 4);
-  unsigned tag = id | (1<<31);
-  output->write(reinterpret_cast<const char*>(&tag), 4);
+  assert(good() && os.writer==this);
+  ensureSegment();
+  unsigned id = tails.size();
+  RecordAddress tail = tails[os.id];
+  // The new stream shares the parent's last record, which therefore must not
+  // grow any further.
+  if (openRecord == tail)
+    openRecord = noRecord;
+  tails.push_back(tail);
   return TreeOStream(*this, id);
 }
 
 void TreeStreamWriter::write(TreeOStream &os, const char *s, unsigned size) {
-  if (bufferCount && 
-      (os.id!=lastID || size+bufferCount>bufferSize))
-    flushBuffer();
-  if (bufferCount) { // (os.id==lastID && size+bufferCount<=bufferSize)
-    memcpy(&buffer[bufferCount], s, size);
-    bufferCount += size;
-  } else if (size<bufferSize) {
-    lastID = os.id;
-    memcpy(buffer, s, size);
-    bufferCount = size;
-  } else {
-    output->write(reinterpret_cast<const char*>(&os.id), 4);
-    output->write(reinterpret_cast<const char*>(&size), 4);
-    output->write(s, size);
+  if (!size || !ensureSegment())
+    return;
+
+  RecordAddress &tail = tails[os.id];
+
+  // Consecutive writes to the same stream extend its last record.
+  if (openRecord != noRecord && openRecord == tail &&
+      chunkUsed + size <= chunks.back().size) {
+    auto *header = reinterpret_cast<RecordHeader *>(getRecord(openRecord));
+    assert(header->stream == os.id);
+    if (openRecordSize + std::uint64_t(size) <= 0xFFFFFFFF) {
+      memcpy(chunks.back().base + chunkUsed, s, size);
+      openRecordSize += size;
+      header->size = openRecordSize;
+      chunkUsed += size;
+      return;
+    }
   }
-}
 
-void TreeStreamWriter::flushBuffer() {
-  if (bufferCount) {    
-    output->write(reinterpret_cast<const char*>(&lastID), 4);
-    output->write(reinterpret_cast<const char*>(&bufferCount), 4);
-    output->write(buffer, bufferCount);
-    bufferCount = 0;
+  std::size_t recordSize = sizeof(RecordHeader) + size;
+  std::size_t offset = alignTo(chunkUsed, alignof(RecordHeader));
+  if (!ownsLastChunk || offset + recordSize > chunks.back().size) {
+    if (!addChunk(recordSize))
+      return;
+    offset = 0;
   }
+
+  char *record = chunks.back().base + offset;
+  RecordHeader header = {tail, os.id, size};
+  memcpy(record, &header, sizeof(header));
+  memcpy(record + sizeof(header), s, size);
+
+  tail = (RecordAddress(chunks.size() - 1) << 32) | offset;
+  openRecord = tail;
+  openRecordSize = size;
+  chunkUsed = offset + recordSize;
 }
 
 void TreeStreamWriter::flush() {
-  flushBuffer();
-  output->flush();
+  // The records are already in the shared mapping, readStream and other
+  // processes see them; this only starts writing them back to the file.
+  if (ownsLastChunk && owner == getpid())
+    msync(chunks.back().base, chunks.back().size, MS_ASYNC);
 }
 
 void TreeStreamWriter::readStream(TreeStreamID streamID,
                                   std::vector<unsigned char> &out) {
-  assert(streamID>0 && streamID<ids);
-  flush();
-  
-  std::ifstream is(path.c_str(),
-                   std::ios::in | std::ios::binary);
-  assert(is.good());
-  KLEE_DEBUG(llvm::errs() << "finding chain for: " << streamID << "\n");
-
-  std::map<unsigned,unsigned> parents;
-  std::vector<unsigned> roots;
-  for (;;) {
-    assert(is.good());
-    unsigned id;
-    unsigned tag;
-    is.read(reinterpret_cast<char*>(&id), 4);
-    is.read(reinterpret_cast<char*>(&tag), 4);
-    if (tag&(1<<31)) { // fork
-      unsigned child = tag ^ (1<<31);
-
-      if (child==streamID) {
-        roots.push_back(child);
-        while (id) {
-          roots.push_back(id);
-          std::map<unsigned, unsigned>::iterator it = parents.find(id);
-          assert(it!=parents.end());
-          id = it->second;
-        } 
-        break;
-      } else {
-        parents.insert(std::make_pair(child,id));
-      }
-    } else {
-      unsigned size = tag;
-      while (size--) is.get();
-    }
+  assert(streamID>0 && streamID<tails.size());
+  ensureSegment();
+
+  std::vector<std::pair<const char *, std::uint32_t>> records;
+  std::size_t total = 0;
+  for (RecordAddress a = tails[streamID]; a != noRecord;) {
+    auto *header = reinterpret_cast<const RecordHeader *>(getRecord(a));
+    std::uint32_t size = header->size;
+    for (const auto &forked : forkedRecords)
+      if (forked.first == a)
+        size = forked.second;
+    records.emplace_back(reinterpret_cast<const char *>(header + 1), size);
+    total += size;
+    a = header->prev;
   }
-  KLEE_DEBUG({
-      llvm::errs() << "roots: ";
-      for (size_t i = 0, e = roots.size(); i < e; ++i) {
-        llvm::errs() << roots[i] << " ";
-      }
-      llvm::errs() << "\n";
-    });
-  is.seekg(0, std::ios::beg);
-  for (;;) {
-    unsigned id;
-    unsigned tag;
-    is.read(reinterpret_cast<char*>(&id), 4);
-    is.read(reinterpret_cast<char*>(&tag), 4);
-    if (!is.good()) break;
-    if (tag&(1<<31)) { // fork
-      unsigned child = tag ^ (1<<31);
-      if (id==roots.back() && roots.size()>1 && child==roots[roots.size()-2])
-        roots.pop_back();
-    } else {
-      unsigned size = tag;
-      if (id==roots.back()) {
-        while (size--) out.push_back(is.get());
-      } else {
-        while (size--) is.get();
-      }
-    }
-  }  
+  KLEE_DEBUG(llvm::errs() << "stream " << streamID << ": " << records.size()
+                          << " records, " << total << " bytes\n");
+
+  out.reserve(out.size() + total);
+  for (auto it = records.rbegin(), ie = records.rend(); it != ie; ++it)
+    out.insert(out.end(), it->first, it->first + it->second);
 }
 
 ///
@@ -0,0 +1,21 @@
+// RUN: %clang %s -emit-llvm -g %O0opt -c -o %t.bc
+// RUN: rm -rf %t.out %t.replay
+// RUN: %klee --output-dir=%t.out %t.bc
+// RUN: %klee --output-dir=%t.replay --fast-replay --replay-jobs=2 --replay-ktest-dir=%t.out %t.bc
+// RUN: test -f %t.replay/replay0/replay.cov
+// RUN: test -f %t.replay/replay1/replay.cov
+// RUN: grep -q "FastReplay.c:" %t.replay/replay.cov
+// RUN: FileCheck --input-file=%t.replay/replay.errors %s
+
+#include "klee/klee.h"
+
+int main() {
+  int x;
+  klee_make_symbolic(&x, sizeof x, "x");
+  // CHECK: .ktest{{.}}replay{{[01]}}/test{{[0-9]+}}.abort.err
+  if (x == 42)
+    klee_abort();
+  if (x > 100)
+    return 1;
+  return 0;
+}
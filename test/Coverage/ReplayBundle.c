@@ -0,0 +1,22 @@
+// RUN: %clang %s -emit-llvm %O0opt -c -o %t1.bc
+// RUN: rm -rf %t1.out %t1.replay %t1.ktestbundle
+// RUN: %klee --output-dir=%t1.out %t1.bc
+// RUN: %gen-bout --bundle %t1.ktestbundle %t1.out/test000001.ktest %t1.out/test000002.ktest
+// RUN: %ktest-tool %t1.ktestbundle | FileCheck --check-prefix=CHECK-TOOL %s
+// RUN: %klee --output-dir=%t1.replay --replay-ktest-file=%t1.ktestbundle %t1.bc 2>&1 | FileCheck --check-prefix=CHECK-REPLAY %s
+
+// CHECK-TOOL: ktest file : '{{.*}}.ktestbundle:{{.*}}test000001.ktest'
+// CHECK-TOOL: object 0: name: 'i'
+// CHECK-TOOL: ktest file : '{{.*}}.ktestbundle:{{.*}}test000002.ktest'
+// CHECK-TOOL: object 0: name: 'i'
+
+// CHECK-REPLAY: replaying: {{.*}}.ktestbundle:{{.*}}test000001.ktest {{.*}} (1/2)
+// CHECK-REPLAY: replaying: {{.*}}.ktestbundle:{{.*}}test000002.ktest {{.*}} (2/2)
+
+int main() {
+  int i;
+  klee_make_symbolic(&i, sizeof i, "i");
+  if (i > 10)
+    return 1;
+  return 0;
+}
@@ -0,0 +1,34 @@
+// RUN: %clang %s -emit-llvm %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out %t.bc 2>&1 | FileCheck %s
+// RUN: test ! -f %t.klee-out/test000001.assert.err
+
+// CHECK: KLEE: done: completed paths = 1
+
+// One indirect call site reaching an internal function, a special function
+// and an external function in turn, so that its cached dispatch changes.
+
+#include "klee/klee.h"
+
+#include <stdlib.h>
+
+typedef long (*fn_t)(long);
+
+long twice(long x) { return 2 * x; }
+
+long allocate(long x) { return (long)malloc(x); }
+
+int main() {
+  fn_t fns[] = {twice, (fn_t)malloc, labs, twice};
+  long results[4];
+  for (int i = 0; i < 4; ++i)
+    results[i] = fns[i](i == 2 ? -7 : 8);
+
+  klee_assert(results[0] == 16);
+  klee_assert(results[1] != 0);
+  klee_assert(results[2] == 7);
+  klee_assert(results[3] == 16);
+  free((void *)results[1]);
+  free((void *)allocate(4));
+  return 0;
+}
@@ -0,0 +1,35 @@
+// RUN: %clang %s -emit-llvm %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --fork-models %t.bc > %t.log 2>&1
+// RUN: FileCheck --input-file=%t.log %s
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --fork-models=false %t.bc > %t.log 2>&1
+// RUN: FileCheck --input-file=%t.log %s
+
+// Reusing the model of the parent state finds the same branches.
+// CHECK-DAG: small even
+// CHECK-DAG: small odd
+// CHECK-DAG: large
+// CHECK: KLEE: done: completed paths = 3
+
+#include "klee/klee.h"
+
+#include <stdio.h>
+
+int main() {
+  unsigned x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  if (x < 100) {
+    // The model of the true side of the first branch satisfies x < 200.
+    if (x < 200) {
+      if (x % 2)
+        printf("small odd\n");
+      else
+        printf("small even\n");
+    }
+  } else {
+    printf("large\n");
+  }
+  return 0;
+}
@@ -0,0 +1,39 @@
+// RUN: %clang %s -emit-llvm %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out %t.bc 2>&1 | FileCheck %s
+// RUN: test ! -f %t.klee-out/test000001.assert.err
+
+// CHECK: KLEE: done: completed paths = 2
+
+// Concrete integer arithmetic is executed on inline register values; check
+// wrap-around, signedness and casts, and that the values still combine with
+// symbolic ones.
+
+#include "klee/klee.h"
+
+#include <stdint.h>
+
+int main() {
+  volatile uint8_t u8 = 0xff;
+  volatile int8_t s8 = -128;
+  volatile uint32_t u32 = 0x80000000u;
+  volatile uint64_t u64 = ~0ull;
+
+  klee_assert((uint8_t)(u8 + 1) == 0);
+  klee_assert((int8_t)(s8 - 1) == 127);
+  klee_assert(s8 < 1 && (uint8_t)s8 > 1);
+  klee_assert((int32_t)u32 < 0 && u32 > 1);
+  klee_assert((int64_t)s8 == -128 && (uint64_t)(uint8_t)s8 == 128);
+  klee_assert((uint16_t)u64 == 0xffff && u64 * u64 == 1);
+  klee_assert(((u32 ^ 0xffffffffu) | 1) == 0x7fffffffu);
+  klee_assert((uintptr_t)(void *)(uintptr_t)u32 == 0x80000000u);
+
+  int x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  int y = (int)(u8 + 1) + x;
+  if (y == 256)
+    klee_assert(x == 256);
+  else
+    klee_assert(x != 256);
+  return 0;
+}
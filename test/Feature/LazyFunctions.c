@@ -0,0 +1,40 @@
+// RUN: %clang %s -emit-llvm %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --lazy-functions %t.bc 2>&1 | FileCheck %s
+// RUN: FileCheck --check-prefix=STUBS --input-file=%t.klee-out/info %s
+// RUN: rm -rf %t.klee-out-eager
+// RUN: %klee --output-dir=%t.klee-out-eager %t.bc 2>&1 | FileCheck %s
+
+// CHECK: KLEE: done: completed paths = 3
+// The external call in report() is compiled before it is constructed.
+// STUBS: KLEE: precompiled external call sites = {{[1-9][0-9]*}}
+
+#include "klee/klee.h"
+
+#include <stdio.h>
+
+static const char *names[] = {"small", "large"};
+static int limits[] = {10, 100};
+
+// Never called, so never constructed with --lazy-functions.
+int unused(int x) { return x * limits[1]; }
+
+int classify(int x) {
+  if (x < limits[0])
+    return 0;
+  return x < limits[1] ? 1 : 2;
+}
+
+int report(int x) {
+  int c = classify(x);
+  if (c < 2)
+    printf("%s\n", names[c]);
+  return c;
+}
+
+int main() {
+  int x;
+  int (*fn)(int) = report;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  return fn(x);
+}
@@ -0,0 +1,36 @@
+// RUN: %clang %s -emit-llvm %O0opt -c -o %t.bc
+// RUN: rm -rf %t.cache %t.klee-out %t.klee-out2 %t.klee-out3 %t.klee-out4
+// RUN: %klee --output-dir=%t.klee-out --module-cache-dir=%t.cache %t.bc > %t.log 2>&1
+// RUN: FileCheck --check-prefixes=CHECK,CHECK-MISS --input-file=%t.log %s
+// RUN: %klee --output-dir=%t.klee-out2 --module-cache-dir=%t.cache %t.bc > %t.log 2>&1
+// RUN: FileCheck --check-prefixes=CHECK,CHECK-HIT --input-file=%t.log %s
+// Different module options need a different module.
+// RUN: %klee --output-dir=%t.klee-out3 --module-cache-dir=%t.cache --switch-type=simple %t.bc > %t.log 2>&1
+// RUN: FileCheck --check-prefixes=CHECK,CHECK-MISS --input-file=%t.log %s
+// RUN: %klee --output-dir=%t.klee-out4 --module-cache-dir=%t.cache --function-alias=classify_alias:classify %t.bc > %t.log 2>&1
+// RUN: FileCheck --check-prefixes=CHECK,CHECK-MISS --input-file=%t.log %s
+
+// CHECK-MISS-NOT: Using cached module
+// CHECK-HIT: KLEE: Using cached module
+// CHECK: KLEE: done: completed paths = 3
+
+#include "klee/klee.h"
+
+int classify(int x) {
+  switch (x) {
+  case 1:
+    return 1;
+  case 2:
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+int classify_alias(int x) { return classify(x); }
+
+int main() {
+  int x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  return classify_alias(x);
+}
@@ -0,0 +1,20 @@
+// RUN: %clang %s -emit-llvm %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --module-threads=4 %t.bc > %t.log 2>&1
+// RUN: FileCheck --input-file=%t.klee-out/info %s
+// RUN: FileCheck --check-prefix=CHECK-LOG --input-file=%t.log %s
+
+// CHECK-DAG: KLEE: module preparation: link =
+// CHECK-DAG: KLEE: module preparation: debug info =
+// CHECK-DAG: KLEE: module preparation: functions =
+// CHECK-LOG: KLEE: done: completed paths = 2
+
+#include "klee/klee.h"
+
+int f(int x) { return x > 10 ? 1 : 0; }
+
+int main() {
+  int x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  return f(x);
+}
@@ -0,0 +1,25 @@
+// RUN: %clang %s -emit-llvm %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// Write statistics often so the stats writer thread is busy while sampling.
+// RUN: %klee --output-dir=%t.klee-out --profile-sampling-rate=1000 --stats-write-after-instructions=1000 %t.bc > %t.log 2>&1
+// RUN: FileCheck --check-prefix=CHECK-LOG --input-file=%t.log %s
+// RUN: FileCheck --input-file=%t.klee-out/profile.folded %s
+
+// CHECK-LOG: KLEE: done: completed paths = 2
+// CHECK: {{^}}sum;{{[a-z]+}};interpreter {{[0-9]+$}}
+
+#include "klee/klee.h"
+
+unsigned sum(unsigned n) {
+  unsigned total = 0;
+  for (unsigned i = 0; i < n; ++i)
+    total += i * i;
+  return total;
+}
+
+int main() {
+  int x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  unsigned total = sum(2000000);
+  return x > 10 ? total & 1 : 0;
+}
@@ -0,0 +1,30 @@
+// RUN: %clang %s -emit-llvm %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --resolve-segment-threshold=8 %t.bc > %t.log 2>&1
+// RUN: FileCheck --input-file=%t.log %s
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --resolve-segment-threshold=0 %t.bc > %t.log 2>&1
+// RUN: FileCheck --input-file=%t.log %s
+
+// Bisecting the address space finds the same objects as querying each one.
+// CHECK: KLEE: done: completed paths = 10
+
+#include "klee/klee.h"
+
+#include <stdlib.h>
+
+#define N 64
+
+int main() {
+  int *objects[N];
+  for (unsigned i = 0; i < N; ++i)
+    objects[i] = malloc(sizeof(int) * (i % 3 + 1));
+
+  unsigned i;
+  klee_make_symbolic(&i, sizeof(i), "i");
+  klee_assume(i >= 40);
+  klee_assume(i < 50);
+
+  *objects[i] = 1;
+  return 0;
+}
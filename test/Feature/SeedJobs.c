@@ -0,0 +1,19 @@
+// RUN: %clang -emit-llvm -c -g %s -o %t.bc
+// RUN: rm -rf %t.seeds %t.klee-out
+// RUN: %klee --output-dir=%t.seeds %t.bc
+// RUN: %klee --output-dir=%t.klee-out --seed-dir=%t.seeds --seed-jobs=2 %t.bc
+// Every process follows its own seeds, none of which is dropped.
+// RUN: test -f %t.klee-out/seed0/test000001.ktest
+// RUN: test -f %t.klee-out/seed1/test000001.ktest
+
+#include "klee/klee.h"
+
+int main() {
+  int x;
+  klee_make_symbolic(&x, sizeof x, "x");
+  if (x == 1)
+    return 1;
+  if (x == 2)
+    return 2;
+  return 0;
+}
@@ -0,0 +1,54 @@
+// REQUIRES: not-msan
+// Memsan adds additional memory that overflows the counter
+// Check that states swapped out above the memory cap resume with their memory
+// intact and explore the same paths as a run without a memory cap.
+
+// RUN: %clang %s -emit-llvm %O0opt -g -c -o %t.bc
+// RUN: rm -rf %t.klee-out %t.klee-out-swapped
+// RUN: %klee --output-dir=%t.klee-out --max-memory=0 %t.bc > %t.log 2>&1
+// RUN: FileCheck --input-file=%t.log %s
+// RUN: %klee --output-dir=%t.klee-out-swapped --max-memory=64 --max-memory-inhibit=false %t.bc > %t.swapped.log 2>&1
+// RUN: FileCheck --input-file=%t.swapped.log %s
+// RUN: FileCheck --check-prefix=CHECK-SWAP --input-file=%t.klee-out-swapped/warnings.txt %s
+// RUN: %ktest-tool %t.klee-out/test*.ktest | grep "int :" | sort > %t.tests
+// RUN: %ktest-tool %t.klee-out-swapped/test*.ktest | grep "int :" | sort > %t.swapped.tests
+// RUN: diff %t.tests %t.swapped.tests
+
+// CHECK-NOT: ASSERTION FAIL
+// CHECK: KLEE: done: completed paths = 8
+// CHECK: KLEE: done: generated tests = 8
+// CHECK-SWAP: WARNING: swapped out
+// CHECK-SWAP-NOT: WARNING: killing
+
+#include "klee/klee.h"
+
+#define SIZE (32 << 20)
+#define STRIDE 4096
+
+char buffer[SIZE];
+
+int main() {
+  int x, r = 0;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  if (x & 1)
+    r |= 1;
+  if (x & 2)
+    r |= 2;
+  if (x & 4)
+    r |= 4;
+
+  // Every state gets its own copy of the buffer.
+  for (int i = 0; i < SIZE; i += STRIDE)
+    buffer[i] = r + 1;
+
+  // Keep all states alive long enough for the memory checks to run.
+  unsigned sum = 0;
+  for (int j = 0; j < 4; ++j) {
+    for (int i = 0; i < SIZE; i += STRIDE) {
+      klee_assert(buffer[i] == r + 1);
+      sum += buffer[i];
+    }
+  }
+
+  return sum != 4u * (SIZE / STRIDE) * (r + 1);
+}
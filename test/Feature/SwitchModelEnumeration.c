@@ -0,0 +1,37 @@
+// RUN: %clang %s -emit-llvm %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --switch-type=internal --search=dfs %t.bc > %t.log 2>&1
+// RUN: FileCheck --input-file=%t.log %s
+
+// Only the cases in the range of the condition are feasible.
+// CHECK-DAG: case 1
+// CHECK-DAG: case 2
+// CHECK-DAG: case 3
+// CHECK-DAG: default
+// CHECK: KLEE: done: completed paths = 4
+
+#include "klee/klee.h"
+
+#include <stdio.h>
+
+#define C(x) case x: printf("case %d\n", x); break
+#define C4(x) C(x); C(x + 1); C(x + 2); C(x + 3)
+#define C16(x) C4(x); C4(x + 4); C4(x + 8); C4(x + 12)
+#define C64(x) C16(x); C16(x + 16); C16(x + 32); C16(x + 48)
+
+int main() {
+  unsigned char c;
+  klee_make_symbolic(&c, sizeof(c), "c");
+  klee_assume(c < 4);
+
+  switch (c) {
+  C64(1);
+  C64(65);
+  C64(129);
+  C16(193); C16(209); C16(225);
+  C4(241); C4(245); C4(249); C(253); C(254);
+  default:
+    printf("default\n");
+  }
+  return 0;
+}
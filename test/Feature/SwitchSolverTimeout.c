@@ -0,0 +1,26 @@
+// RUN: %clang %s -emit-llvm %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --switch-type=internal --max-solver-time=1us %t.bc 2>&1 | FileCheck %s
+
+// Queries about a switch with enough cases to be pruned by range time out;
+// the state must end early instead of aborting KLEE.
+// CHECK: KLEE: done: completed paths =
+
+#include "klee/klee.h"
+
+#define C(x) case x: return x
+#define C4(x) C(x); C(x + 1); C(x + 2); C(x + 3)
+#define C16(x) C4(x); C4(x + 4); C4(x + 8); C4(x + 12)
+
+int main() {
+  unsigned long long x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  switch ((unsigned char)((x * x * x + 12345) % 251)) {
+  C16(1);
+  C16(17);
+  C16(33);
+  default:
+    return 0;
+  }
+}
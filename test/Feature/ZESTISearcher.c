@@ -0,0 +1,45 @@
+// RUN: %clang %s -emit-llvm %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out %t.klee-out-2
+// RUN: %klee --output-dir=%t.klee-out %t.bc "seed"
+// RUN: %klee --output-dir=%t.klee-out-2 --zesti --seed-file %t.klee-out/test000001.ktest %t.bc > %t.log 2> %t.err
+// RUN: FileCheck --input-file=%t.log %s
+// RUN: FileCheck --check-prefix=CHECK-ERR --input-file=%t.err %s
+// RUN: FileCheck --check-prefix=CHECK-INFO --input-file=%t.klee-out-2/info %s
+
+// The seed path executes a sensitive instruction right after the second
+// branch, so the state diverging there is explored first.
+// CHECK: table
+// CHECK-NEXT: b <= 0
+// CHECK-NEXT: a > 10
+
+// CHECK-ERR: seeding done
+// CHECK-ERR: KLEE: done: completed paths = 3
+// CHECK-INFO: ZESTISearcher
+
+#include "klee/klee.h"
+
+#include <stdio.h>
+
+int table[8];
+
+int main(int argc, char **argv) {
+  int a, b;
+  klee_make_symbolic(&a, sizeof a, "a");
+  klee_make_symbolic(&b, sizeof b, "b");
+  if (argc == 2) {
+    klee_assume(a == 3);
+    klee_assume(b == 1);
+  }
+
+  if (a > 10) {
+    printf("a > 10\n");
+    return 1;
+  }
+  if (b <= 0) {
+    printf("b <= 0\n");
+    return 2;
+  }
+  table[a & 7] = 1;
+  printf("table\n");
+  return 0;
+}
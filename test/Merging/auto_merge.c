@@ -0,0 +1,30 @@
+// RUN: %clang -emit-llvm -g -c -o %t.bc %s
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --execution-mode=default --auto-merge --debug-log-merge --search=bfs %t.bc 2>&1 | FileCheck %s
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --execution-mode=default --auto-merge --debug-log-merge --search=dfs %t.bc 2>&1 | FileCheck %s
+
+// CHECK: open merge:
+// CHECK: open merge:
+// CHECK: close merge:
+// CHECK: close merge:
+// CHECK: merged:
+// CHECK: generated tests = 1{{$}}
+
+#include "klee/klee.h"
+
+int main(int argc, char** args){
+
+  int x;
+  int foo;
+
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  if (x == 1) {
+    foo = 5;
+  } else {
+    foo = 6;
+  }
+
+  return foo;
+}
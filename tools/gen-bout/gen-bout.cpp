@@ -56,11 +56,40 @@ void print_usage_and_exit(char *program_name) {
     "       --sym-stdin <filename>      - Specifying a file that is the content of stdin (only once).\n"
     "       --sym-stdout <filename>     - Specifying a file that is the content of stdout (only once).\n"
     "       --sym-file <filename>       - Specifying a file that is the content of a file named A provided for the program (only once).\n"
-    "   Ex: %s -o -p -q file1 --sym-stdin file2 --sym-file file3 --sym-stdout file4\n",
-    program_name, program_name, program_name);
+    "   Ex: %s -o -p -q file1 --sym-stdin file2 --sym-file file3 --sym-stdout file4\n"
+    "       %s --bundle <filename> <ktest files>\n"
+    "       packs the ktest files into a ktest bundle, e.g., for seeding with a large corpus.\n",
+    program_name, program_name, program_name, program_name);
   exit(1);
 }
 
+static int write_bundle(char *program_name, const char *bundle_file,
+                        unsigned num_files, char **files) {
+  KTest **ktests = (KTest **)malloc(num_files * sizeof *ktests);
+  unsigned i;
+  int ok;
+
+  if (!ktests) {
+    fputs("Memory allocation failure\n", stderr);
+    exit(1);
+  }
+  for (i = 0; i < num_files; i++) {
+    if (!(ktests[i] = kTest_fromFile(files[i]))) {
+      fprintf(stderr, "Failure opening %s\n", files[i]);
+      print_usage_and_exit(program_name);
+    }
+  }
+
+  ok = kTest_toBundle(ktests, (const char **)files, num_files, bundle_file);
+  if (!ok)
+    fprintf(stderr, "Failure writing %s\n", bundle_file);
+
+  for (i = 0; i < num_files; i++)
+    kTest_free(ktests[i]);
+  free(ktests);
+  return ok ? 0 : 1;
+}
+
 int main(int argc, char *argv[]) {
   unsigned i, argv_copy_idx;
   unsigned file_counter = 0;
@@ -73,6 +102,12 @@ int main(int argc, char *argv[]) {
   if (argc < 2)
     print_usage_and_exit(argv[0]);
 
+  if (strcmp(argv[1], "--bundle") == 0 || strcmp(argv[1], "-bundle") == 0) {
+    if (argc < 4)
+      print_usage_and_exit(argv[0]);
+    return write_bundle(argv[0], argv[2], argc - 3, argv + 3);
+  }
+
   KTest b;
   b.symArgvs = 0;
   b.symArgvLen = 0;
@@ -0,0 +1,478 @@
+//===-- Benchmark.cpp -------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Parser/Parser.h"
+#include "klee/Misc/json.hpp"
+#include "klee/Solver/Common.h"
+#include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverCmdLine.h"
+#include "klee/Solver/SolverImpl.h"
+#include "klee/Solver/SolverStats.h"
+#include "klee/Support/OptionCategories.h"
+#include "klee/System/Time.h"
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace llvm;
+using namespace klee;
+using namespace klee::expr;
+using json = nlohmann::json;
+
+namespace {
+cl::list<std::string> BenchmarkConfigs(
+    "benchmark-config", cl::CommaSeparated,
+    cl::desc("Solver chain to benchmark: a core solver (stp, z3, metasmt or "
+             "dummy) and the solvers in front of it (fast-cex, cex, branch, "
+             "independent), separated by '+', e.g. z3+cex+independent. Can "
+             "be given several times (default=the chain selected by the "
+             "other solver options)"),
+    cl::cat(klee::SolvingCat));
+
+cl::opt<unsigned> BenchmarkJobs(
+    "benchmark-jobs", cl::init(1),
+    cl::desc("Number of solver chains benchmarked at the same time, each in "
+             "a process of its own (default=1)"),
+    cl::cat(klee::SolvingCat));
+
+/// A solver chain as built by constructSolverChain, without logging and
+/// validation.
+struct ChainConfig {
+  std::string name;
+  CoreSolverType core = NO_SOLVER;
+  bool fastCex = false;
+  bool cexCache = false;
+  bool branchCache = false;
+  bool independent = false;
+};
+
+const std::pair<const char *, CoreSolverType> coreSolverNames[] = {
+    {"stp", STP_SOLVER},
+    {"z3", Z3_SOLVER},
+    {"metasmt", METASMT_SOLVER},
+    {"dummy", DUMMY_SOLVER}};
+
+bool parseConfig(const std::string &spec, ChainConfig &config) {
+  config.name = spec;
+  SmallVector<StringRef, 8> parts;
+  StringRef(spec).split(parts, '+');
+  for (StringRef part : parts) {
+    if (part == "fast-cex") {
+      config.fastCex = true;
+    } else if (part == "cex") {
+      config.cexCache = true;
+    } else if (part == "branch") {
+      config.branchCache = true;
+    } else if (part == "independent") {
+      config.independent = true;
+    } else {
+      auto core = std::find_if(
+          std::begin(coreSolverNames), std::end(coreSolverNames),
+          [&](const std::pair<const char *, CoreSolverType> &p) {
+            return part == p.first;
+          });
+      if (core == std::end(coreSolverNames) || config.core != NO_SOLVER) {
+        llvm::errs() << "error: invalid solver chain \"" << spec << "\"\n";
+        return false;
+      }
+      config.core = core->second;
+    }
+  }
+  if (config.core == NO_SOLVER) {
+    llvm::errs() << "error: solver chain \"" << spec
+                 << "\" has no core solver\n";
+    return false;
+  }
+  return true;
+}
+
+/// The chain selected by the solver options of the command line.
+ChainConfig getDefaultConfig() {
+  ChainConfig config;
+  config.core = CoreSolverToUse;
+  for (const auto &p : coreSolverNames)
+    if (p.second == config.core)
+      config.name = p.first;
+  config.fastCex = UseFastCexSolver;
+  config.cexCache = UseCexCache;
+  config.branchCache = UseBranchCache;
+  config.independent = UseIndependentSolver;
+  if (config.fastCex)
+    config.name += "+fast-cex";
+  if (config.cexCache)
+    config.name += "+cex";
+  if (config.branchCache)
+    config.name += "+branch";
+  if (config.independent)
+    config.name += "+independent";
+  return config;
+}
+
+Solver *buildChain(const ChainConfig &config) {
+  Solver *solver = createCoreSolver(config.core);
+  if (!solver)
+    return nullptr;
+  if (config.core != DUMMY_SOLVER) {
+    const time::Span maxCoreSolverTime(MaxCoreSolverTime);
+    if (maxCoreSolverTime)
+      solver->setCoreSolverTimeout(maxCoreSolverTime);
+  }
+
+  // In the order of constructSolverChain
+  if (config.fastCex)
+    solver = createFastCexSolver(solver);
+  if (config.cexCache)
+    solver = createCexCachingSolver(solver);
+  if (config.branchCache)
+    solver = createCachingSolver(solver);
+  if (config.independent)
+    solver = createIndependentSolver(solver);
+  return solver;
+}
+
+enum QueryResult : char { Valid = 'V', Invalid = 'I', Failed = 'F' };
+
+const char *getResultName(char result) {
+  switch (result) {
+  case Valid:
+    return "VALID";
+  case Invalid:
+    return "INVALID";
+  default:
+    return "FAIL";
+  }
+}
+
+/// Like the evaluate action, but only keeping whether a counterexample
+/// exists, as different chains may well find different ones.
+QueryResult runQuery(Solver &solver, const QueryCommand &qc) {
+  ConstraintSet constraints(qc.Constraints);
+  if (qc.Values.empty() && qc.Objects.empty()) {
+    bool result;
+    if (!solver.mustBeTrue(Query(constraints, qc.Query), result))
+      return Failed;
+    return result ? Valid : Invalid;
+  }
+  if (!qc.Values.empty()) {
+    ref<ConstantExpr> value;
+    return solver.getValue(Query(constraints, qc.Values[0]), value) ? Invalid
+                                                                    : Failed;
+  }
+  std::vector<std::vector<unsigned char>> values;
+  if (solver.getInitialValues(Query(constraints, qc.Query), qc.Objects,
+                              values))
+    return Invalid;
+  return solver.impl->getOperationStatusCode() ==
+                 SolverImpl::SOLVER_RUN_STATUS_TIMEOUT
+             ? Failed
+             : Valid;
+}
+
+/// The statistics reported for each chain, in the order they are sent by
+/// the benchmarking process.
+Statistic *const reportedStats[] = {
+    &stats::queries,           &stats::queryCexCacheHits,
+    &stats::queryCexCacheMisses, &stats::queryCacheHits,
+    &stats::queryCacheMisses};
+const unsigned numReportedStats =
+    sizeof(reportedStats) / sizeof(reportedStats[0]);
+
+struct Measurement {
+  std::uint64_t microseconds;
+  char result;
+};
+
+struct ChainResults {
+  std::vector<Measurement> measurements;
+  std::uint64_t stats[numReportedStats];
+};
+
+bool writeAll(int fd, const void *data, std::size_t size) {
+  const char *p = static_cast<const char *>(data);
+  while (size) {
+    ssize_t written = write(fd, p, size);
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      return false;
+    p += written;
+    size -= written;
+  }
+  return true;
+}
+
+bool readAll(int fd, void *data, std::size_t size) {
+  char *p = static_cast<char *>(data);
+  while (size) {
+    ssize_t n = read(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+/// Runs in the benchmarking process of one chain. Queries are run one at a
+/// time, so chains running in parallel only compete for cores.
+void benchmarkChain(const ChainConfig &config,
+                    const std::vector<const QueryCommand *> &queries, int fd) {
+  std::unique_ptr<Solver> solver(buildChain(config));
+  if (!solver)
+    _exit(1);
+
+  ChainResults results;
+  for (unsigned i = 0; i < numReportedStats; ++i)
+    results.stats[i] = reportedStats[i]->getValue();
+  results.measurements.reserve(queries.size());
+  for (const QueryCommand *qc : queries) {
+    time::Point start = time::getWallTime();
+    char result = runQuery(*solver, *qc);
+    results.measurements.push_back(
+        {(time::getWallTime() - start).toMicroseconds(), result});
+  }
+  for (unsigned i = 0; i < numReportedStats; ++i)
+    results.stats[i] = reportedStats[i]->getValue() - results.stats[i];
+
+  bool sent =
+      writeAll(fd, results.measurements.data(),
+               results.measurements.size() * sizeof(Measurement)) &&
+      writeAll(fd, results.stats, sizeof(results.stats));
+  _exit(sent ? 0 : 1);
+}
+
+std::uint64_t getPercentile(const std::vector<std::uint64_t> &sorted,
+                            double percentile) {
+  // nearest rank
+  std::size_t rank = static_cast<std::size_t>(
+      std::ceil(percentile / 100 * sorted.size()));
+  return sorted[rank ? rank - 1 : 0];
+}
+
+double getHitRate(std::uint64_t hits, std::uint64_t misses) {
+  return hits + misses ? double(hits) / (hits + misses) : 0;
+}
+
+json reportChain(const ChainConfig &config, const ChainResults &results) {
+  std::vector<std::uint64_t> latencies;
+  std::uint64_t total = 0;
+  unsigned counts[3] = {0, 0, 0};
+  for (const Measurement &m : results.measurements) {
+    latencies.push_back(m.microseconds);
+    total += m.microseconds;
+    ++counts[m.result == Valid ? 0 : m.result == Invalid ? 1 : 2];
+  }
+  std::sort(latencies.begin(), latencies.end());
+
+  json out;
+  out["name"] = config.name;
+  out["valid"] = counts[0];
+  out["invalid"] = counts[1];
+  out["failed"] = counts[2];
+  out["total_time_us"] = total;
+  if (!latencies.empty()) {
+    json latency;
+    latency["min"] = latencies.front();
+    latency["p50"] = getPercentile(latencies, 50);
+    latency["p90"] = getPercentile(latencies, 90);
+    latency["p99"] = getPercentile(latencies, 99);
+    latency["max"] = latencies.back();
+    latency["mean"] = double(total) / latencies.size();
+    out["latency_us"] = latency;
+  }
+  out["core_solver_queries"] = results.stats[0];
+  out["cex_cache_hits"] = results.stats[1];
+  out["cex_cache_misses"] = results.stats[2];
+  out["cex_cache_hit_rate"] = getHitRate(results.stats[1], results.stats[2]);
+  out["branch_cache_hits"] = results.stats[3];
+  out["branch_cache_misses"] = results.stats[4];
+  out["branch_cache_hit_rate"] =
+      getHitRate(results.stats[3], results.stats[4]);
+  return out;
+}
+
+/// The .kquery files of \p corpus, in a stable order.
+bool findCorpusFiles(const std::string &corpus,
+                     std::vector<std::string> &files) {
+  if (!sys::fs::is_directory(corpus)) {
+    files.push_back(corpus);
+    return true;
+  }
+
+  std::error_code ec;
+  for (sys::fs::recursive_directory_iterator it(corpus, ec), ie;
+       it != ie && !ec; it.increment(ec)) {
+    if (sys::path::extension(it->path()) == ".kquery")
+      files.push_back(it->path());
+  }
+  if (ec) {
+    llvm::errs() << corpus << ": error: " << ec.message() << "\n";
+    return false;
+  }
+  std::sort(files.begin(), files.end());
+  return true;
+}
+} // namespace
+
+bool klee::runBenchmark(const std::string &corpus, ExprBuilder *builder,
+                        bool clearArrayDecls) {
+  std::vector<ChainConfig> configs;
+  for (const std::string &spec : BenchmarkConfigs) {
+    configs.emplace_back();
+    if (!parseConfig(spec, configs.back()))
+      return false;
+  }
+  if (configs.empty())
+    configs.push_back(getDefaultConfig());
+
+  std::vector<std::string> files;
+  if (!findCorpusFiles(corpus, files))
+    return false;
+
+  // The buffers and parsers own the arrays the queries refer to.
+  std::vector<std::unique_ptr<MemoryBuffer>> buffers;
+  std::vector<std::unique_ptr<Parser>> parsers;
+  std::vector<std::unique_ptr<Decl>> decls;
+  std::vector<const QueryCommand *> queries;
+  for (const std::string &file : files) {
+    auto buffer = MemoryBuffer::getFileOrSTDIN(file);
+    if (!buffer) {
+      llvm::errs() << file << ": error: " << buffer.getError().message()
+                   << "\n";
+      return false;
+    }
+    std::unique_ptr<Parser> parser(Parser::Create(
+        file == "-" ? "<stdin>" : file, buffer->get(), builder,
+        clearArrayDecls));
+    parser->SetMaxErrors(20);
+    while (Decl *d = parser->ParseTopLevelDecl()) {
+      decls.emplace_back(d);
+      if (auto *qc = dyn_cast<QueryCommand>(d))
+        queries.push_back(qc);
+    }
+    if (unsigned n = parser->GetNumErrors()) {
+      llvm::errs() << file << ": parse failure: " << n << " errors.\n";
+      return false;
+    }
+    buffers.push_back(std::move(*buffer));
+    parsers.push_back(std::move(parser));
+  }
+
+  // Each chain runs in a process of its own, so that chains do not share
+  // caches or statistics and can run in parallel.
+  struct Job {
+    std::size_t config;
+    pid_t pid;
+    int fd;
+  };
+  std::deque<Job> running;
+  std::vector<ChainResults> results(configs.size());
+  bool success = true;
+  std::size_t next = 0;
+  const unsigned jobs = std::max(1u, unsigned(BenchmarkJobs));
+  while (next < configs.size() || !running.empty()) {
+    while (next < configs.size() && running.size() < jobs) {
+      int fds[2];
+      if (pipe(fds)) {
+        llvm::errs() << "error: unable to create pipe: " << strerror(errno)
+                     << "\n";
+        return false;
+      }
+      llvm::outs().flush();
+      llvm::errs().flush();
+      pid_t pid = fork();
+      if (pid < 0) {
+        llvm::errs() << "error: unable to fork: " << strerror(errno) << "\n";
+        return false;
+      }
+      if (!pid) {
+        close(fds[0]);
+        benchmarkChain(configs[next], queries, fds[1]);
+      }
+      close(fds[1]);
+      running.push_back({next++, pid, fds[0]});
+    }
+
+    // Collected in order, as the results are only written at the end
+    Job job = running.front();
+    running.pop_front();
+    ChainResults &r = results[job.config];
+    r.measurements.resize(queries.size());
+    bool received =
+        readAll(job.fd, r.measurements.data(),
+                r.measurements.size() * sizeof(Measurement)) &&
+        readAll(job.fd, r.stats, sizeof(r.stats));
+    close(job.fd);
+    int status;
+    while (waitpid(job.pid, &status, 0) < 0 && errno == EINTR)
+      ;
+    if (!received) {
+      llvm::errs() << "error: benchmarking solver chain \""
+                   << configs[job.config].name << "\" failed\n";
+      success = false;
+    }
+  }
+  if (!success)
+    return false;
+
+  json out;
+  out["files"] = files;
+  out["queries"] = queries.size();
+  out["chains"] = json::array();
+  for (std::size_t c = 0; c < configs.size(); ++c)
+    out["chains"].push_back(reportChain(configs[c], results[c]));
+
+  // Queries on which the chains do not agree, not counting failures
+  json disagreements = json::array();
+  for (std::size_t q = 0; q < queries.size(); ++q) {
+    char first = Failed;
+    bool agree = true;
+    for (const ChainResults &r : results) {
+      char result = r.measurements[q].result;
+      if (result == Failed)
+        continue;
+      if (first == Failed)
+        first = result;
+      else if (result != first)
+        agree = false;
+    }
+    if (agree)
+      continue;
+    json d;
+    d["query"] = q;
+    for (std::size_t c = 0; c < configs.size(); ++c)
+      d["results"][configs[c].name] =
+          getResultName(results[c].measurements[q].result);
+    disagreements.push_back(d);
+  }
+  out["disagreements"] = disagreements;
+
+  llvm::outs() << out.dump(2) << "\n";
+  return true;
+}
@@ -0,0 +1,26 @@
+//===-- Benchmark.h ---------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_KLEAVER_BENCHMARK_H
+#define KLEE_KLEAVER_BENCHMARK_H
+
+#include <string>
+
+namespace klee {
+  class ExprBuilder;
+
+  /// Run all queries of a corpus, a .kquery file or a directory of them,
+  /// through each solver chain given by --benchmark-config and print their
+  /// latencies, cache statistics and disagreements as JSON.
+  /// \return False if the corpus or a configuration could not be used.
+  bool runBenchmark(const std::string &corpus, ExprBuilder *builder,
+                    bool clearArrayDecls);
+}
+
+#endif /* KLEE_KLEAVER_BENCHMARK_H */
@@ -7,6 +7,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "Benchmark.h"
+
 #include "klee/Config/Version.h"
 #include "klee/Expr/Constraints.h"
 #include "klee/Expr/Expr.h"
@@ -45,7 +47,7 @@ llvm::cl::opt<std::string> InputFile(llvm::cl::desc("<input query log>"),
                                      llvm::cl::Positional, llvm::cl::init("-"),
                                      llvm::cl::cat(klee::ExprCat));
 
-enum ToolActions { PrintTokens, PrintAST, PrintSMTLIBv2, Evaluate };
+enum ToolActions { PrintTokens, PrintAST, PrintSMTLIBv2, Evaluate, Benchmark };
 
 static llvm::cl::opt<ToolActions> ToolAction(
     llvm::cl::desc("Tool actions:"), llvm::cl::init(Evaluate),
@@ -56,7 +58,11 @@ static llvm::cl::opt<ToolActions> ToolAction(
                      clEnumValN(PrintAST, "print-ast",
                                 "Print parsed AST nodes from the input file."),
                      clEnumValN(Evaluate, "evaluate",
-                                "Evaluate parsed AST nodes from the input file.")
+                                "Evaluate parsed AST nodes from the input file."),
+                     clEnumValN(Benchmark, "benchmark",
+                                "Run the queries of the input file or "
+                                "directory through several solver chains "
+                                "and report statistics as JSON.")
                          KLEE_LLVM_CL_VAL_END),
     llvm::cl::cat(klee::SolvingCat));
 
@@ -401,15 +407,7 @@ int main(int argc, char **argv) {
   llvm::cl::ParseCommandLineOptions(argc, argv);
 
   std::string ErrorStr;
-  
-  auto MBResult = MemoryBuffer::getFileOrSTDIN(InputFile.c_str());
-  if (!MBResult) {
-    llvm::errs() << argv[0] << ": error: " << MBResult.getError().message()
-                 << "\n";
-    return 1;
-  }
-  std::unique_ptr<MemoryBuffer> &MB = *MBResult;
-  
+
   ExprBuilder *Builder = 0;
   switch (BuilderKind) {
   case DefaultBuilder:
@@ -426,6 +424,22 @@ int main(int argc, char **argv) {
     break;
   }
 
+  // The corpus may be a directory
+  if (ToolAction == Benchmark) {
+    success = runBenchmark(InputFile, Builder, ClearArrayAfterQuery);
+    delete Builder;
+    llvm::llvm_shutdown();
+    return success ? 0 : 1;
+  }
+
+  auto MBResult = MemoryBuffer::getFileOrSTDIN(InputFile.c_str());
+  if (!MBResult) {
+    llvm::errs() << argv[0] << ": error: " << MBResult.getError().message()
+                 << "\n";
+    return 1;
+  }
+  std::unique_ptr<MemoryBuffer> &MB = *MBResult;
+
   switch (ToolAction) {
   case PrintTokens:
     PrintInputTokens(MB.get());
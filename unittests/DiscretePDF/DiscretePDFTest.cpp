@@ -56,3 +56,25 @@ TEST(DiscretePDFTest, Rotatation) {
   ASSERT_EQ(1, testTree.getWeight(1));
   ASSERT_EQ(2, testTree.getWeight(2));
 }
+
+TEST(DiscretePDFTest, UpdateAll) {
+  DiscretePDF<int> testTree;
+
+  for (auto i = 0; i < 100; ++i)
+    testTree.insert(i, 1);
+
+  // Only the last item has a weight
+  testTree.updateAll([](int item) { return item == 99 ? 1. : 0.; });
+  for (auto i = 0; i < 99; ++i)
+    ASSERT_EQ(0, testTree.getWeight(i));
+  ASSERT_EQ(1, testTree.getWeight(99));
+  ASSERT_EQ(99, testTree.choose(0));
+  ASSERT_EQ(99, testTree.choose(0.5));
+
+  testTree.updateAll([](int item) { return item; });
+  for (auto i = 0; i < 100; ++i)
+    ASSERT_EQ(i, testTree.getWeight(i));
+  // The weights sum up to 4950, of which 0 to 5 take the first 15.
+  ASSERT_EQ(6, testTree.choose(16. / 4950));
+  ASSERT_EQ(99, testTree.choose(0.9999));
+}
@@ -0,0 +1,104 @@
+//===-- GEPExprBasesTest.cpp ----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "Core/GEPExprBases.h"
+
+#include "klee/Expr/Expr.h"
+
+#include <cstdint>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+ref<Expr> pointer(std::uint64_t address) {
+  return ConstantExpr::create(address, Expr::Int64);
+}
+
+TEST(GEPExprBasesTest, FindAndSet) {
+  GEPExprBases bases;
+  ref<Expr> base = pointer(0x1000), address = pointer(0x1008);
+  EXPECT_EQ(bases.find(address), nullptr);
+  EXPECT_EQ(bases.size(), 0u);
+
+  bases.set(address, {base, 4});
+  ASSERT_NE(bases.find(address), nullptr);
+  EXPECT_EQ(bases.find(address)->base, base);
+  EXPECT_EQ(bases.find(address)->size, 4u);
+
+  bases.set(address, {base, 8});
+  EXPECT_EQ(bases.find(address)->size, 8u);
+  EXPECT_EQ(bases.size(), 1u);
+}
+
+TEST(GEPExprBasesTest, CopyOnWrite) {
+  std::size_t total = GEPExprBases::getTotalEntries();
+  ref<Expr> base = pointer(0x1000), first = pointer(0x1008),
+            second = pointer(0x1010);
+
+  GEPExprBases bases;
+  bases.set(first, {base, 4});
+
+  {
+    // A forked copy shares the map until it is written to.
+    GEPExprBases forked(bases);
+    EXPECT_EQ(GEPExprBases::getTotalEntries(), total + 1);
+
+    forked.set(first, {base, 8});
+    forked.set(second, {base, 2});
+    EXPECT_EQ(GEPExprBases::getTotalEntries(), total + 3);
+
+    EXPECT_EQ(forked.size(), 2u);
+    EXPECT_EQ(forked.find(first)->size, 8u);
+    EXPECT_EQ(forked.find(second)->size, 2u);
+
+    EXPECT_EQ(bases.size(), 1u);
+    EXPECT_EQ(bases.find(first)->size, 4u);
+    EXPECT_EQ(bases.find(second), nullptr);
+  }
+
+  EXPECT_EQ(GEPExprBases::getTotalEntries(), total + 1);
+  EXPECT_EQ(bases.find(first)->size, 4u);
+}
+
+TEST(GEPExprBasesTest, PruneUnreferenced) {
+  GEPExprBases bases;
+  ref<Expr> base = pointer(0);
+
+  // Fill the map up to just below the size at which it is pruned, with
+  // some pointers that are referenced from elsewhere and some that are not.
+  std::vector<ref<Expr>> live;
+  const unsigned numLive = 600, numDead = 423;
+  for (unsigned i = 0; i < numLive; ++i) {
+    live.push_back(pointer(0x1000 + i));
+    bases.set(live.back(), {base, 1});
+  }
+  ref<Expr> dead = pointer(0x100000);
+  for (unsigned i = 1; i < numDead; ++i)
+    bases.set(pointer(0x100000 + i), {base, 1});
+  bases.set(dead, {base, 1});
+  EXPECT_EQ(bases.size(), numLive + numDead);
+
+  // Dropping the last reference does not change the map by itself.
+  dead = nullptr;
+  EXPECT_EQ(bases.size(), numLive + numDead);
+
+  // The next insertion prunes all unreferenced pointers.
+  ref<Expr> last = pointer(0x2000);
+  bases.set(last, {base, 1});
+  EXPECT_EQ(bases.size(), numLive + 1);
+  for (const ref<Expr> &address : live)
+    EXPECT_NE(bases.find(address), nullptr);
+  EXPECT_NE(bases.find(last), nullptr);
+}
+
+} // namespace
@@ -0,0 +1,150 @@
+#include "klee/ADT/KTest.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+/// A KTest with two objects, whose contents depend on \p seed.
+struct TestKTest {
+  char arg0[8] = "prog";
+  char arg1[8];
+  char *args[2] = {arg0, arg1};
+  char name0[8] = "a";
+  char name1[8] = "buffer";
+  unsigned char bytes0[4];
+  unsigned char bytes1[100];
+  KTestObject objects[2];
+  KTest ktest;
+
+  TestKTest(const TestKTest &) = delete;
+  explicit TestKTest(unsigned seed) {
+    snprintf(arg1, sizeof(arg1), "-%u", seed);
+    for (unsigned i = 0; i < sizeof(bytes0); ++i)
+      bytes0[i] = seed + i;
+    for (unsigned i = 0; i < sizeof(bytes1); ++i)
+      bytes1[i] = seed * i;
+    objects[0] = {name0, sizeof(bytes0), bytes0};
+    objects[1] = {name1, sizeof(bytes1), bytes1};
+    ktest.version = kTest_getCurrentVersion();
+    ktest.numArgs = 2;
+    ktest.args = args;
+    ktest.symArgvs = seed;
+    ktest.symArgvLen = 2 * seed;
+    ktest.numObjects = 2;
+    ktest.objects = objects;
+  }
+};
+
+void expectEqual(const KTest &expected, const KTest &actual) {
+  ASSERT_EQ(expected.numArgs, actual.numArgs);
+  for (unsigned i = 0; i < expected.numArgs; ++i)
+    EXPECT_STREQ(expected.args[i], actual.args[i]);
+  EXPECT_EQ(expected.symArgvs, actual.symArgvs);
+  EXPECT_EQ(expected.symArgvLen, actual.symArgvLen);
+  ASSERT_EQ(expected.numObjects, actual.numObjects);
+  for (unsigned i = 0; i < expected.numObjects; ++i) {
+    EXPECT_STREQ(expected.objects[i].name, actual.objects[i].name);
+    ASSERT_EQ(expected.objects[i].numBytes, actual.objects[i].numBytes);
+    EXPECT_EQ(0, memcmp(expected.objects[i].bytes, actual.objects[i].bytes,
+                        expected.objects[i].numBytes));
+  }
+}
+
+TEST(KTestTest, MappedFile) {
+  TestKTest t(3);
+  ASSERT_TRUE(kTest_toFile(&t.ktest, "ktest1.ktest"));
+  EXPECT_FALSE(kTest_isBundleFile("ktest1.ktest"));
+
+  KTestBundle *b = kTestBundle_open("ktest1.ktest");
+  ASSERT_NE(nullptr, b);
+  ASSERT_EQ(1u, kTestBundle_size(b));
+  EXPECT_STREQ("ktest1.ktest", kTestBundle_getName(b, 0));
+  KTest *k = kTestBundle_getKTest(b, 0);
+  ASSERT_NE(nullptr, k);
+  expectEqual(t.ktest, *k);
+  EXPECT_EQ(k, kTestBundle_getKTest(b, 0));
+  EXPECT_EQ(nullptr, kTestBundle_getKTest(b, 1));
+
+  // The bytes may be changed without changing the file
+  k->objects[0].bytes[0] = 42;
+  kTestBundle_close(b);
+  KTest *copy = kTest_fromFile("ktest1.ktest");
+  ASSERT_NE(nullptr, copy);
+  expectEqual(t.ktest, *copy);
+  kTest_free(copy);
+}
+
+TEST(KTestTest, Bundle) {
+  std::vector<std::unique_ptr<TestKTest>> tests;
+  for (unsigned i = 0; i < 10; ++i)
+    tests.emplace_back(new TestKTest(i));
+  std::vector<KTest *> ktests;
+  std::vector<std::string> names;
+  std::vector<const char *> namePointers;
+  for (unsigned i = 0; i < tests.size(); ++i) {
+    ktests.push_back(&tests[i]->ktest);
+    names.push_back("test" + std::to_string(i) + ".ktest");
+  }
+  for (const std::string &name : names)
+    namePointers.push_back(name.c_str());
+  ASSERT_TRUE(kTest_toBundle(ktests.data(), namePointers.data(),
+                             ktests.size(), "ktests.ktestbundle"));
+  EXPECT_TRUE(kTest_isBundleFile("ktests.ktestbundle"));
+  EXPECT_FALSE(kTest_isKTestFile("ktests.ktestbundle"));
+
+  KTestBundle *b = kTestBundle_open("ktests.ktestbundle");
+  ASSERT_NE(nullptr, b);
+  ASSERT_EQ(tests.size(), kTestBundle_size(b));
+  // in any order
+  for (unsigned i = tests.size(); i-- > 0;) {
+    EXPECT_EQ(names[i], kTestBundle_getName(b, i));
+    KTest *k = kTestBundle_getKTest(b, i);
+    ASSERT_NE(nullptr, k);
+    expectEqual(tests[i]->ktest, *k);
+  }
+  kTestBundle_close(b);
+}
+
+TEST(KTestTest, Truncated) {
+  TestKTest t(5);
+  const char *name = "truncated.ktest";
+  KTest *ktest = &t.ktest;
+  ASSERT_TRUE(kTest_toBundle(&ktest, &name, 1, "truncated.ktestbundle"));
+  FILE *f = fopen("truncated.ktestbundle", "rb");
+  ASSERT_NE(nullptr, f);
+  std::vector<char> data(4096);
+  data.resize(fread(data.data(), 1, data.size(), f));
+  fclose(f);
+
+  // Cutting off the end of the ktest leaves a valid index
+  f = fopen("truncated.ktestbundle", "wb");
+  fwrite(data.data(), 1, data.size() - 50, f);
+  fclose(f);
+  KTestBundle *b = kTestBundle_open("truncated.ktestbundle");
+  EXPECT_EQ(nullptr, b);
+
+  // Cutting off the end of the index does not
+  f = fopen("truncated.ktestbundle", "wb");
+  fwrite(data.data(), 1, 20, f);
+  fclose(f);
+  EXPECT_EQ(nullptr, kTestBundle_open("truncated.ktestbundle"));
+
+  // A ktest cut off in the middle of an object is not read past its end
+  ASSERT_TRUE(kTest_toFile(&t.ktest, "truncated.ktest"));
+  f = fopen("truncated.ktest", "rb");
+  data.resize(4096);
+  data.resize(fread(data.data(), 1, data.size(), f));
+  fclose(f);
+  f = fopen("truncated.ktest", "wb");
+  fwrite(data.data(), 1, data.size() - 50, f);
+  fclose(f);
+  b = kTestBundle_open("truncated.ktest");
+  ASSERT_NE(nullptr, b);
+  EXPECT_EQ(nullptr, kTestBundle_getKTest(b, 0));
+  kTestBundle_close(b);
+}
+} // namespace
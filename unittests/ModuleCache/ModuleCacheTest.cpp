@@ -0,0 +1,70 @@
+#include "klee/Module/ModuleCache.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+
+using namespace klee;
+using namespace llvm;
+
+namespace {
+std::unique_ptr<Module> makeModule(LLVMContext &ctx, const std::string &name) {
+  auto m = std::make_unique<Module>("test", ctx);
+  Function *f = Function::Create(
+      FunctionType::get(Type::getInt32Ty(ctx), false),
+      GlobalValue::ExternalLinkage, name, m.get());
+  IRBuilder<> builder(BasicBlock::Create(ctx, "entry", f));
+  builder.CreateRet(builder.getInt32(42));
+  return m;
+}
+
+class ModuleCacheTest : public ::testing::Test {
+protected:
+  SmallString<128> directory;
+  LLVMContext ctx;
+
+  void SetUp() override {
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("klee-module-cache", directory));
+  }
+  void TearDown() override { sys::fs::remove_directories(directory); }
+
+  std::unique_ptr<ModuleCache> makeCache(const Module &input,
+                                         const std::string &options) {
+    auto cache = std::make_unique<ModuleCache>(directory.str().str());
+    cache->addString(options);
+    cache->addModule(input);
+    return cache;
+  }
+};
+
+TEST_F(ModuleCacheTest, RoundTrip) {
+  auto input = makeModule(ctx, "f");
+  EXPECT_EQ(makeCache(*input, "-O")->load(ctx), nullptr);
+
+  auto prepared = makeModule(ctx, "prepared");
+  makeCache(*input, "-O")->store(*prepared);
+
+  auto loaded = makeCache(*input, "-O")->load(ctx);
+  ASSERT_NE(loaded, nullptr);
+  EXPECT_NE(loaded->getFunction("prepared"), nullptr);
+  EXPECT_EQ(loaded->getFunction("f"), nullptr);
+}
+
+TEST_F(ModuleCacheTest, KeyCoversInputs) {
+  auto input = makeModule(ctx, "f");
+  makeCache(*input, "-O")->store(*input);
+
+  EXPECT_EQ(makeCache(*input, "-O0")->load(ctx), nullptr);
+  auto other = makeModule(ctx, "g");
+  EXPECT_EQ(makeCache(*other, "-O")->load(ctx), nullptr);
+  EXPECT_NE(makeCache(*input, "-O")->load(ctx), nullptr);
+}
+} // namespace
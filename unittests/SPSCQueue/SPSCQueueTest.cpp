@@ -0,0 +1,53 @@
+#include "klee/ADT/SPSCQueue.h"
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <thread>
+
+using namespace klee;
+
+TEST(SPSCQueueTest, FullAndEmpty) {
+  SPSCQueue<int, 4> queue;
+  int value;
+
+  ASSERT_TRUE(queue.empty());
+  ASSERT_FALSE(queue.pop(value));
+
+  for (int i = 0; i < 4; ++i)
+    ASSERT_TRUE(queue.push(i));
+  ASSERT_FALSE(queue.push(4));
+
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(queue.pop(value));
+    ASSERT_EQ(i, value);
+  }
+  ASSERT_TRUE(queue.empty());
+
+  // wrap around
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(queue.push(i));
+    ASSERT_TRUE(queue.pop(value));
+    ASSERT_EQ(i, value);
+  }
+}
+
+TEST(SPSCQueueTest, ConcurrentOrder) {
+  SPSCQueue<std::uint64_t, 64> queue;
+  const std::uint64_t count = 10000;
+
+  std::thread producer([&] {
+    for (std::uint64_t i = 0; i < count; ++i)
+      while (!queue.push(i))
+        std::this_thread::yield();
+  });
+
+  std::uint64_t expected = 0, value;
+  while (expected < count) {
+    if (queue.pop(value)) {
+      ASSERT_EQ(expected, value);
+      ++expected;
+    }
+  }
+  producer.join();
+  ASSERT_TRUE(queue.empty());
+}
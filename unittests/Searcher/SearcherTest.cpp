@@ -17,6 +17,10 @@
 
 #include "llvm/Support/raw_ostream.h"
 
+#include <chrono>
+#include <memory>
+#include <vector>
+
 using namespace klee;
 
 namespace {
@@ -25,7 +29,7 @@ TEST(SearcherTest, RandomPath) {
   // First state
   ExecutionState es;
   PTree processTree(&es);
-  es.ptreeNode = processTree.root.getPointer();
+  es.ptreeNode = processTree.root;
 
   RNG rng;
   RandomPathSearcher rp(processTree, rng);
@@ -65,7 +69,7 @@ TEST(SearcherTest, TwoRandomPath) {
   // Root state
   ExecutionState root;
   PTree processTree(&root);
-  root.ptreeNode = processTree.root.getPointer();
+  root.ptreeNode = processTree.root;
 
   ExecutionState es(root);
   processTree.attach(root.ptreeNode, &es, &root);
@@ -117,13 +121,13 @@ TEST(SearcherTest, TwoRandomPath) {
 
 TEST(SearcherTest, TwoRandomPathDot) {
   std::stringstream modelPTreeDot;
-  PTreeNode *rootPNode, *rightLeafPNode, *esParentPNode, *es1LeafPNode,
-      *esLeafPNode;
+  PTreeNodeID rootPNode, rightLeafPNode, esParentPNode, es1LeafPNode,
+      esLeafPNode;
 
   // Root state
   ExecutionState root;
   PTree processTree(&root);
-  root.ptreeNode = processTree.root.getPointer();
+  root.ptreeNode = processTree.root;
   rootPNode = root.ptreeNode;
 
   ExecutionState es(root);
@@ -155,13 +159,13 @@ TEST(SearcherTest, TwoRandomPathDot) {
       << "\tnode [style=\"filled\",width=.1,height=.1,fontname=\"Terminus\"]\n"
       << "\tedge [arrowsize=.3]\n"
       << "\tn" << rootPNode << " [shape=diamond];\n"
-      << "\tn" << rootPNode << " -> n" << esParentPNode << " [label=0b011];\n"
-      << "\tn" << rootPNode << " -> n" << rightLeafPNode << " [label=0b000];\n"
+      << "\tn" << rootPNode << " -> n" << esParentPNode << " [label=0b11];\n"
+      << "\tn" << rootPNode << " -> n" << rightLeafPNode << " [label=0b00];\n"
       << "\tn" << rightLeafPNode << " [shape=diamond,fillcolor=green];\n"
       << "\tn" << esParentPNode << " [shape=diamond];\n"
       << "\tn" << esParentPNode << " -> n" << es1LeafPNode
-      << " [label=0b010];\n"
-      << "\tn" << esParentPNode << " -> n" << esLeafPNode << " [label=0b001];\n"
+      << " [label=0b10];\n"
+      << "\tn" << esParentPNode << " -> n" << esLeafPNode << " [label=0b01];\n"
       << "\tn" << esLeafPNode << " [shape=diamond,fillcolor=green];\n"
       << "\tn" << es1LeafPNode << " [shape=diamond,fillcolor=green];\n"
       << "}\n";
@@ -186,12 +190,12 @@ TEST(SearcherTest, TwoRandomPathDot) {
       << "\tnode [style=\"filled\",width=.1,height=.1,fontname=\"Terminus\"]\n"
       << "\tedge [arrowsize=.3]\n"
       << "\tn" << rootPNode << " [shape=diamond];\n"
-      << "\tn" << rootPNode << " -> n" << esParentPNode << " [label=0b001];\n"
-      << "\tn" << rootPNode << " -> n" << rightLeafPNode << " [label=0b000];\n"
+      << "\tn" << rootPNode << " -> n" << esParentPNode << " [label=0b01];\n"
+      << "\tn" << rootPNode << " -> n" << rightLeafPNode << " [label=0b00];\n"
       << "\tn" << rightLeafPNode << " [shape=diamond,fillcolor=green];\n"
       << "\tn" << esParentPNode << " [shape=diamond];\n"
       << "\tn" << esParentPNode << " -> n" << es1LeafPNode
-      << " [label=0b001];\n"
+      << " [label=0b01];\n"
       << "\tn" << es1LeafPNode << " [shape=diamond,fillcolor=green];\n"
       << "}\n";
 
@@ -201,17 +205,161 @@ TEST(SearcherTest, TwoRandomPathDot) {
   processTree.remove(es1.ptreeNode);
   processTree.remove(root.ptreeNode);
 }
+
+TEST(SearcherTest, WeightedRandomStaleWeights) {
+  ExecutionState es, es1;
+  es.setID();
+  es1.setID();
+  RNG rng;
+  WeightedRandomSearcher wrs(WeightedRandomSearcher::QueryCost, rng);
+
+  wrs.update(nullptr, {&es, &es1}, {});
+
+  // es becomes expensive: its weight drops from 1 to 1/1000
+  es.queryMetaData.queryCost = time::seconds(1000);
+  wrs.update(&es, {}, {});
+  int selected = 0;
+  for (int i = 0; i < 1000; i++)
+    selected += &wrs.selectState() == &es;
+  EXPECT_LT(selected, 10);
+
+  // A stale state that is removed before selection is dropped
+  es1.queryMetaData.queryCost = time::seconds(1000);
+  wrs.update(&es1, {}, {&es1});
+  for (int i = 0; i < 100; i++)
+    EXPECT_EQ(&wrs.selectState(), &es);
+
+  wrs.update(nullptr, {}, {&es});
+  EXPECT_TRUE(wrs.empty());
+}
+
+// Selection throughput with the current state changing on every step, as
+// when interleaved with another searcher. Run with
+// --gtest_also_run_disabled_tests.
+TEST(SearcherTest, DISABLED_WeightedRandomThroughput) {
+  for (std::size_t numStates : {100000, 1000000}) {
+    std::vector<std::unique_ptr<ExecutionState>> states;
+    std::vector<ExecutionState *> added;
+    for (std::size_t i = 0; i < numStates; ++i) {
+      states.emplace_back(new ExecutionState());
+      states.back()->setID();
+      added.push_back(states.back().get());
+    }
+
+    RNG rng;
+    WeightedRandomSearcher wrs(WeightedRandomSearcher::QueryCost, rng);
+    wrs.update(nullptr, added, {});
+
+    const unsigned steps = 1000000;
+    auto start = std::chrono::steady_clock::now();
+    ExecutionState *current = &wrs.selectState();
+    for (unsigned i = 0; i < steps; ++i) {
+      current->queryMetaData.queryCost += time::microseconds(i % 1000);
+      wrs.update(current, {}, {});
+      current = &wrs.selectState();
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    llvm::outs() << numStates << " states: "
+                 << static_cast<std::uint64_t>(steps / elapsed.count())
+                 << " selections/s\n";
+
+    wrs.update(nullptr, {}, added);
+  }
+}
+
 TEST(SearcherDeathTest, TooManyRandomPaths) {
   // First state
   ExecutionState es;
   PTree processTree(&es);
-  es.ptreeNode = processTree.root.getPointer();
+  es.ptreeNode = processTree.root;
   processTree.remove(es.ptreeNode); // Need to remove to avoid leaks
 
+  RNG rng;
+  std::vector<std::unique_ptr<RandomPathSearcher>> searchers;
+  for (int i = 0; i < PTree::maxSearchers; ++i)
+    searchers.emplace_back(new RandomPathSearcher(processTree, rng));
+  ASSERT_DEATH({ RandomPathSearcher rp(processTree, rng); }, "");
+}
+
+TEST(SearcherTest, ManyStates) {
+  // Enough states to have the process tree compacted on the way down
+  ExecutionState root;
+  PTree processTree(&root);
+
   RNG rng;
   RandomPathSearcher rp(processTree, rng);
-  RandomPathSearcher rp1(processTree, rng);
-  RandomPathSearcher rp2(processTree, rng);
-  ASSERT_DEATH({ RandomPathSearcher rp3(processTree, rng); }, "");
+  rp.update(nullptr, {&root}, {});
+
+  std::vector<std::unique_ptr<ExecutionState>> states;
+  ExecutionState *last = &root;
+  for (int i = 0; i < 10000; ++i) {
+    states.emplace_back(new ExecutionState(*last));
+    processTree.attach(last->ptreeNode, states.back().get(), last);
+    rp.update(last, {states.back().get()}, {});
+    last = states.back().get();
+  }
+
+  // Remove all but every 100th state, newest first
+  for (int i = 9999; i >= 0; --i) {
+    if (i % 100 == 0)
+      continue;
+    rp.update(nullptr, {}, {states[i].get()});
+    processTree.remove(states[i]->ptreeNode);
+  }
+
+  for (int i = 0; i < 10000; i += 100)
+    EXPECT_EQ(processTree.getNode(states[i]->ptreeNode).state,
+              states[i].get());
+  EXPECT_EQ(processTree.getNode(root.ptreeNode).state, &root);
+
+  for (int i = 0; i < 1000; ++i) {
+    ExecutionState &selected = rp.selectState();
+    EXPECT_TRUE(&selected == &root ||
+                (selected.ptreeNode != PTreeNode::none &&
+                 processTree.getNode(selected.ptreeNode).state == &selected));
+  }
+
+  for (int i = 0; i < 10000; i += 100) {
+    rp.update(nullptr, {}, {states[i].get()});
+    processTree.remove(states[i]->ptreeNode);
+  }
+  rp.update(nullptr, {}, {&root});
+  processTree.remove(root.ptreeNode);
+  EXPECT_TRUE(rp.empty());
+}
+
+TEST(SearcherTest, ZESTI) {
+  // Divergence points at distance 1, 5 and none from sensitive instructions
+  ExecutionState es1, es2, es3;
+  es1.depth = 2;
+  es2.depth = 5;
+  es3.depth = 12;
+  ZESTISearcher zesti({3, 10}, 1);
+  EXPECT_TRUE(zesti.empty());
+
+  zesti.update(nullptr, {&es3, &es2, &es1}, {});
+  EXPECT_EQ(&zesti.selectState(), &es1);
+
+  // Forks stay with their divergence point
+  std::unique_ptr<ExecutionState> es4(es1.branch());
+  zesti.update(&es1, {es4.get()}, {});
+  EXPECT_EQ(&zesti.selectState(), &es1);
+
+  // Beyond the bound
+  ++es1.depth;
+  zesti.update(&es1, {}, {});
+  EXPECT_EQ(&zesti.selectState(), es4.get());
+  zesti.update(es4.get(), {}, {es4.get()});
+  EXPECT_EQ(&zesti.selectState(), &es2);
+  zesti.update(&es2, {}, {&es2});
+  EXPECT_EQ(&zesti.selectState(), &es3);
+  zesti.update(&es3, {}, {&es3});
+
+  // Only the paused state is left
+  EXPECT_FALSE(zesti.empty());
+  EXPECT_EQ(&zesti.selectState(), &es1);
+  zesti.update(&es1, {}, {&es1});
+  EXPECT_TRUE(zesti.empty());
 }
 }
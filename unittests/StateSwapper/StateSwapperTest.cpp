@@ -0,0 +1,131 @@
+//===-- StateSwapperTest.cpp ----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+#define KLEE_UNITTEST
+
+#include "gtest/gtest.h"
+
+#include "Core/ExecutionState.h"
+#include "Core/Memory.h"
+#include "Core/StateSwapper.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+
+#include <cstdint>
+#include <string>
+
+using namespace klee;
+
+namespace {
+
+class StateSwapperTest : public ::testing::Test {
+protected:
+  llvm::SmallString<128> directory;
+
+  void SetUp() override {
+    ASSERT_FALSE(
+        llvm::sys::fs::createUniqueDirectory("klee-state-swapper", directory));
+  }
+  void TearDown() override { llvm::sys::fs::remove_directories(directory); }
+
+  std::string prefix() const { return directory.str().str() + "/state"; }
+
+  static const MemoryObject *bindObject(ExecutionState &state, uint64_t address,
+                                        unsigned size, uint8_t seed) {
+    auto *mo = new MemoryObject(address, size, false, false, false, nullptr,
+                                nullptr);
+    auto *os = new ObjectState(mo);
+    for (unsigned i = 0; i < size; ++i)
+      os->write8(i, static_cast<uint8_t>(seed + i));
+    state.addressSpace.bindObject(mo, os);
+    return mo;
+  }
+
+  static uint8_t readByte(const ExecutionState &state, const MemoryObject *mo,
+                          unsigned offset) {
+    const ObjectState *os = state.addressSpace.findObject(mo);
+    return cast<ConstantExpr>(os->read8(offset))->getZExtValue();
+  }
+
+  unsigned countSwapFiles() const {
+    std::error_code ec;
+    unsigned count = 0;
+    for (llvm::sys::fs::directory_iterator it(directory, ec), end;
+         it != end && !ec; it.increment(ec))
+      ++count;
+    return count;
+  }
+};
+
+TEST_F(StateSwapperTest, RoundTrip) {
+  ExecutionState state;
+  const MemoryObject *small = bindObject(state, 0x1000, 16, 1);
+  const MemoryObject *large = bindObject(state, 0x2000, 4096, 7);
+
+  StateSwapper swapper(prefix());
+  EXPECT_FALSE(swapper.isSwappedOut(state));
+  EXPECT_EQ(swapper.swapOut(state), 16u + 4096u);
+  EXPECT_TRUE(swapper.isSwappedOut(state));
+  EXPECT_EQ(swapper.getNumSwappedStates(), 1u);
+  EXPECT_EQ(swapper.getSwappedBytes(), 16u + 4096u);
+  EXPECT_EQ(countSwapFiles(), 1u);
+
+  swapper.swapIn(state);
+  EXPECT_FALSE(swapper.isSwappedOut(state));
+  EXPECT_EQ(swapper.getNumSwappedStates(), 0u);
+  EXPECT_EQ(swapper.getSwappedBytes(), 0u);
+  EXPECT_EQ(countSwapFiles(), 0u);
+
+  for (unsigned i = 0; i < 16; ++i)
+    EXPECT_EQ(readByte(state, small, i), static_cast<uint8_t>(1 + i));
+  for (unsigned i = 0; i < 4096; ++i)
+    EXPECT_EQ(readByte(state, large, i), static_cast<uint8_t>(7 + i));
+
+  // A state that was swapped in can be swapped out again.
+  EXPECT_EQ(swapper.swapOut(state), 16u + 4096u);
+  swapper.swapIn(state);
+  EXPECT_EQ(readByte(state, large, 4095), static_cast<uint8_t>(7 + 4095));
+}
+
+TEST_F(StateSwapperTest, SharedObjectsStayResident) {
+  ExecutionState state;
+  const MemoryObject *shared = bindObject(state, 0x1000, 64, 3);
+
+  // After a fork the object is owned by neither state.
+  ExecutionState forked(state);
+  StateSwapper swapper(prefix());
+  EXPECT_EQ(swapper.swapOut(state), 0u);
+  EXPECT_FALSE(swapper.isSwappedOut(state));
+  EXPECT_EQ(countSwapFiles(), 0u);
+
+  // Only the object the state wrote to since is swapped out.
+  state.addressSpace.getWriteable(shared, state.addressSpace.findObject(shared))
+      ->write8(0, 42);
+  EXPECT_EQ(swapper.swapOut(state), 64u);
+  EXPECT_EQ(readByte(forked, shared, 0), 3u);
+
+  swapper.swapIn(state);
+  EXPECT_EQ(readByte(state, shared, 0), 42u);
+  EXPECT_EQ(readByte(state, shared, 1), 4u);
+  EXPECT_EQ(readByte(forked, shared, 0), 3u);
+}
+
+TEST_F(StateSwapperTest, Discard) {
+  ExecutionState state;
+  bindObject(state, 0x1000, 32, 0);
+
+  StateSwapper swapper(prefix());
+  EXPECT_EQ(swapper.swapOut(state), 32u);
+  swapper.discard(state);
+  EXPECT_FALSE(swapper.isSwappedOut(state));
+  EXPECT_EQ(swapper.getSwappedBytes(), 0u);
+  EXPECT_EQ(countSwapFiles(), 0u);
+}
+
+} // namespace
@@ -1,7 +1,11 @@
 #include "klee/ADT/TreeStream.h"
+#include <string>
 #include <vector>
 #include <cstring>
 
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include "gtest/gtest.h"
 
 using namespace klee;
@@ -46,3 +50,81 @@ TEST(TreeStreamTest, WriteLargerThanBufferSize) {
   for (unsigned i=0; i<out.size(); i++)
     ASSERT_EQ('A', out[i]);
 }
+
+static std::string readString(TreeStreamWriter &tsw, const TreeOStream &tos) {
+  std::vector<unsigned char> out;
+  tsw.readStream(tos.getID(), out);
+  return std::string(out.begin(), out.end());
+}
+
+/* A stream opened from another one starts with everything its parent
+   contained at that point, but not with what the parent writes later. */
+TEST(TreeStreamTest, Fork) {
+  TreeStreamWriter tsw("tsw3.out");
+  ASSERT_TRUE(tsw.good());
+
+  TreeOStream parent = tsw.open();
+  parent << "ab";
+  TreeOStream child = tsw.open(parent);
+  parent << "c";
+  child << "d";
+  TreeOStream grandchild = tsw.open(child);
+  child << "e";
+  parent << "f";
+  grandchild << "g";
+
+  ASSERT_EQ("abcf", readString(tsw, parent));
+  ASSERT_EQ("abde", readString(tsw, child));
+  ASSERT_EQ("abdg", readString(tsw, grandchild));
+}
+
+/* Interleaved writes to many streams fill several chunks. */
+TEST(TreeStreamTest, ManyChunks) {
+  TreeStreamWriter tsw("tsw4.out");
+  ASSERT_TRUE(tsw.good());
+
+  std::vector<TreeOStream> streams;
+  streams.push_back(tsw.open());
+  std::vector<std::string> expected(1);
+  for (unsigned i = 0; i < 100000; i++) {
+    unsigned s = i % streams.size();
+    if (i % 7 == 0) {
+      streams.push_back(tsw.open(streams[s]));
+      expected.push_back(expected[s]);
+    }
+    std::string data = std::to_string(i) + ",";
+    streams[s] << data;
+    expected[s] += data;
+  }
+
+  for (unsigned s = 0; s < streams.size(); s += 997)
+    ASSERT_EQ(expected[s], readString(tsw, streams[s]));
+}
+
+/* A forked process writes to its own segment, but still sees what was
+   written before the fork. */
+TEST(TreeStreamTest, ForkedProcess) {
+  TreeStreamWriter tsw("tsw5.out");
+  ASSERT_TRUE(tsw.good());
+
+  TreeOStream tos = tsw.open();
+  tos << "abc";
+
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0) {
+    TreeOStream child = tsw.open(tos);
+    child << "d";
+    tos << "e";
+    bool ok = readString(tsw, child) == "abcd" && readString(tsw, tos) == "abce";
+    _exit(ok ? 0 : 1);
+  }
+  tos << "f";
+
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(0, WEXITSTATUS(status));
+  ASSERT_EQ("abcf", readString(tsw, tos));
+  unlink(("tsw5.out." + std::to_string(pid)).c_str());
+}